@@ -1,7 +1,11 @@
 #include "suffix_tree.h"
+#include "metrics.h"
+#include "progress.h"
+#include "gz_input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 /* constants related to command line parameter values */
 #define NO_DEPTH_LIMIT -1
@@ -9,6 +13,8 @@
 #define MAX_WINDOW_SIZE 100000000L
 #define MIN_OVERLAP 0L
 #define MAX_OVERLAP 1000000L
+#define MAX_SCALES 16
+#define MAX_SKETCH_DEPTH 33
 
 void Usage()
 {
@@ -16,9 +22,20 @@ void Usage()
 	printf("\n");
 	printf(" <window size> range %lu to %lu, and greater than 'overlap' value\n", MIN_WINDOW_SIZE, MAX_WINDOW_SIZE);
 	printf(" <overlap> range %lu to %lu\n", MIN_OVERLAP, MAX_OVERLAP);
+	printf(" <window size> may be a comma separated list of scales (at most %d), e.g. 10000,100000,1000000,\n", MAX_SCALES);
+	printf("   with <overlap> either one value for all scales or a matching list.  The file is read once,\n");
+	printf("   each scale's windows start at exact base offsets, and each profile goes to\n");
+	printf("   <file name>.w<window size>o<overlap> instead of the screen.\n");
 	printf(" [<interval size>] breaks depth range into chunks\n");
 	printf(" [DAWG] removes nodes that have suffix links to nodes with same child counts.\n");
 	printf(" [LEFT] removes nodes that are not left diverse.\n");
+	printf(" [SKETCH] estimates the counts with HyperLogLog sketches of the d-mers instead of building trees,\n");
+	printf("   memory does not depend on <window size>.  Needs <min depth>-<max depth>, min depth at least 2\n");
+	printf("   and max depth at most %d,\n", MAX_SKETCH_DEPTH);
+	printf("   <window size> a multiple of (<window size> - <overlap>), and that step longer than max depth.\n");
+	printf("   Nodes are estimated branchings, Substrings distinct substrings of the interval's lengths,\n");
+	printf("   and one Error column per interval follows (standard error of the Substrings estimate).\n");
+	printf(" <file name> may be gzip or BGZF compressed (a .fa.gz), it is read as it is (see gz_input.h).\n");
 	printf("\n");
 	printf("Breaks a file into overlapping windows, and for each window, prints the following values:");
 	printf("\n");
@@ -73,19 +90,72 @@ DBL_WORD counts_min_depth = 0;
 DBL_WORD counts_max_depth = 0;
 DBL_WORD counts_interval_size = 0;
 
-void print_counts()
+void print_counts( FILE* out )
 {
 	int i = 0;
 	counts_memory_scanner = counts_memory;
 	for (i = 0; i < number_counts; i++)
 	{
-		printf("%lu", *counts_memory_scanner++);
+		fprintf(out, "%lu", *counts_memory_scanner++);
 		if (i < (number_counts + 1))
 		{
-			printf(" ");
+			fprintf(out, " ");
 		}
 	}
-	printf("\n");
+	fprintf(out, "\n");
+}
+
+/* depth bins:
+ *
+ * One bin per output interval (or a single bin when there are no intervals).  The counting walk drops each
+ * node into the bin for its string depth, so every interval is filled by the same traversal of the tree.
+ */
+typedef struct DEPTHBIN
+{
+	DBL_WORD node_count;
+	DBL_WORD substring_count;
+	DBL_WORD substring_millions_count;
+	long start_depth;
+	long end_depth;
+} DEPTH_BIN;
+
+int number_bins = 0;
+DEPTH_BIN* bins = NULL;
+
+void allocate_bins()
+{
+	DBL_WORD interval_start_depth = 0;
+	DBL_WORD interval_end_depth = 0;
+	int i = 0;
+
+	if ((counts_max_depth == NO_DEPTH_LIMIT) || (counts_interval_size == 0))
+	{
+		number_bins = 1;
+		bins = (DEPTH_BIN*)malloc(sizeof(DEPTH_BIN));
+		bins->start_depth = (long)counts_min_depth;
+		bins->end_depth = (long)counts_max_depth;
+		return;
+	}
+
+	/* same interval walk the header and the original per-interval traversals used */
+	interval_start_depth = counts_min_depth;
+	interval_end_depth = counts_min_depth + counts_interval_size - 1;
+	while (interval_start_depth < counts_max_depth)
+	{
+		number_bins++;
+		interval_start_depth += counts_interval_size;
+	}
+	bins = (DEPTH_BIN*)malloc(number_bins*sizeof(DEPTH_BIN));
+
+	interval_start_depth = counts_min_depth;
+	for (i = 0; i < number_bins; i++)
+	{
+		bins[i].start_depth = (long)interval_start_depth;
+		bins[i].end_depth = (long)interval_end_depth;
+		interval_start_depth += counts_interval_size;
+		interval_end_depth += counts_interval_size;
+		interval_end_depth = (interval_end_depth > counts_max_depth) ? counts_max_depth : interval_end_depth;
+	}
 }
 
 void allocate_counts( int generate_DAWG, int detect_left_diverse, DBL_WORD min_depth, DBL_WORD max_depth, DBL_WORD interval_size )
@@ -105,169 +175,209 @@ void allocate_counts( int generate_DAWG, int detect_left_diverse, DBL_WORD min_d
 	{
 		number_counts += (( max_depth - min_depth + interval_size - 1)/interval_size)*2;  /*  times 2 because we store 2 values for each interval */
 	}
-	counts_memory = (DBL_WORD*)malloc(number_counts*sizeof(DBL_WORD));
-	memset(counts_memory, 0, number_counts*sizeof(DBL_WORD));
+	allocate_bins();
+	counts_memory = (DBL_WORD*)malloc((3 + number_bins*2)*sizeof(DBL_WORD));
+	memset(counts_memory, 0, (3 + number_bins*2)*sizeof(DBL_WORD));
 }
 
 
-void generate_node_counts(SUFFIX_TREE* tree, NODE* node, 
-						  long node_depth, long string_depth, 
-						  long string_depth_start, long string_depth_end, 
-						  DBL_WORD* node_count, DBL_WORD* substring_count, DBL_WORD* substring_millions_count)
+DEPTH_BIN* find_bin( long string_depth )
 {
-   NODE* child_scanner = node->sons;
-   long  start = node->edge_label_start, end;
-   end     = get_node_label_end(tree, node);
-   string_depth += (end - start + 1);
-
-   if (node->ignore_NODE)
-   {
-	   return;
-   }
-
-   if ((string_depth_end == NO_DEPTH_LIMIT) || ((string_depth >= string_depth_start) && (string_depth <= string_depth_end)))
-   {
-	   *node_count += 1;
-	   *substring_count += (end - start + 1);
-	   if (*substring_count > 1000000)
-	   {
-		   *substring_millions_count += 1;
-		   *substring_count -= 1000000;
-	   }
-   }
-   while(child_scanner != NULL)
-   {
-      generate_node_counts(tree, child_scanner, node_depth + 1, string_depth, string_depth_start, string_depth_end, node_count, substring_count, substring_millions_count);
-      child_scanner = child_scanner->right_sibling;
-   }
-}
-
+	long i = 0;
 
-void generate_left_diverse_nodes( NODE* node )
-{
-	NODE* child_scanner = node->sons;
-	char left_char = 0;
-	int is_left_diverse = 1;
-	if (child_scanner == NULL) 
+	if (number_bins == 1)
 	{
-		node->is_left_diverse = 1;
-	}
-	else
-	{	
-		while (child_scanner != NULL)
+		if ((bins->end_depth == NO_DEPTH_LIMIT) || ((string_depth >= bins->start_depth) && (string_depth <= bins->end_depth)))
 		{
-			generate_left_diverse_nodes( child_scanner );
-			if (left_char == 0)
-			{
-				left_char = child_scanner->left_char;
-			} 
-			else if (left_char != child_scanner->left_char)
-			{
-				is_left_diverse = 0;
-			}
-			if (child_scanner->is_left_diverse == 0)
-			{
-				is_left_diverse = 0;
-			}
-			child_scanner = child_scanner->right_sibling;
+			return bins;
 		}
-		node->is_left_diverse = is_left_diverse;
+		return NULL;
 	}
-	if (!node->is_left_diverse)
+	if (string_depth < bins->start_depth)
 	{
-		node->ignore_NODE = 1;
+		return NULL;
+	}
+	i = (string_depth - bins->start_depth)/(long)counts_interval_size;
+	if ((i < number_bins) && (string_depth <= bins[i].end_depth))
+	{
+		return bins + i;
 	}
+	return NULL;
 }
 
-void generate_leaf_counts( NODE* node )
+/*
+ *  Bottom up walk, only needed for DAWG and LEFT:
+ *
+ *    leaf_count -- number of leaves at or below the node (DAWG compares it across the suffix link)
+ *    is_left_diverse -- set when all children agree on the left character, nodes that are not get ignore_NODE
+ *
+ *  Both values only depend on the children, so one post-order walk computes them together.
+ */
+void generate_node_marks( NODE* node )
 {
-	/* For this, I have to add a "leaf_count" column to NODE */
-	int lc = 0;
 	NODE* child_scanner = node->sons;
+	DBL_WORD lc = 0;
+	char left_char = 0;
+	int is_left_diverse = 1;
 
-	if (child_scanner == NULL) 
+	if (child_scanner == NULL)
 	{
-		lc = 1;
+		node->leaf_count = 1;
+		node->is_left_diverse = 1;
+		return;
 	}
-	else
+	while (child_scanner != NULL)
 	{
-		while (child_scanner != NULL)
+		generate_node_marks( child_scanner );
+		lc += child_scanner->leaf_count;
+		if (left_char == 0)
+		{
+			left_char = child_scanner->left_char;
+		}
+		else if (left_char != child_scanner->left_char)
+		{
+			is_left_diverse = 0;
+		}
+		if (child_scanner->is_left_diverse == 0)
 		{
-			generate_leaf_counts( child_scanner );
-			lc += child_scanner->leaf_count;
-			child_scanner = child_scanner->right_sibling;
+			is_left_diverse = 0;
 		}
+		child_scanner = child_scanner->right_sibling;
 	}
 	node->leaf_count = lc;
+	node->is_left_diverse = is_left_diverse;
+	if (counts_detect_left_diverse && !is_left_diverse)
+	{
+		node->ignore_NODE = 1;
+	}
 }
 
-void generate_DAWG_nodes( NODE* node )
+/*
+ *  Top down counting walk: skips ignored subtrees (LEFT marks, or DAWG nodes whose suffix link target has
+ *  the same leaf count), and adds every other node to the bin for its string depth.
+ */
+void generate_node_counts( SUFFIX_TREE* tree, NODE* node, long string_depth )
 {
 	NODE* child_scanner = node->sons;
-	/* If this node has a suffix link to another NODE with the same leaf count, set the "ignore_NODE" flag */
-	if (( node->suffix_link != NULL ) && ( node->leaf_count == node->suffix_link->leaf_count ))
+	long  start = node->edge_label_start, end;
+	DEPTH_BIN* bin = NULL;
+	end     = get_node_label_end(tree, node);
+	string_depth += (end - start + 1);
+
+	if (node->ignore_NODE)
 	{
-		node->ignore_NODE = 1;
+		return;
 	}
-	else
+	if (counts_generate_DAWG && ( node->suffix_link != NULL ) && ( node->leaf_count == node->suffix_link->leaf_count ))
+	{
+		return;
+	}
+
+	bin = find_bin( string_depth );
+	if (bin != NULL)
 	{
-		while (child_scanner != NULL)
+		bin->node_count += 1;
+		bin->substring_count += (end - start + 1);
+		if (bin->substring_count > 1000000)
 		{
-			generate_DAWG_nodes( child_scanner );
-			child_scanner = child_scanner->right_sibling;
+			bin->substring_millions_count += 1;
+			bin->substring_count -= 1000000;
 		}
 	}
+	while(child_scanner != NULL)
+	{
+		generate_node_counts( tree, child_scanner, string_depth );
+		child_scanner = child_scanner->right_sibling;
+	}
 }
 
 void generate_counts( SUFFIX_TREE* tree )
 {
-	/* counts that accumulate during traversal */
-	DBL_WORD node_count = 0;
-	DBL_WORD substring_count = 0;
 	DBL_WORD substring_millions_count = 0;
-	DBL_WORD interval_start_depth = 0;
-	DBL_WORD interval_end_depth = 0;
+	int i = 0;
 
-	if (counts_generate_DAWG)
+	for (i = 0; i < number_bins; i++)
 	{
-		generate_leaf_counts( tree->root );
-		generate_DAWG_nodes( tree->root );
+		bins[i].node_count = 0;
+		bins[i].substring_count = 0;
+		bins[i].substring_millions_count = 0;
 	}
-	if (counts_detect_left_diverse)
+	if (counts_generate_DAWG || counts_detect_left_diverse)
 	{
-		generate_left_diverse_nodes( tree->root );
+		generate_node_marks( tree->root );
 	}
+	generate_node_counts( tree, tree->root, 0 );
+
 	if ((counts_max_depth == NO_DEPTH_LIMIT) || (counts_interval_size == 0))
 	{
-		generate_node_counts( tree, tree->root, 0, 0, counts_min_depth, counts_max_depth, &node_count, &substring_count, &substring_millions_count );
-		*counts_memory_scanner++ = node_count;
-		*counts_memory_scanner++ = substring_count;
+		*counts_memory_scanner++ = bins->node_count;
+		*counts_memory_scanner++ = bins->substring_count;
 	}
 	else
 	{
-		interval_start_depth = counts_min_depth;
-		interval_end_depth = counts_min_depth + counts_interval_size - 1;
-		while (interval_start_depth < counts_max_depth)
+		/* the millions column is a running total across the intervals */
+		for (i = 0; i < number_bins; i++)
 		{
-			node_count = substring_count = 0;
-			generate_node_counts( tree, tree->root, 0, 0, interval_start_depth, interval_end_depth, &node_count, &substring_count, &substring_millions_count );
-			*counts_memory_scanner++ = node_count;
+			substring_millions_count += bins[i].substring_millions_count;
+			*counts_memory_scanner++ = bins[i].node_count;
 			*counts_memory_scanner++ = substring_millions_count;
-			interval_start_depth += counts_interval_size;
-			interval_end_depth += counts_interval_size;
-			interval_end_depth = (interval_end_depth > counts_max_depth) ? counts_max_depth : interval_end_depth;
 		}
 	}
 }
 
 /*
- *  Updates:
+ *  Reads one character and updates:
  *
  *    file_line_number -- any time '\n' is encountered, this is incremented
  *    file_line_offset -- resets each time '\n' encountered, ignores '\r' in line_offset
- *    sequence_offset -- increments each time acgt or ACGT encountered, converts acgt to ACGT when put in buffer
+ *    sequence_offset -- increments each time acgt or ACGT (or N) encountered
  *
- *  Internally, has in_comment, set to true when '>' encountered, resets with '\n' (all characters in between ignored)
+ *  *in_comment is set to true when '>' encountered, resets with '\n' (all characters in between ignored)
+ *
+ *  Returns the base converted to ACGT, 0 for any other character, EOF at the end of the file.
+ */
+int counts_fgetc( FILE* file, int* in_comment )
+{
+	int cval = fgetc( file );
+
+	if (cval == EOF) return EOF;
+	if (cval == '\n')
+	{
+		*in_comment = 0;
+		file_line_number++;
+		file_line_offset = 0;
+	}
+	else if (cval == '>')
+	{
+		*in_comment = 1;
+	}
+	if (*in_comment)
+	{
+		return 0;
+	}
+	if (cval != '\r')
+	{
+		file_line_offset++;
+	}
+	if (cval == 'a') cval = 'A';
+	else if (cval == 'c') cval = 'C';
+	else if (cval == 'g') cval = 'G';
+	else if (cval == 't') cval = 'T';
+	if (cval == 'N') 
+	{
+		sequence_offset++;
+	}
+	if ((cval == 'A') || (cval == 'C') || (cval == 'G') || (cval == 'T'))
+	{
+		sequence_offset++;
+		return cval;
+	}
+	return 0;
+}
+
+/*
+ *  Reads the next window into data_buffer with counts_fgetc, saves the location of the next window start
+ *  (number_bytes - overlap bases in) in the NEXT_CHUNK globals.
  */
 DBL_WORD counts_fread( 
 	unsigned char* data_buffer, 
@@ -278,7 +388,6 @@ DBL_WORD counts_fread(
 	DBL_WORD bytes_read = 0;
 	int in_comment = 0;
 	int cval = 0;
-	int file_offset = 0;
 
 	/* save chunk values for when we need to print them along with chunk stats */
 	memset(counts_memory, 0, number_counts*sizeof(DBL_WORD));
@@ -289,60 +398,165 @@ DBL_WORD counts_fread(
 
 	while ((bytes_read < number_bytes) || (in_comment))
 	{
-		cval = fgetc( file );
+		cval = counts_fgetc( file, &in_comment );
 
-		if (feof(file)) break;
-		if (cval == '\n')
+		if (cval == EOF) break;
+		if (cval != 0)
 		{
-			in_comment = 0;
-			file_line_number++;
-			file_line_offset = 0;
+			*data_buffer++ = (char)cval;
+			bytes_read++;
+			if (bytes_read == (number_bytes - overlap))
+			{
+				NEXT_CHUNK_file_line_number = file_line_number;
+				NEXT_CHUNK_file_line_offset = file_line_offset;
+				NEXT_CHUNK_sequence_offset = sequence_offset;
+			}
 		}
-		else if (cval == '>')
+	}
+	return bytes_read;
+}
+
+/* multiple scales class methods:
+ *
+ *    Each scale is a <window size>/<overlap> pair with its own output file.  The input is read once, bases go
+ *    into a shared buffer that holds the largest window, and each scale builds a tree whenever one of its
+ *    windows is complete.  Window starts are exact base offsets, step (window size - overlap).
+ *
+ *    Distinct substring counts do not add up across windows, so larger windows are not derived from smaller
+ *    ones; the only sharing is the single read, and scales with the same window size reuse the counts of a
+ *    window that starts at the same base.
+ */
+typedef struct WINDOWSCALE
+{
+	DBL_WORD window_size;
+	DBL_WORD overlap;
+	DBL_WORD step;
+	/* base offset of the next window start to save a location for, and of the next window to build */
+	DBL_WORD next_location;
+	DBL_WORD next_window;
+	/* ring of saved locations (3 values each) for windows that are started but not complete */
+	DBL_WORD* locations;
+	DBL_WORD ring_size;
+	/* counts of the last window built, for scales with the same window size */
+	DBL_WORD* last_counts;
+	DBL_WORD last_window;
+	int has_last;
+	FILE* out;
+} WINDOW_SCALE;
+
+int number_scales = 0;
+WINDOW_SCALE scales[MAX_SCALES];
+
+void scale_save_location( WINDOW_SCALE* scale )
+{
+	DBL_WORD* location = scale->locations + ((scale->next_location/scale->step) % scale->ring_size)*3;
+	*location++ = file_line_number;
+	*location++ = file_line_offset;
+	*location++ = sequence_offset;
+	scale->next_location += scale->step;
+}
+
+void scale_generate_window( int scale_number, unsigned char* window )
+{
+	WINDOW_SCALE* scale = scales + scale_number;
+	WINDOW_SCALE* other = NULL;
+	SUFFIX_TREE* tree = NULL;
+	int i = 0;
+
+	memset(counts_memory, 0, number_counts*sizeof(DBL_WORD));
+	memcpy(counts_memory, scale->locations + ((scale->next_window/scale->step) % scale->ring_size)*3, 3*sizeof(DBL_WORD));
+	counts_memory_scanner = counts_memory + 3;
+
+	for (i = 0; i < scale_number; i++)
+	{
+		other = scales + i;
+		if (other->has_last && (other->window_size == scale->window_size) && (other->last_window == scale->next_window))
 		{
-			in_comment = 1;
+			break;
 		}
-		if (!in_comment)
+	}
+	if (i < scale_number)
+	{
+		memcpy(counts_memory + 3, other->last_counts + 3, (number_counts - 3)*sizeof(DBL_WORD));
+	}
+	else
+	{
+		tree = ST_CreateTree((const char*)window, scale->window_size);
+		METRICS_Start(METRICS_ANALYZE);
+		generate_counts( tree );
+		METRICS_Stop(METRICS_ANALYZE);
+		ST_DeleteTree( tree );
+	}
+	memcpy(scale->last_counts, counts_memory, number_counts*sizeof(DBL_WORD));
+	scale->last_window = scale->next_window;
+	scale->has_last = 1;
+	METRICS_Start(METRICS_OUTPUT);
+	print_counts( scale->out );
+	METRICS_Stop(METRICS_OUTPUT);
+	progress.windows++;
+	scale->next_window += scale->step;
+}
+
+void generate_scales( FILE* file )
+{
+	DBL_WORD max_window_size = 0;
+	DBL_WORD buffer_start = 0;
+	DBL_WORD buffer_length = 0;
+	DBL_WORD bases_read = 0;
+	unsigned char* buffer = NULL;
+	int in_comment = 0;
+	int cval = 0;
+	int i = 0;
+
+	for (i = 0; i < number_scales; i++)
+	{
+		if (scales[i].window_size > max_window_size)
 		{
-			if (cval != '\r')
-			{
-				file_line_offset++;
-			}
-			if (cval == 'a') cval = 'A';
-			else if (cval == 'c') cval = 'C';
-			else if (cval == 'g') cval = 'G';
-			else if (cval == 't') cval = 'T';
-			if (cval == 'N') 
+			max_window_size = scales[i].window_size;
+		}
+		scale_save_location( scales + i );
+	}
+	buffer = (unsigned char*)malloc(2*max_window_size*sizeof(unsigned char));
+
+	while ((cval = counts_fgetc( file, &in_comment )) != EOF)
+	{
+		if (cval == 0) continue;
+
+		/* keep the last window's worth of bases, every window still being filled starts inside it */
+		if (buffer_length == 2*max_window_size)
+		{
+			memmove(buffer, buffer + max_window_size, max_window_size);
+			buffer_start += max_window_size;
+			buffer_length = max_window_size;
+		}
+		buffer[buffer_length++] = (unsigned char)cval;
+		bases_read++;
+
+		for (i = 0; i < number_scales; i++)
+		{
+			if (scales[i].next_location == bases_read)
 			{
-				sequence_offset++;
+				scale_save_location( scales + i );
 			}
-			if ((cval == 'A') || (cval == 'C') || (cval == 'G') || (cval == 'T'))
+			if (scales[i].next_window + scales[i].window_size == bases_read)
 			{
-				*data_buffer++ = (char)cval;
-				bytes_read++;
-				sequence_offset++;
-				if (bytes_read == (number_bytes - overlap))
-				{
-					NEXT_CHUNK_file_line_number = file_line_number;
-					NEXT_CHUNK_file_line_offset = file_line_offset;
-					NEXT_CHUNK_sequence_offset = sequence_offset;
-				}
-
+				scale_generate_window( i, buffer + (scales[i].next_window - buffer_start) );
+				progress.bases = bases_read;
 			}
 		}
 	}
-	return bytes_read;
+	free( buffer );
 }
 
-void print_counts_header( int generate_DAWG, DBL_WORD min_depth, DBL_WORD max_depth, DBL_WORD interval_size )
+void print_counts_header( FILE* out, int generate_DAWG, int sketch, DBL_WORD min_depth, DBL_WORD max_depth, DBL_WORD interval_size )
 {
 	int first_interval = 0;
 	int last_interval = 0;
 
-	printf("# LineNo, LineOffset, SeqOffset, ");
+	fprintf(out, "# LineNo, LineOffset, SeqOffset, ");
 	if (interval_size == 0)
 	{
-		printf("Nodes, Substrings, ");
+		fprintf(out, "Nodes, Substrings, ");
 	}
 	else
 	{
@@ -350,7 +564,7 @@ void print_counts_header( int generate_DAWG, DBL_WORD min_depth, DBL_WORD max_de
 		last_interval = min_depth + interval_size - 1;
 		while ( first_interval <= max_depth )
 		{
-			printf("Nodes(%d,%d), Substrings(%d,%d), ", first_interval, last_interval, first_interval, last_interval);
+			fprintf(out, "Nodes(%d,%d), Substrings(%d,%d), ", first_interval, last_interval, first_interval, last_interval);
 			first_interval += interval_size;
 			last_interval += interval_size;
 			if (last_interval > max_depth)
@@ -361,9 +575,257 @@ void print_counts_header( int generate_DAWG, DBL_WORD min_depth, DBL_WORD max_de
 	}
 	if (generate_DAWG)
 	{
-		printf("DAWG_Nodes, DAWG_Substrings, ");
+		fprintf(out, "DAWG_Nodes, DAWG_Substrings, ");
+	}
+	if (sketch)
+	{
+		for (first_interval = 0; first_interval < number_bins; first_interval++)
+		{
+			fprintf(out, "Error(%ld,%ld), ", bins[first_interval].start_depth, bins[first_interval].end_depth);
+		}
+	}
+	fprintf(out, "\n");
+}
+
+/* sketch class methods:
+ *
+ *    SKETCH estimates the same depth intervals without building trees.  Every base updates a rolling 2 bit
+ *    code, and the d-mer ending at that base (for each depth d from min depth to max depth + 1) is hashed into
+ *    a HyperLogLog sketch for that depth, so memory depends only on the depth range and the overlap, not the
+ *    window size.
+ *
+ *    Windows are cut into segments of (window size - overlap) bases, and a window's sketch is the register
+ *    maximum of its segments.  A d-mer belongs to the segment it ends in; the ones that start in the previous
+ *    segment go in a separate "head" sketch, which is left out when the segment is the first of a window.
+ *
+ *    The tree counts put the root at depth 1, so a node whose string has d bases is counted at depth d + 1.
+ *    The sketches keep those labels; per interval (a,b):
+ *
+ *       Nodes      ~ distinct (b-1)-mers - distinct (a-2)-mers, the branchings in the interval
+ *       Substrings ~ distinct substrings of length a-1 to b-1, millions and running total like the tree
+ *                    counts (without intervals, the plain count)
+ *       Error      one standard error of the interval's distinct substring estimate
+ */
+#define SKETCH_PRECISION 12
+#define SKETCH_REGISTERS (1L << SKETCH_PRECISION)
+
+typedef struct SKETCHSEGMENT
+{
+	/* (depth count) * SKETCH_REGISTERS registers each */
+	unsigned char* body;
+	unsigned char* head;
+	DBL_WORD location[3];
+} SKETCH_SEGMENT;
+
+int sketch_depths = 0;
+int sketch_segments = 0;
+SKETCH_SEGMENT* segments = NULL;
+unsigned char* sketch_window = NULL;
+double sketch_inverse_powers[65];
+
+unsigned long sketch_hash( unsigned long code )
+{
+	/* splitmix64 finalizer, spreads 2 bit codes over the whole word */
+	code ^= code >> 30;
+	code *= 0xbf58476d1ce4e5b9UL;
+	code ^= code >> 27;
+	code *= 0x94d049bb133111ebUL;
+	code ^= code >> 31;
+	return code;
+}
+
+void sketch_add( unsigned char* registers, unsigned long hash )
+{
+	unsigned long index = hash >> (64 - SKETCH_PRECISION);
+	unsigned long rest = (hash << SKETCH_PRECISION) | (1UL << (SKETCH_PRECISION - 1));
+	unsigned char rank = 1;
+
+	while ((rest & 0x8000000000000000UL) == 0)
+	{
+		rank++;
+		rest <<= 1;
+	}
+	if (rank > registers[index])
+	{
+		registers[index] = rank;
+	}
+}
+
+double sketch_estimate( unsigned char* registers )
+{
+	double sum = 0;
+	double estimate = 0;
+	double m = (double)SKETCH_REGISTERS;
+	long zeros = 0;
+	long i = 0;
+
+	for (i = 0; i < SKETCH_REGISTERS; i++)
+	{
+		sum += sketch_inverse_powers[registers[i]];
+		if (registers[i] == 0)
+		{
+			zeros++;
+		}
+	}
+	estimate = (0.7213/(1.0 + 1.079/m))*m*m/sum;
+	/* small range correction, linear counting */
+	if ((estimate <= 2.5*m) && (zeros > 0))
+	{
+		estimate = m*log(m/(double)zeros);
+	}
+	return estimate;
+}
+
+void allocate_sketches( DBL_WORD window_size, DBL_WORD overlap )
+{
+	DBL_WORD sketch_bytes = 0;
+	int i = 0;
+
+	sketch_depths = (int)(counts_max_depth - counts_min_depth) + 2;
+	sketch_segments = (int)(window_size/(window_size - overlap));
+	sketch_bytes = sketch_depths*SKETCH_REGISTERS;
+	segments = (SKETCH_SEGMENT*)malloc(sketch_segments*sizeof(SKETCH_SEGMENT));
+	for (i = 0; i < sketch_segments; i++)
+	{
+		segments[i].body = (unsigned char*)malloc(sketch_bytes);
+		segments[i].head = (unsigned char*)malloc(sketch_bytes);
+	}
+	sketch_window = (unsigned char*)malloc(sketch_bytes);
+	sketch_inverse_powers[0] = 1.0;
+	for (i = 1; i < 65; i++)
+	{
+		sketch_inverse_powers[i] = sketch_inverse_powers[i - 1]/2.0;
+	}
+}
+
+void sketch_start_segment( SKETCH_SEGMENT* segment )
+{
+	memset(segment->body, 0, sketch_depths*SKETCH_REGISTERS);
+	memset(segment->head, 0, sketch_depths*SKETCH_REGISTERS);
+	segment->location[0] = file_line_number;
+	segment->location[1] = file_line_offset;
+	segment->location[2] = sequence_offset;
+}
+
+/* merges the window's segments (oldest first) and prints the estimates for each interval */
+void sketch_print_window( FILE* out, int first_segment )
+{
+	double* distinct = (double*)malloc(sketch_depths*sizeof(double));
+	double substrings = 0;
+	double substring_total = 0;
+	double variance = 0;
+	double error = (1.04/sqrt((double)SKETCH_REGISTERS));
+	long start_depth = 0;
+	long end_depth = 0;
+	long d = 0;
+	long j = 0;
+	int i = 0;
+	int s = 0;
+	SKETCH_SEGMENT* segment = NULL;
+
+	for (d = 0; d < sketch_depths; d++)
+	{
+		memcpy(sketch_window, segments[first_segment].body + d*SKETCH_REGISTERS, SKETCH_REGISTERS);
+		for (s = 1; s < sketch_segments; s++)
+		{
+			segment = segments + (first_segment + s) % sketch_segments;
+			for (j = 0; j < SKETCH_REGISTERS; j++)
+			{
+				if (segment->body[d*SKETCH_REGISTERS + j] > sketch_window[j]) sketch_window[j] = segment->body[d*SKETCH_REGISTERS + j];
+				if (segment->head[d*SKETCH_REGISTERS + j] > sketch_window[j]) sketch_window[j] = segment->head[d*SKETCH_REGISTERS + j];
+			}
+		}
+		/* only the empty string has length 0 */
+		distinct[d] = (d + (long)counts_min_depth - 2 == 0) ? 1.0 : sketch_estimate( sketch_window );
+	}
+
+	segment = segments + first_segment;
+	fprintf(out, "%lu %lu %lu ", segment->location[0], segment->location[1], segment->location[2]);
+	for (i = 0; i < number_bins; i++)
+	{
+		start_depth = bins[i].start_depth;
+		end_depth = (bins[i].end_depth > (long)counts_max_depth) ? (long)counts_max_depth : bins[i].end_depth;
+		substrings = 0;
+		/* distinct[d - min depth + 1] holds the (d-1)-mers */
+		for (d = start_depth; d <= end_depth; d++)
+		{
+			substrings += distinct[d - counts_min_depth + 1];
+		}
+		substring_total += substrings;
+		bins[i].node_count = (DBL_WORD)((distinct[end_depth - counts_min_depth + 1] > distinct[start_depth - counts_min_depth]) ? (distinct[end_depth - counts_min_depth + 1] - distinct[start_depth - counts_min_depth]) : 0);
+		bins[i].substring_count = (DBL_WORD)substrings;
+		bins[i].substring_millions_count = (DBL_WORD)(substring_total/1000000.0);
+		/* raw counts or running millions, as generate_counts prints them */
+		if ((counts_max_depth == NO_DEPTH_LIMIT) || (counts_interval_size == 0))
+		{
+			fprintf(out, "%lu %lu ", bins[i].node_count, bins[i].substring_count);
+		}
+		else
+		{
+			fprintf(out, "%lu %lu ", bins[i].node_count, bins[i].substring_millions_count);
+		}
+	}
+	for (i = 0; i < number_bins; i++)
+	{
+		start_depth = bins[i].start_depth;
+		end_depth = (bins[i].end_depth > (long)counts_max_depth) ? (long)counts_max_depth : bins[i].end_depth;
+		variance = 0;
+		for (d = start_depth; d <= end_depth; d++)
+		{
+			variance += (error*distinct[d - counts_min_depth + 1])*(error*distinct[d - counts_min_depth + 1]);
+		}
+		fprintf(out, "%.0f ", sqrt(variance));
+	}
+	fprintf(out, "\n");
+	free( distinct );
+}
+
+void generate_sketches( FILE* file, DBL_WORD window_size, DBL_WORD overlap )
+{
+	DBL_WORD step = window_size - overlap;
+	DBL_WORD segment_offset = 0;
+	DBL_WORD bases_read = 0;
+	unsigned long code = 0;
+	unsigned long mask = 0;
+	unsigned char* registers = NULL;
+	int current_segment = 0;
+	int segments_filled = 0;
+	int in_comment = 0;
+	int cval = 0;
+	long d = 0;
+	long depth = 0;
+
+	sketch_start_segment( segments );
+	while ((cval = counts_fgetc( file, &in_comment )) != EOF)
+	{
+		if (cval == 0) continue;
+
+		code = (code << 2) | (cval == 'A' ? 0 : cval == 'C' ? 1 : cval == 'G' ? 2 : 3);
+		bases_read++;
+		for (d = 0; d < sketch_depths; d++)
+		{
+			depth = d + (long)counts_min_depth - 2;
+			if (depth == 0) continue;
+			if (bases_read < (DBL_WORD)depth) break;
+			mask = (depth == 32) ? ~0UL : ((1UL << (2*depth)) - 1);
+			registers = (segment_offset < (DBL_WORD)(depth - 1)) ? segments[current_segment].head : segments[current_segment].body;
+			sketch_add( registers + d*SKETCH_REGISTERS, sketch_hash( code & mask ) );
+		}
+
+		if (++segment_offset == step)
+		{
+			segments_filled++;
+			if (segments_filled >= sketch_segments)
+			{
+				sketch_print_window( stdout, (current_segment + 1) % sketch_segments );
+				progress.windows++;
+			}
+			progress.bases = bases_read;
+			current_segment = (current_segment + 1) % sketch_segments;
+			sketch_start_segment( segments + current_segment );
+			segment_offset = 0;
+		}
 	}
-	printf("\n");
 }
 
 /* command line parameter support methods */
@@ -424,6 +886,23 @@ void extract_long( DBL_WORD* long_val, int min_offset_to_check, int argc, char*
 	}
 }
 
+int extract_list( DBL_WORD* values, int max_values, const char* str )
+{
+	int count = 0;
+	char tokenizer_buffer[200];
+	char* token;
+
+	strncpy(tokenizer_buffer, str, sizeof(tokenizer_buffer) - 1);
+	tokenizer_buffer[sizeof(tokenizer_buffer) - 1] = 0;
+	token = strtok(tokenizer_buffer, ",");
+	while ((token != NULL) && (count < max_values))
+	{
+		values[count++] = atol(token);
+		token = strtok(NULL, ",");
+	}
+	return count;
+}
+
 int main(int argc, char* argv[])
 {
 	/* command line parameters */
@@ -432,15 +911,21 @@ int main(int argc, char* argv[])
 	DBL_WORD overlap = 0;
 	int generate_DAWG = 0;
 	int detect_left_diverse = 0;
+	int sketch = 0;
 	DBL_WORD min_depth = NO_DEPTH_LIMIT;
 	DBL_WORD max_depth = NO_DEPTH_LIMIT;
 	DBL_WORD interval_size = 0;
+	DBL_WORD window_sizes[MAX_SCALES];
+	DBL_WORD overlaps[MAX_SCALES];
+	int number_overlaps = 0;
+	char scale_file_name[1000];
 
 	/* internal data */
 	SUFFIX_TREE* tree = NULL;;
 	FILE* file = NULL;
 	unsigned char* data_buffer = NULL;
 	DBL_WORD* counts = NULL;
+	int i = 0;
 
 	/* Set up parameters, validate */
 	if (argc < 4) 
@@ -448,19 +933,40 @@ int main(int argc, char* argv[])
 		Usage();
 		exit(0);
 	}
+	METRICS_Init("centromere");
 	file_name = argv[1];
-	window_size = atol(argv[2]);
-	overlap = atol(argv[3]);
-
-	if (!valid_range( window_size, MIN_WINDOW_SIZE, MAX_WINDOW_SIZE ) || !valid_range( overlap, MIN_OVERLAP, MAX_OVERLAP ) || (window_size < overlap))
+	number_scales = extract_list( window_sizes, MAX_SCALES, argv[2] );
+	number_overlaps = extract_list( overlaps, MAX_SCALES, argv[3] );
+	if ((number_scales == 0) || ((number_overlaps != 1) && (number_overlaps != number_scales)))
 	{
 		Usage();
 		exit(0);
 	}
+	for (i = 0; i < number_scales; i++)
+	{
+		window_size = window_sizes[i];
+		overlap = (number_overlaps == 1) ? overlaps[0] : overlaps[i];
+		if (!valid_range( window_size, MIN_WINDOW_SIZE, MAX_WINDOW_SIZE ) || !valid_range( overlap, MIN_OVERLAP, MAX_OVERLAP ) || (window_size < overlap))
+		{
+			Usage();
+			exit(0);
+		}
+		/* a window can't overlap itself completely when the input is only read once */
+		if ((number_scales > 1) && (window_size == overlap))
+		{
+			Usage();
+			exit(0);
+		}
+		scales[i].window_size = window_size;
+		scales[i].overlap = overlap;
+	}
+	window_size = window_sizes[0];
+	overlap = scales[0].overlap;
 
 	extract_range( &min_depth, &max_depth, argc, argv );
 	extract_flag( &generate_DAWG, "DAWG", argc, argv );
 	extract_flag( &detect_left_diverse, "LEFT", argc, argv );
+	extract_flag( &sketch, "SKETCH", argc, argv );
 
 	/* 
 	 * Parameters:  centromere <file name> <window size> <overlap> [DAWG] [<min depth>-max depth>] [<interval size>]
@@ -472,26 +978,87 @@ int main(int argc, char* argv[])
 	/* everything checks out, run the algorithm */
 
 	/* open the file, read in chunks of 'window_size', create suffix tree, generate counts and print them, then back track in file by 'overlap', then repeat */
-	file = fopen((const char*)file_name, "r");
+	file = GZ_Open((const char*)file_name);
 	if (file == NULL)
 	{
 		printf("File '%s' NOT FOUND.\n", file_name);
 		exit(0);
 	}
-	data_buffer = (unsigned char*)malloc(window_size*sizeof(unsigned char));
 	allocate_counts( generate_DAWG, detect_left_diverse, min_depth, max_depth, interval_size );
+	fseek( file, 0, SEEK_END );
+	PROGRESS_Start( "centromere", (unsigned long)ftell( file ) );
+	fseek( file, 0, SEEK_SET );
+
+	/* approximate counts: needs a depth range, and whole segments of at least max depth + 1 bases */
+	if (sketch)
+	{
+		if ((number_scales > 1) || generate_DAWG || detect_left_diverse || (max_depth == NO_DEPTH_LIMIT) || (min_depth < 2) ||
+			(max_depth > MAX_SKETCH_DEPTH) || (min_depth > max_depth) || (window_size == overlap) ||
+			((window_size % (window_size - overlap)) != 0) || ((window_size - overlap) <= max_depth))
+		{
+			Usage();
+			exit(0);
+		}
+		allocate_sketches( window_size, overlap );
+		print_counts_header( stdout, 0, 1, min_depth, max_depth, interval_size );
+		METRICS_Start(METRICS_ANALYZE);
+		generate_sketches( file, window_size, overlap );
+		METRICS_Stop(METRICS_ANALYZE);
+		fclose( file );
+		return 0;
+	}
+
+	/* several scales: one profile file per scale, all from a single read of the file */
+	if (number_scales > 1)
+	{
+		for (i = 0; i < number_scales; i++)
+		{
+			sprintf(scale_file_name, "%s.w%luo%lu", file_name, scales[i].window_size, scales[i].overlap);
+			scales[i].out = fopen(scale_file_name, "w");
+			if (scales[i].out == NULL)
+			{
+				printf("File '%s' NOT CREATED.\n", scale_file_name);
+				exit(0);
+			}
+			scales[i].step = scales[i].window_size - scales[i].overlap;
+			scales[i].ring_size = scales[i].window_size/scales[i].step + 2;
+			scales[i].locations = (DBL_WORD*)malloc(scales[i].ring_size*3*sizeof(DBL_WORD));
+			scales[i].last_counts = (DBL_WORD*)malloc(number_counts*sizeof(DBL_WORD));
+			print_counts_header( scales[i].out, generate_DAWG, 0, min_depth, max_depth, interval_size );
+		}
+		generate_scales( file );
+		for (i = 0; i < number_scales; i++)
+		{
+			fclose( scales[i].out );
+			free( scales[i].locations );
+			free( scales[i].last_counts );
+		}
+		fclose( file );
+		return 0;
+	}
 
 	/* read in chunks of 'window_size', create suffix tree, generate counts, print them, back track by 'overlap' */
-	print_counts_header( generate_DAWG, min_depth, max_depth, interval_size );
+	data_buffer = (unsigned char*)malloc(window_size*sizeof(unsigned char));
+	print_counts_header( stdout, generate_DAWG, 0, min_depth, max_depth, interval_size );
+	METRICS_Start(METRICS_READ);
 	while (counts_fread( data_buffer, window_size, file, overlap ) == window_size)
 	{
+		METRICS_Stop(METRICS_READ);
+		progress.bases = sequence_offset;
+		progress.windows++;
 		tree = ST_CreateTree((const char*)data_buffer, window_size);
+		METRICS_Start(METRICS_ANALYZE);
 		generate_counts( tree );
-		print_counts();
+		METRICS_Stop(METRICS_ANALYZE);
+		METRICS_Start(METRICS_OUTPUT);
+		print_counts( stdout );
+		METRICS_Stop(METRICS_OUTPUT);
+		METRICS_Start(METRICS_READ);
 		fseek( file, -overlap, SEEK_CUR );
 		ST_DeleteTree( tree );
 		counts_location_adjust( overlap );
 	}
+	METRICS_Stop(METRICS_READ);
 	free( data_buffer );
 	free( counts );
 	return 0;
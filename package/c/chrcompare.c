@@ -1,17 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
 #include "suffix_tree.h"
+#include "metrics.h"
+#include "progress.h"
+#include "st_parallel.h"
+#include "st_index.h"
+#include "st_match.h"
+#include "stage_queue.h"
+#include "placement.h"
+#include "gz_input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
 void Usage()
 {
-	printf("Usage: chrcompare <file1> <start offset> <suffix tree string length> <file2> <segment size> <window size>\n");
+	printf("Usage: chrcompare <file1> <start offset> <suffix tree string length> <file2> <segment size> <window size> [<threshold config>|MEM|MUM]\n");
 	printf("\n");
 	printf(" Reads in <suffix tree string length> characters from <file1> starting at <start offset>\n");
 	printf(" then scans all of <file2> and in each <segment size> section, looks up each <window size>\n");
 	printf(" string in the suffix tree, and counts how many times the string was found in each section.\n");
 	printf(" \n");
 	printf(" Outputs 1 line per section, comma delimited: <section offset>,<section count>,<count for each segment>\n");
+	printf(" \n");
+	printf(" With a <threshold config> (lines of <direction>,<threshold>,<character>, as used by csv2grid.rb)\n");
+	printf(" outputs the grid instead: 1 line per <segment size> bucket of <file1>, 1 character per section\n");
+	printf(" of <file2>, the character of the first threshold exceeded by the forward ('f') or backward ('b')\n");
+	printf(" count, '0' if none.\n");
+	printf(" \n");
+	printf(" With MEM, outputs the maximal exact matches of at least <window size> bases between the\n");
+	printf(" <file1> section and both strands of <file2> (read <segment size> bytes at a time), 1 line\n");
+	printf(" per match: <strand>,<file1 offset>,<file2 offset>,<length>, offsets from 0; a '-' match\n");
+	printf(" is of the reverse complement of the <file2> bases at its offset.  With MUM, only those\n");
+	printf(" unique in both the section and the strand of <file2>.  Matches are found in linear time\n");
+	printf(" through suffix links, so the tree is built by Ukkonen's algorithm on one thread.\n");
+	printf(" \n");
+	printf(" The sections of <file2> go through a pipeline: a reader thread reads ahead, an encoder thread\n");
+	printf(" cuts the windows and their reverse complements, query threads look them up and the sections\n");
+	printf(" are written in order, so reads and lookups overlap.  GENOMEOT_METRICS reports each stage's\n");
+	printf(" utilization.\n");
+	printf(" \n");
+	printf(" With GENOMEOT_THREADS=<n> set, the suffix tree is built on <n> threads (0 for every core),\n");
+	printf(" and as many query threads look up the windows.\n");
+	printf(" With GENOMEOT_JUMP_K=<k> set, lookups start from a table of the 4^k strings of <k> bases.\n");
+	printf(" With GENOMEOT_FREEZE=1 set, a DNA tree is frozen into a compact search-only index once built.\n");
+	printf(" With GENOMEOT_HUGEPAGES, GENOMEOT_NUMA or GENOMEOT_PIN set, index memory and the build and query threads are placed (see placement.h).\n");
+	printf(" Input files may be gzip or BGZF compressed, they are read as they are (see gz_input.h).\n");
+}
+
+/* most lines read from a threshold config */
+#define MAX_THRESHOLDS 64
+/* sections of the grid held in memory, further columns are spilled to a temporary file */
+#define GRID_TILE_SECTIONS 4096
+
+typedef struct THRESHOLD
+{
+	char direction;
+	long boundary;
+	char cval;
+} THRESHOLD;
+
+THRESHOLD thresholds[MAX_THRESHOLDS];
+int number_thresholds = 0;
+
+/*
+ *  read_thresholds -- reads a threshold config, one <direction>,<threshold>,<character> per line
+ */
+int read_thresholds( const char* file_name )
+{
+	FILE* config;
+	char line[256];
+	char* boundary;
+	char* cval;
+
+	config = fopen(file_name, "r");
+	if (config == NULL)
+	{
+		return 0;
+	}
+	while (fgets(line, sizeof(line), config) != NULL && number_thresholds < MAX_THRESHOLDS)
+	{
+		boundary = strchr(line, ',');
+		if (boundary == NULL)
+		{
+			continue;
+		}
+		cval = strchr(boundary + 1, ',');
+		if (cval == NULL)
+		{
+			continue;
+		}
+		thresholds[number_thresholds].direction = line[0];
+		thresholds[number_thresholds].boundary = atol(boundary + 1);
+		thresholds[number_thresholds].cval = *(cval + 1);
+		number_thresholds++;
+	}
+	fclose(config);
+	return 1;
+}
+
+/*
+ *  grid_character -- the character of the first threshold the counts exceed, '0' if none
+ */
+char grid_character( int forward, int backward )
+{
+	int i;
+	for (i = 0; i < number_thresholds; i++)
+	{
+		if ((thresholds[i].direction == 'f' && forward > thresholds[i].boundary) ||
+			(thresholds[i].direction == 'b' && backward > thresholds[i].boundary))
+		{
+			return thresholds[i].cval;
+		}
+	}
+	return '0';
+}
+
+/*
+ *  The grid is transposed: sections arrive one at a time as columns, rows are the buckets.
+ *  Columns are gathered into a tile of GRID_TILE_SECTIONS columns (bucket major); a full tile
+ *  is appended to a temporary file so memory stays at one tile however long <file2> is.
+ */
+unsigned char* grid_tile = NULL;
+int grid_rows = 0;
+int grid_tile_columns = 0;
+int grid_spilled_tiles = 0;
+FILE* grid_spill = NULL;
+
+void grid_add_column( int* buckets, int* backward_buckets )
+{
+	int i;
+	if (grid_tile_columns == GRID_TILE_SECTIONS)
+	{
+		if (grid_spill == NULL)
+		{
+			grid_spill = tmpfile();
+			if (grid_spill == NULL)
+			{
+				printf("Could not create temporary file.\n");
+				exit(0);
+			}
+		}
+		fwrite( grid_tile, 1, grid_rows*GRID_TILE_SECTIONS, grid_spill );
+		grid_spilled_tiles++;
+		grid_tile_columns = 0;
+	}
+	for (i = 0; i < grid_rows; i++) {
+		*(grid_tile + i*GRID_TILE_SECTIONS + grid_tile_columns) = grid_character( *(buckets + i), *(backward_buckets + i) );
+	}
+	grid_tile_columns++;
+}
+
+void grid_print()
+{
+	unsigned char* tile_row = NULL;
+	int i;
+	int tile;
+
+	if (grid_spilled_tiles == 0 && grid_tile_columns == 0)
+	{
+		return;
+	}
+	tile_row = (unsigned char*)malloc(GRID_TILE_SECTIONS);
+	for (i = 0; i < grid_rows; i++) {
+		for (tile = 0; tile < grid_spilled_tiles; tile++) {
+			fseek( grid_spill, ((long)tile*grid_rows + i)*GRID_TILE_SECTIONS, SEEK_SET );
+			fread( tile_row, 1, GRID_TILE_SECTIONS, grid_spill );
+			fwrite( tile_row, 1, GRID_TILE_SECTIONS, stdout );
+		}
+		fwrite( grid_tile + i*GRID_TILE_SECTIONS, 1, grid_tile_columns, stdout );
+		printf("\n");
+	}
+	free( tile_row );
+	if (grid_spill != NULL)
+	{
+		fclose( grid_spill );
+	}
 }
 
 
@@ -57,6 +223,442 @@ void reverse_complement( char* buf, int window_size )
 	}
 }
 
+/*
+ *  read_strand -- reads <count> bases from <done> on of a strand of a file of <size> bytes,
+ *  the reverse strand being the reverse complement of the file
+ */
+void read_strand( FILE* file, long size, long done, long count, char* buffer, int reverse )
+{
+	fseek( file, reverse ? size - done - count : done, SEEK_SET );
+	fread( buffer, 1, count, file );
+	if (reverse)
+	{
+		reverse_complement( buffer, (int)count );
+	}
+}
+
+/*
+ *  print_anchors -- prints maximal matches, <strand>,<file1 offset>,<file2 offset>,<length>
+ */
+void print_anchors( ST_ANCHOR* anchors, DBL_WORD number_anchors, DBL_WORD start_offset, long size, int reverse )
+{
+	DBL_WORD i;
+
+	for (i = 0; i < number_anchors; i++)
+	{
+		printf("%c,%lu,%lu,%lu\n", reverse ? '-' : '+', start_offset + anchors[i].text_position - 1,
+			reverse ? size - anchors[i].query_position - anchors[i].length : anchors[i].query_position,
+			anchors[i].length);
+	}
+}
+
+/*
+ *  scan_anchors -- streams a strand of file2 past the tree, a segment at a time, and prints its
+ *  maximal matches (MUMs only when unique, once the strand is done)
+ */
+void scan_anchors( SUFFIX_TREE* tree, FILE* file, long size, DBL_WORD segment_size, DBL_WORD min_length,
+	int unique, DBL_WORD start_offset, int reverse )
+{
+	/* a match is at most the tree string, the buffer holds it, the base before it and a segment */
+	DBL_WORD capacity = tree->length + segment_size + 1;
+	char* buffer = (char*)malloc(capacity);
+	DBL_WORD start = 0, filled = 0, keep = 0, j = 0, i = 0, first = 0;
+	DBL_WORD number_anchors = 0, allocated = 0;
+	long done = 0, count = 0;
+	ST_MATCH match;
+	ST_ANCHOR* anchors = NULL;
+
+	if (buffer == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	ST_MatchStart( tree, &match );
+	for (;;)
+	{
+		/* buffer[0] is base <start> of the strand, the match of base j runs to the end of the buffer */
+		while (!ST_MatchExtend( tree, &match, buffer + (j - start), filled - (j - start) ) && done < size)
+		{
+			METRICS_Stop(METRICS_QUERY);
+			METRICS_Start(METRICS_READ);
+			keep = j > start ? j - 1 : j;
+			memmove( buffer, buffer + (keep - start), start + filled - keep );
+			filled -= keep - start;
+			start = keep;
+			count = size - done < (long)segment_size ? size - done : (long)segment_size;
+			read_strand( file, size, done, count, buffer + filled, reverse );
+			filled += count;
+			done += count;
+			progress.bases += count;
+			METRICS_Stop(METRICS_READ);
+			METRICS_Start(METRICS_QUERY);
+		}
+		if (j - start >= filled)
+		{
+			break;
+		}
+		first = number_anchors;
+		ST_MatchMaximal( tree, &match, buffer + (j - start), j > 0 ? buffer[j - 1 - start] : 0, min_length, unique,
+			&anchors, &number_anchors, &allocated );
+		for (i = first; i < number_anchors; i++)
+		{
+			anchors[i].query_position = j;
+		}
+		if (!unique && number_anchors > 0)
+		{
+			print_anchors( anchors, number_anchors, start_offset, size, reverse );
+			number_anchors = 0;
+		}
+		ST_MatchNext( tree, &match, buffer + (j - start) );
+		j++;
+	}
+	if (unique)
+	{
+		number_anchors = ST_UniqueMatches( anchors, number_anchors );
+		print_anchors( anchors, number_anchors, start_offset, size, reverse );
+	}
+	free( anchors );
+	free( buffer );
+}
+
+/* sections of file2 in flight per query thread, and more for the reader and the encoder */
+#define SECTIONS_PER_WORKER 2
+#define SECTIONS_AHEAD 4
+/* stages of the pipeline, as reported */
+#define STAGE_READ 0
+#define STAGE_ENCODE 1
+#define STAGE_QUERY 2
+#define STAGE_WRITE 3
+
+/* a section of file2 on its way through the pipeline */
+typedef struct SECTION
+{
+	long number;
+	/* the bases read, and zeros past them for a last window that runs over */
+	unsigned char* bases;
+	/* each window, as the serial loop copied it, and its reverse complement */
+	unsigned char* forward;
+	unsigned char* backward;
+	int forward_count;
+	int backward_count;
+	int* buckets;
+	int* backward_buckets;
+} SECTION;
+
+/* the stages and the queues between them: free sections -> reader -> encoder -> query threads -> writer */
+typedef struct PIPELINE
+{
+	FILE* file;
+	SUFFIX_TREE* tree;
+	ST_INDEX* index;
+	DBL_WORD segment_size;
+	DBL_WORD window_size;
+	DBL_WORD windows;
+	int buckets_per_segment;
+	int workers;
+	STAGE_QUEUE* free_sections;
+	STAGE_QUEUE* read_sections;
+	STAGE_QUEUE* encoded_sections;
+	STAGE_QUEUE* counted_sections;
+	/* the read, encode, query and write stages, then one per query thread */
+	METRICS_STAGE* stages;
+} PIPELINE;
+
+/* the reader: fills free sections from file2 until a segment is short, then passes on the end */
+void* read_sections( void* argument )
+{
+	PIPELINE* pipeline = (PIPELINE*)argument;
+	METRICS_STAGE* stage = pipeline->stages + STAGE_READ;
+	SECTION* section = NULL;
+	long number = 0;
+	double start = 0;
+	int full = 0;
+
+	for (;;)
+	{
+		stage->input_wait_seconds += STAGE_Pop( pipeline->free_sections, (void**)&section );
+		start = METRICS_Now();
+		full = fread( section->bases, 1, pipeline->segment_size, pipeline->file ) == pipeline->segment_size;
+		stage->busy_seconds += METRICS_Now() - start;
+		if (!full)
+		{
+			break;
+		}
+		section->number = number++;
+		stage->items++;
+		stage->output_wait_seconds += STAGE_Push( pipeline->read_sections, section );
+	}
+	stage->output_wait_seconds += STAGE_Push( pipeline->read_sections, NULL );
+	return NULL;
+}
+
+/* the encoder: cuts each window of a section and its reverse complement; the end goes to every query thread */
+void* encode_sections( void* argument )
+{
+	PIPELINE* pipeline = (PIPELINE*)argument;
+	METRICS_STAGE* stage = pipeline->stages + STAGE_ENCODE;
+	SECTION* section = NULL;
+	DBL_WORD window_size = pipeline->window_size;
+	DBL_WORD offset = 0;
+	unsigned char* window = NULL;
+	double start = 0;
+	int i = 0;
+
+	for (;;)
+	{
+		stage->input_wait_seconds += STAGE_Pop( pipeline->read_sections, (void**)&section );
+		if (section == NULL)
+		{
+			break;
+		}
+		start = METRICS_Now();
+		for (offset = 0; offset < pipeline->windows; offset++)
+		{
+			window = section->forward + offset*window_size;
+			strncpy( (char*)window, (const char*)section->bases + offset*window_size, window_size );
+			memcpy( section->backward + offset*window_size, window, window_size );
+			reverse_complement( (char*)section->backward + offset*window_size, window_size );
+		}
+		stage->busy_seconds += METRICS_Now() - start;
+		stage->items++;
+		stage->output_wait_seconds += STAGE_Push( pipeline->encoded_sections, section );
+	}
+	for (i = 0; i < pipeline->workers; i++)
+	{
+		stage->output_wait_seconds += STAGE_Push( pipeline->encoded_sections, NULL );
+	}
+	return NULL;
+}
+
+/* searches the frozen index if there is one, the tree if not */
+DBL_WORD find_window( SUFFIX_TREE* tree, ST_INDEX* index, char* window, DBL_WORD window_size )
+{
+	if (index != NULL)
+	{
+		return STI_FindSubstring( index, window, window_size );
+	}
+	return ST_FindSubstring( tree, window, window_size );
+}
+
+/* a query thread: looks up the windows of a section both ways and counts them per bucket of file1 */
+void* query_sections( void* argument )
+{
+	PIPELINE* pipeline = ((PIPELINE**)argument)[0];
+	METRICS_STAGE* stage = ((METRICS_STAGE**)argument)[1];
+	METRICS_COUNTERS counters;
+	SECTION* section = NULL;
+	DBL_WORD window_size = pipeline->window_size;
+	DBL_WORD segment_size = pipeline->segment_size;
+	DBL_WORD offset = 0;
+	DBL_WORD position = 0;
+	double start = 0;
+	int i = 0;
+
+	/* worker i (of stages[4 + i]) runs on the i-th core with GENOMEOT_PIN */
+	PLACEMENT_PinThread( stage - pipeline->stages - 4 );
+	/* the lookups of the workers are counted apart and added up by section */
+	METRICS_ThreadCounters( &counters );
+	for (;;)
+	{
+		stage->input_wait_seconds += STAGE_Pop( pipeline->encoded_sections, (void**)&section );
+		if (section == NULL)
+		{
+			break;
+		}
+		start = METRICS_Now();
+		section->forward_count = 0;
+		section->backward_count = 0;
+		for (i = 0; i < pipeline->buckets_per_segment; i++) {
+			*(section->buckets + i) = 0;
+			*(section->backward_buckets + i) = 0;
+		}
+		for (offset = 0; offset < pipeline->windows; offset++)
+		{
+			if ((position = find_window( pipeline->tree, pipeline->index, (char*)section->forward + offset*window_size, window_size )) != ST_ERROR)
+			{
+				section->forward_count++;
+				i = (int)(position/segment_size);
+				if (i < pipeline->buckets_per_segment) {
+					*(section->buckets + i) += 1;
+				}
+			}
+			if ((position = find_window( pipeline->tree, pipeline->index, (char*)section->backward + offset*window_size, window_size )) != ST_ERROR)
+			{
+				section->backward_count++;
+				i = (int)(position/segment_size);
+				if (i < pipeline->buckets_per_segment) {
+					*(section->backward_buckets + i) += 1;
+				}
+			}
+		}
+		stage->busy_seconds += METRICS_Now() - start;
+		stage->items++;
+		METRICS_AddCounters();
+		stage->output_wait_seconds += STAGE_Push( pipeline->counted_sections, section );
+	}
+	METRICS_ThreadCounters( NULL );
+	stage->output_wait_seconds += STAGE_Push( pipeline->counted_sections, NULL );
+	return NULL;
+}
+
+/* the writer: prints a section's line (or grid column) once those before it are out, and frees it for the reader */
+void write_section( PIPELINE* pipeline, SECTION* section )
+{
+	int i = 0;
+
+	progress.bases += pipeline->segment_size;
+	progress.windows++;
+	if (grid_tile != NULL)
+	{
+		grid_add_column( section->buckets, section->backward_buckets );
+		return;
+	}
+	printf("%ld,%d,%d", section->number, section->forward_count, section->backward_count );
+	for (i = 0; i < pipeline->buckets_per_segment; i++) {
+		printf(",%d", *(section->buckets + i));
+	}
+	for (i = 0; i < pipeline->buckets_per_segment; i++) {
+		printf(",%d", *(section->backward_buckets + i));
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+/*
+ *  compare_sections -- counts the windows of each <segment size> section of file2 found in the tree (or
+ *  index), reading, encoding, looking up and writing on threads of their own with bounded queues between
+ *  them; the sections are written in file order
+ */
+void compare_sections( PIPELINE* pipeline )
+{
+	int number_sections = pipeline->workers*SECTIONS_PER_WORKER + SECTIONS_AHEAD;
+	int capacity = number_sections + pipeline->workers;
+	SECTION* sections = (SECTION*)calloc(number_sections, sizeof(SECTION));
+	SECTION** pending = (SECTION**)calloc(number_sections, sizeof(SECTION*));
+	SECTION* section = NULL;
+	void** arguments = (void**)malloc(2*pipeline->workers*sizeof(void*));
+	pthread_t* threads = (pthread_t*)malloc((pipeline->workers + 2)*sizeof(pthread_t));
+	METRICS_STAGE* stage = NULL;
+	METRICS_STAGE* writer = NULL;
+	long next = 0;
+	double start = METRICS_Now();
+	double write_start = 0;
+	int ended = 0;
+	int i = 0;
+
+	pipeline->stages = (METRICS_STAGE*)calloc(4 + pipeline->workers, sizeof(METRICS_STAGE));
+	if (sections == NULL || pending == NULL || arguments == NULL || threads == NULL || pipeline->stages == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	pipeline->free_sections = STAGE_CreateQueue( capacity );
+	pipeline->read_sections = STAGE_CreateQueue( capacity );
+	pipeline->encoded_sections = STAGE_CreateQueue( capacity );
+	pipeline->counted_sections = STAGE_CreateQueue( capacity );
+	for (i = 0; i < number_sections; i++)
+	{
+		sections[i].bases = (unsigned char*)calloc(pipeline->segment_size + pipeline->window_size + 1, 1);
+		sections[i].forward = (unsigned char*)malloc(pipeline->windows*pipeline->window_size + 1);
+		sections[i].backward = (unsigned char*)malloc(pipeline->windows*pipeline->window_size + 1);
+		sections[i].buckets = (int*)malloc((pipeline->buckets_per_segment + 1)*sizeof(int));
+		sections[i].backward_buckets = (int*)malloc((pipeline->buckets_per_segment + 1)*sizeof(int));
+		if (sections[i].bases == NULL || sections[i].forward == NULL || sections[i].backward == NULL
+			|| sections[i].buckets == NULL || sections[i].backward_buckets == NULL)
+		{
+			printf("\nOut of memory.\n");
+			exit(0);
+		}
+		STAGE_Push( pipeline->free_sections, sections + i );
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	/* the reader goes through file2 once, front to back */
+	posix_fadvise( fileno( pipeline->file ), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+	if (pthread_create( threads, NULL, read_sections, pipeline ) != 0
+		|| pthread_create( threads + 1, NULL, encode_sections, pipeline ) != 0)
+	{
+		printf("Could not start threads.\n");
+		exit(1);
+	}
+	for (i = 0; i < pipeline->workers; i++)
+	{
+		arguments[2*i] = pipeline;
+		arguments[2*i + 1] = pipeline->stages + 4 + i;
+		if (pthread_create( threads + 2 + i, NULL, query_sections, arguments + 2*i ) != 0)
+		{
+			printf("Could not start threads.\n");
+			exit(1);
+		}
+	}
+
+	/* write here: hold sections that come early until those before them are out */
+	writer = pipeline->stages + STAGE_WRITE;
+	while (ended < pipeline->workers)
+	{
+		writer->input_wait_seconds += STAGE_Pop( pipeline->counted_sections, (void**)&section );
+		if (section == NULL)
+		{
+			ended++;
+			continue;
+		}
+		pending[section->number % number_sections] = section;
+		while ((section = pending[next % number_sections]) != NULL)
+		{
+			pending[next % number_sections] = NULL;
+			write_start = METRICS_Now();
+			write_section( pipeline, section );
+			writer->busy_seconds += METRICS_Now() - write_start;
+			writer->items++;
+			writer->output_wait_seconds += STAGE_Push( pipeline->free_sections, section );
+			next++;
+		}
+	}
+	for (i = 0; i < pipeline->workers + 2; i++)
+	{
+		pthread_join( threads[i], NULL );
+	}
+
+	/* one stage for the query threads */
+	stage = pipeline->stages + STAGE_QUERY;
+	for (i = 0; i < pipeline->workers; i++)
+	{
+		stage->items += stage[2 + i].items;
+		stage->busy_seconds += stage[2 + i].busy_seconds;
+		stage->input_wait_seconds += stage[2 + i].input_wait_seconds;
+		stage->output_wait_seconds += stage[2 + i].output_wait_seconds;
+	}
+	pipeline->stages[STAGE_READ].name = "read";
+	pipeline->stages[STAGE_ENCODE].name = "encode";
+	pipeline->stages[STAGE_QUERY].name = "query";
+	pipeline->stages[STAGE_WRITE].name = "write";
+	for (i = 0; i <= STAGE_WRITE; i++)
+	{
+		pipeline->stages[i].threads = i == STAGE_QUERY ? pipeline->workers : 1;
+		pipeline->stages[i].wall_seconds = METRICS_Now() - start;
+		METRICS_Stage( pipeline->stages + i );
+	}
+
+	for (i = 0; i < number_sections; i++)
+	{
+		free( sections[i].bases );
+		free( sections[i].forward );
+		free( sections[i].backward );
+		free( sections[i].buckets );
+		free( sections[i].backward_buckets );
+	}
+	STAGE_DeleteQueue( pipeline->free_sections );
+	STAGE_DeleteQueue( pipeline->read_sections );
+	STAGE_DeleteQueue( pipeline->encoded_sections );
+	STAGE_DeleteQueue( pipeline->counted_sections );
+	free( pipeline->stages );
+	free( sections );
+	free( pending );
+	free( arguments );
+	free( threads );
+}
+
 int main(int argc, char* argv[])
 {
 	/* command line parameters */
@@ -69,21 +671,15 @@ int main(int argc, char* argv[])
 
 	/* internal data */
 	SUFFIX_TREE* tree = NULL;;
+	ST_INDEX* index = NULL;
 	FILE* inFile1 = NULL;
 	FILE* inFile2 = NULL;
 	unsigned char* data_buffer = NULL;
-	unsigned char* data_buffer2 = NULL;
-	unsigned char* window = NULL;
-	unsigned char* scanner = NULL;
-	int offset = 0;
-	int forward_count = 0;
-	int backward_count = 0;
-	int section_number = 0;
+	PIPELINE pipeline;
 	int buckets_per_segment = 10;
-	int* buckets;
-	int* backward_buckets;
-	int i = 0;
-	DBL_WORD position;
+	DBL_WORD threads = ST_Threads();
+	int anchors = 0;
+	long file2_size = 0;
 
 	/* Set up parameters, validate */
 	if (argc < 7) 
@@ -91,6 +687,7 @@ int main(int argc, char* argv[])
 		Usage();
 		exit(0);
 	}
+	METRICS_Init("chrcompare");
 	file1 = argv[1];
 	start_offset = atol(argv[2]);
 	suffix_tree_string_length = atol(argv[3]);
@@ -98,78 +695,106 @@ int main(int argc, char* argv[])
 	segment_size = atol(argv[5]);
 	window_size = atol(argv[6]);
 	buckets_per_segment = (int)(suffix_tree_string_length/segment_size);
-	buckets = (int*)malloc(buckets_per_segment*sizeof(int));
-	backward_buckets = (int*)malloc(buckets_per_segment*sizeof(int));
+	if (argc > 7 && (strcmp(argv[7], "MEM") == 0 || strcmp(argv[7], "MUM") == 0))
+	{
+		anchors = argv[7][1];
+	}
+	else if (argc > 7)
+	{
+		if (!read_thresholds(argv[7]))
+		{
+			printf("File '%s' NOT FOUND.\n", argv[7]);
+			exit(0);
+		}
+		grid_rows = buckets_per_segment;
+		grid_tile = (unsigned char*)malloc(grid_rows*GRID_TILE_SECTIONS + 1);
+	}
 
 	/* open the file, scan to offset, read in characters, create suffix tree */
-	inFile1 = fopen((const char*)file1, "r");
+	inFile1 = GZ_Open((const char*)file1);
 	if (inFile1 == NULL)
 	{
 		printf("File '%s' NOT FOUND.\n", file1);
 		exit(0);
 	}
 	data_buffer = (unsigned char*)malloc(suffix_tree_string_length*sizeof(unsigned char));
+	METRICS_Start(METRICS_READ);
 	fseek( inFile1, start_offset, SEEK_CUR );
 	fread( data_buffer, 1, suffix_tree_string_length, inFile1 );
-	tree = ST_CreateTree((const char*)data_buffer, suffix_tree_string_length);
+	METRICS_Stop(METRICS_READ);
 
-	/* open the second file, read in chunks, match each section against suffix tree */
-	inFile2 = fopen((const char*)file2, "r");
+	/* open the second file (its size is the progress total), read in chunks, match each section against suffix tree */
+	inFile2 = GZ_Open((const char*)file2);
 	if (inFile2 == NULL)
 	{
 		printf("File '%s' NOT FOUND.\n", file2);
 		exit(0);
 	}
-	data_buffer2 = (unsigned char*)malloc(segment_size);
-	window = (unsigned char*)malloc( window_size + 1 );
-	*(window + window_size) = 0;
-	section_number = 0;
-
-	while ( fread( data_buffer2, 1, segment_size, inFile2 ) == segment_size )
+	fseek( inFile2, 0, SEEK_END );
+	file2_size = ftell( inFile2 );
+	fseek( inFile2, 0, SEEK_SET );
+	if (anchors)
 	{
-		offset = 0;
-		forward_count = 0;
-		backward_count = 0;
-		scanner = data_buffer2;
-		for (i = 0; i < buckets_per_segment; i++) {
-			*(buckets + i) = 0;
-			*(backward_buckets + i) = 0;
-		}
-		while ( offset < segment_size )
-		{
-			strncpy( window, scanner, window_size );
-			if ((position = ST_FindSubstring( tree, window, window_size )) != ST_ERROR)
-			{
-				forward_count++;
-				i = (int)(position/segment_size);
-				if (i < buckets_per_segment) {
-					*(buckets + i) += 1;
-				}
-			}
-			reverse_complement( window, window_size );
-			if ((position = ST_FindSubstring( tree, window, window_size )) != ST_ERROR)
-			{
-				backward_count++;
-				i = (int)(position/segment_size);
-				if (i < buckets_per_segment) {
-					*(backward_buckets + i) += 1;
-				}
-			}
-			scanner += window_size;
-			offset += window_size;
-		}
-		printf("%d,%d,%d", section_number++, forward_count, backward_count );
-		for (i = 0; i < buckets_per_segment; i++) {
-			printf(",%d", *(buckets + i));
-		}
-		for (i = 0; i < buckets_per_segment; i++) {
-			printf(",%d", *(backward_buckets + i));
-		}
-		printf("\n");
-		fflush(stdout);
-
+		/* both strands, with the suffix links of Ukkonen's tree */
+		PROGRESS_Start( "chrcompare", 2 * (unsigned long)file2_size );
+		tree = ST_CreateTree((const char*)data_buffer, suffix_tree_string_length);
+		ST_MatchMarks( tree );
+		METRICS_Start(METRICS_QUERY);
+		scan_anchors( tree, inFile2, file2_size, segment_size, window_size, anchors == 'U', start_offset, 0 );
+		scan_anchors( tree, inFile2, file2_size, segment_size, window_size, anchors == 'U', start_offset, 1 );
+		METRICS_Stop(METRICS_QUERY);
+		fclose( inFile2 );
+		ST_DeleteTree( tree );
+		free( data_buffer );
+		return 0;
 	}
-	free( data_buffer2 );
+	PROGRESS_Start( "chrcompare", (unsigned long)file2_size );
+	if (threads == 1)
+	{
+		tree = ST_CreateTree((const char*)data_buffer, suffix_tree_string_length);
+	}
+	else
+	{
+		tree = ST_CreateTreeParallel((const char*)data_buffer, suffix_tree_string_length, threads);
+	}
+	if (STI_Frozen() && (index = ST_Freeze(tree, 0)) != NULL)
+	{
+		/* the tree is not searched any more, ST_ERROR becomes the index's */
+		ST_DeleteTree(tree);
+		tree = NULL;
+		ST_ERROR = STI_ERROR;
+	}
+	else
+	{
+		ST_BuildJumpTable(tree, ST_JumpK());
+	}
+	pipeline.file = inFile2;
+	pipeline.tree = tree;
+	pipeline.index = index;
+	pipeline.segment_size = segment_size;
+	pipeline.window_size = window_size;
+	pipeline.windows = (segment_size + window_size - 1)/window_size;
+	pipeline.buckets_per_segment = buckets_per_segment;
+	pipeline.workers = threads == 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : (int)threads;
+	if (pipeline.workers < 1)
+	{
+		pipeline.workers = 1;
+	}
+	METRICS_Start(METRICS_QUERY);
+	compare_sections( &pipeline );
+	METRICS_Stop(METRICS_QUERY);
+	if (grid_tile != NULL)
+	{
+		METRICS_Start(METRICS_OUTPUT);
+		grid_print();
+		METRICS_Stop(METRICS_OUTPUT);
+		free( grid_tile );
+	}
+	fclose( inFile2 );
 	free( data_buffer );
+	if (index != NULL)
+	{
+		STI_Close( index );
+	}
 	return 0;
 }
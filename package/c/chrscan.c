@@ -0,0 +1,454 @@
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "progress.h"
+#include "st_match.h"
+#include "gz_input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Usage()
+{
+	printf("Usage: chrscan <query file> <segment size> <window size> <output prefix> <target file1> [<target file2>...<target fileN>]\n");
+	printf("\n");
+	printf(" Builds one generalized suffix tree over all the target files (for instance every chromosome\n");
+	printf(" of a species), then scans <query file> once: in each <segment size> section, each\n");
+	printf(" <window size> string and its reverse complement are looked up, and each hit is counted\n");
+	printf(" for every target it is in, in the <segment size> bucket of its first occurrence there.\n");
+	printf("\n");
+	printf(" Writes <output prefix><target name> for each target (the name is the target file name up\n");
+	printf(" to its first '.'), 1 line per section, in the format of\n");
+	printf("   chrcompare <target file> 0 <target length> <query file> <segment size> <window size>\n");
+	printf(" so one scan replaces a chrcompare run per target, with the same lines.\n");
+	printf(" Input files may be gzip or BGZF compressed, they are read as they are (see gz_input.h).\n");
+	printf(" Prints <target number>,<target file>,<length>,<hits> for each target.\n");
+}
+
+char complement( char cval )
+{
+	if (cval == 'A') return 'T';
+	else if (cval == 'C') return 'G';
+	else if (cval == 'G') return 'C';
+	else if (cval == 'T') return 'A';
+	return 'x';
+}
+
+void reverse_complement( char* buf, int window_size )
+{
+	int first_offset = 0;
+	int last_offset = window_size - 1;
+	char temp;
+	while (first_offset < last_offset)
+	{
+		temp = *(buf + first_offset);
+		*(buf + first_offset) = complement(*(buf + last_offset));
+		*(buf + last_offset) = complement( temp );
+		first_offset++;
+		last_offset--;
+	}
+	if (first_offset == last_offset)
+	{
+		*(buf + first_offset) = complement(*(buf + first_offset));
+	}
+}
+
+/* One target sequence and its counts for the current section */
+typedef struct TARGET
+{
+	char* file_name;
+	char* data;
+	DBL_WORD length;
+	int buckets_per_segment;
+	int* buckets;
+	int* backward_buckets;
+	int forward_count;
+	int backward_count;
+	long total_hits;
+	FILE* out;
+	/* offset of the first occurrence under the node being marked, -1 if it is not in the target */
+	long first;
+} TARGET;
+
+/* the first occurrence of a target under an internal node; the entries of a node are a run of
+ * them (at its leaf_count, chrscan counts no leaves) ended by a target of -1 */
+typedef struct FIRST
+{
+	int target;
+	long first;
+} FIRST;
+
+/* name of a file, without folders and from the first '.', as extractFileName in the ruby scripts */
+void target_name( char* name, const char* path )
+{
+	const char* start = strrchr(path, '/');
+	char* dot;
+	strcpy(name, start == NULL ? path : start + 1);
+	dot = strchr(name, '.');
+	if (dot != NULL)
+	{
+		*dot = 0;
+	}
+}
+
+/* From suffix_tree.c */
+NODE* find_son(SUFFIX_TREE* tree, NODE* node, char character);
+
+/* the node whose subtree holds the occurrences of a window (the path of the window ends on it or on
+ * its incoming edge), NULL if the window is not in the tree */
+NODE* find_locus( SUFFIX_TREE* tree, const char* window, DBL_WORD window_size )
+{
+	ST_MATCH match;
+
+	metrics_lookups->lookups++;
+	ST_MatchStart( tree, &match );
+	ST_MatchExtend( tree, &match, window, window_size );
+	if (match.length < window_size)
+	{
+		return NULL;
+	}
+	metrics_lookups->found++;
+	metrics_lookups->matched += window_size;
+	if (match.length > match.depth)
+	{
+		return find_son( tree, match.node, window[match.depth] );
+	}
+	return match.node;
+}
+
+/* appends an entry to the runs of first occurrences */
+void add_first( FIRST** firsts, DBL_WORD* number_firsts, DBL_WORD* allocated, int target, long first )
+{
+	if (*number_firsts == *allocated)
+	{
+		*allocated = *allocated == 0 ? 1024 : *allocated*2;
+		*firsts = (FIRST*)realloc(*firsts, *allocated*sizeof(FIRST));
+		if (*firsts == NULL)
+		{
+			printf("\nOut of memory.\n");
+			exit(0);
+		}
+	}
+	(*firsts)[*number_firsts].target = target;
+	(*firsts)[*number_firsts].first = first;
+	(*number_firsts)++;
+}
+
+/* keeps the smaller of two occurrences of a target in its first; <seen> gets the targets met */
+void note_first( TARGET* targets, int target, long first, int* seen, int* number_seen )
+{
+	if (targets[target].first < 0)
+	{
+		seen[(*number_seen)++] = target;
+		targets[target].first = first;
+	}
+	else if (first < targets[target].first)
+	{
+		targets[target].first = first;
+	}
+}
+
+/* marks every internal node with the first occurrence of each target under it, once after the
+ * tree is built: each node after its sons (through the father pointers, as ST_MatchMarks), from
+ * their leaves and their runs, so a window is counted from its locus without walking its leaves */
+FIRST* mark_firsts( SUFFIX_TREE* tree, TARGET* targets, int* seen )
+{
+	NODE* node = tree->root;
+	NODE* son;
+	FIRST* firsts = NULL;
+	DBL_WORD number_firsts = 0;
+	DBL_WORD allocated = 0;
+	DBL_WORD offset;
+	DBL_WORD f;
+	int number_seen;
+	int t;
+
+	while (node->sons != NULL)
+	{
+		node = node->sons;
+	}
+	for (;;)
+	{
+		if (node->sons != NULL)
+		{
+			number_seen = 0;
+			for (son = node->sons; son != NULL; son = son->right_sibling)
+			{
+				if (son->sons == NULL)
+				{
+					t = (int)ST_SequenceOf(tree, son->path_position, &offset);
+					note_first(targets, t, (long)offset, seen, &number_seen);
+				}
+				else
+				{
+					for (f = son->leaf_count; firsts[f].target >= 0; f++)
+					{
+						note_first(targets, firsts[f].target, firsts[f].first, seen, &number_seen);
+					}
+				}
+			}
+			node->leaf_count = number_firsts;
+			for (t = 0; t < number_seen; t++)
+			{
+				add_first(&firsts, &number_firsts, &allocated, seen[t], targets[seen[t]].first);
+				targets[seen[t]].first = -1;
+			}
+			add_first(&firsts, &number_firsts, &allocated, -1, -1);
+		}
+		if (node == tree->root)
+		{
+			return firsts;
+		}
+		if (node->right_sibling != NULL)
+		{
+			node = node->right_sibling;
+			while (node->sons != NULL)
+			{
+				node = node->sons;
+			}
+		}
+		else
+		{
+			node = node->father;
+		}
+	}
+}
+
+/* counts a window for a target it is in, in the bucket of its first occurrence there (where
+ * chrcompare with a tree of the target alone finds it) */
+void count_first( TARGET* target, long first, DBL_WORD segment_size, int backward )
+{
+	/* the bucket chrcompare gives the position in a tree of the target alone */
+	int i = (int)((first + 1)/segment_size);
+
+	if (backward)
+	{
+		target->backward_count++;
+		if (i < target->buckets_per_segment)
+		{
+			target->backward_buckets[i]++;
+		}
+	}
+	else
+	{
+		target->forward_count++;
+		if (i < target->buckets_per_segment)
+		{
+			target->buckets[i]++;
+		}
+	}
+	target->total_hits++;
+}
+
+/* counts a window for every target it is in, from the marks of its locus (see mark_firsts) */
+void count_hit( SUFFIX_TREE* tree, TARGET* targets, const FIRST* firsts, NODE* locus, DBL_WORD segment_size, int backward )
+{
+	TARGET* target;
+	DBL_WORD offset;
+	DBL_WORD f;
+
+	if (locus->sons == NULL)
+	{
+		target = targets + ST_SequenceOf(tree, locus->path_position, &offset);
+		count_first(target, (long)offset, segment_size, backward);
+		return;
+	}
+	for (f = locus->leaf_count; firsts[f].target >= 0; f++)
+	{
+		count_first(targets + firsts[f].target, firsts[f].first, segment_size, backward);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	/* command line parameters */
+	char* query_file = NULL;
+	DBL_WORD segment_size = 0;
+	DBL_WORD window_size = 0;
+	char* prefix = NULL;
+
+	/* internal data */
+	TARGET* targets = NULL;
+	int number_targets = 0;
+	const char** strings = NULL;
+	DBL_WORD* lengths = NULL;
+	SUFFIX_TREE* tree = NULL;
+	FILE* file = NULL;
+	char* data_buffer = NULL;
+	char* window = NULL;
+	char* out_name = NULL;
+	int* seen = NULL;
+	FIRST* firsts = NULL;
+	NODE* locus = NULL;
+	DBL_WORD offset = 0;
+	int section_number = 0;
+	int t = 0;
+	int i = 0;
+
+	if (argc < 6)
+	{
+		Usage();
+		exit(0);
+	}
+	METRICS_Init("chrscan");
+	query_file = argv[1];
+	segment_size = atol(argv[2]);
+	window_size = atol(argv[3]);
+	prefix = argv[4];
+	number_targets = argc - 5;
+	if (segment_size == 0 || window_size == 0)
+	{
+		Usage();
+		exit(0);
+	}
+
+	/* read in every target */
+	targets = (TARGET*)calloc(number_targets, sizeof(TARGET));
+	strings = (const char**)malloc(number_targets*sizeof(char*));
+	lengths = (DBL_WORD*)malloc(number_targets*sizeof(DBL_WORD));
+	seen = (int*)malloc(number_targets*sizeof(int));
+	out_name = (char*)malloc(strlen(prefix) + 1024);
+	if (targets == NULL || strings == NULL || lengths == NULL || seen == NULL || out_name == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	METRICS_Start(METRICS_READ);
+	for (t = 0; t < number_targets; t++)
+	{
+		targets[t].file_name = argv[5 + t];
+		targets[t].first = -1;
+		file = GZ_Open(targets[t].file_name);
+		if (file == NULL)
+		{
+			printf("File '%s' NOT FOUND.\n", targets[t].file_name);
+			exit(0);
+		}
+		fseek(file, 0, SEEK_END);
+		targets[t].length = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		targets[t].data = (char*)malloc(targets[t].length + 1);
+		if (targets[t].data == NULL)
+		{
+			printf("\nOut of memory.\n");
+			exit(0);
+		}
+		targets[t].length = fread(targets[t].data, 1, targets[t].length, file);
+		fclose(file);
+		strings[t] = targets[t].data;
+		lengths[t] = targets[t].length;
+
+		targets[t].buckets_per_segment = (int)(targets[t].length/segment_size);
+		targets[t].buckets = (int*)malloc((targets[t].buckets_per_segment + 1)*sizeof(int));
+		targets[t].backward_buckets = (int*)malloc((targets[t].buckets_per_segment + 1)*sizeof(int));
+		if (strlen(argv[5 + t]) > 1000 || targets[t].buckets == NULL || targets[t].backward_buckets == NULL)
+		{
+			printf("\nOut of memory.\n");
+			exit(0);
+		}
+		strcpy(out_name, prefix);
+		target_name(out_name + strlen(out_name), targets[t].file_name);
+		targets[t].out = fopen(out_name, "w");
+		if (targets[t].out == NULL)
+		{
+			printf("File '%s' NOT CREATED.\n", out_name);
+			exit(0);
+		}
+	}
+	METRICS_Stop(METRICS_READ);
+
+	file = GZ_Open(query_file);
+	if (file == NULL)
+	{
+		printf("File '%s' NOT FOUND.\n", query_file);
+		exit(0);
+	}
+	fseek( file, 0, SEEK_END );
+	PROGRESS_Start( "chrscan", (unsigned long)ftell( file ) );
+	fseek( file, 0, SEEK_SET );
+
+	tree = ST_CreateGeneralizedTree(strings, lengths, number_targets);
+	METRICS_Start(METRICS_BUILD);
+	firsts = mark_firsts( tree, targets, seen );
+	METRICS_Stop(METRICS_BUILD);
+	for (t = 0; t < number_targets; t++)
+	{
+		free(targets[t].data);
+	}
+
+	/* scan the query once, each hit goes to every target it is in */
+	data_buffer = (char*)malloc(segment_size);
+	window = (char*)malloc(window_size + 1);
+	if (data_buffer == NULL || window == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	window[window_size] = 0;
+	METRICS_Start(METRICS_READ);
+	while (fread( data_buffer, 1, segment_size, file ) == segment_size)
+	{
+		METRICS_Stop(METRICS_READ);
+		METRICS_Start(METRICS_QUERY);
+		for (t = 0; t < number_targets; t++)
+		{
+			targets[t].forward_count = 0;
+			targets[t].backward_count = 0;
+			memset(targets[t].buckets, 0, targets[t].buckets_per_segment*sizeof(int));
+			memset(targets[t].backward_buckets, 0, targets[t].buckets_per_segment*sizeof(int));
+		}
+		for (offset = 0; offset < segment_size; offset += window_size)
+		{
+			strncpy( window, data_buffer + offset, window_size );
+			if ((locus = find_locus( tree, window, window_size )) != NULL)
+			{
+				count_hit( tree, targets, firsts, locus, segment_size, 0 );
+			}
+			reverse_complement( window, window_size );
+			if ((locus = find_locus( tree, window, window_size )) != NULL)
+			{
+				count_hit( tree, targets, firsts, locus, segment_size, 1 );
+			}
+		}
+		METRICS_Stop(METRICS_QUERY);
+		progress.bases += segment_size;
+		progress.windows++;
+
+		METRICS_Start(METRICS_OUTPUT);
+		for (t = 0; t < number_targets; t++)
+		{
+			fprintf(targets[t].out, "%d,%d,%d", section_number, targets[t].forward_count, targets[t].backward_count);
+			for (i = 0; i < targets[t].buckets_per_segment; i++)
+			{
+				fprintf(targets[t].out, ",%d", targets[t].buckets[i]);
+			}
+			for (i = 0; i < targets[t].buckets_per_segment; i++)
+			{
+				fprintf(targets[t].out, ",%d", targets[t].backward_buckets[i]);
+			}
+			fprintf(targets[t].out, "\n");
+		}
+		section_number++;
+		METRICS_Stop(METRICS_OUTPUT);
+		METRICS_Start(METRICS_READ);
+	}
+	METRICS_Stop(METRICS_READ);
+	fclose(file);
+
+	for (t = 0; t < number_targets; t++)
+	{
+		fclose(targets[t].out);
+		printf("%d,%s,%lu,%ld\n", t, targets[t].file_name, targets[t].length, targets[t].total_hits);
+		free(targets[t].buckets);
+		free(targets[t].backward_buckets);
+	}
+	ST_DeleteTree(tree);
+	free(firsts);
+	free(data_buffer);
+	free(window);
+	free(targets);
+	free(strings);
+	free(lengths);
+	free(seen);
+	free(out_name);
+	return 0;
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* condensing factors written, <file>.x<factor> for each */
+#define MIN_FACTOR 2
+#define MAX_FACTOR 20
+
+void Usage()
+{
+	printf("Usage: condense <file>\n");
+	printf("\n");
+	printf("  Outputs <file>.x%d <file>.x%d ... <file>.x%d\n", MIN_FACTOR, MIN_FACTOR + 1, MAX_FACTOR);
+	printf("\n");
+	printf("  Each output shrinks the grid by the factor in both directions, every cell being\n");
+	printf("  the largest character of the factor x factor block it covers ('0' at least).\n");
+	printf("  All levels are built in a single pass over the grid.\n");
+}
+
+/* One output level of the pyramid.
+ *
+ * A level is pooled from the largest smaller level whose factor divides its own (its parent),
+ * or from the grid itself when there is none.  Rows are pooled into the pending row until
+ * ratio rows of the parent have arrived, then the row is written and handed to the children.
+ */
+typedef struct LEVEL
+{
+	/* parent cells (and rows) per cell of this level */
+	int ratio;
+	/* index of the parent level, -1 for the grid */
+	int parent;
+	long width;
+	char* pending;
+	int pending_rows;
+	FILE* out;
+} LEVEL;
+
+LEVEL levels[MAX_FACTOR + 1];
+
+/* Width of the grid: the length of its first line including the line end, as in the Ruby version */
+long grid_width = 0;
+
+/* Reads the next line of at most width characters (the rest is skipped), returns 0 at end of file */
+int read_line( FILE* file, char* row, long width )
+{
+	int cval;
+	long column = 0;
+
+	cval = getc(file);
+	if (cval == EOF)
+	{
+		return 0;
+	}
+	memset(row, 0, width);
+	while (cval != EOF)
+	{
+		if (column < width)
+		{
+			row[column] = (char)cval;
+		}
+		column++;
+		if (cval == '\n')
+		{
+			break;
+		}
+		cval = getc(file);
+	}
+	return 1;
+}
+
+void flush_level( int factor );
+
+/* Pools one row of the parent (width parent_width) into the level, writes the level row when complete */
+void pool_row( int factor, const char* row, long parent_width )
+{
+	LEVEL* level = &levels[factor];
+	long column;
+	char* cell;
+
+	for (column = 0; column < parent_width; column++)
+	{
+		cell = level->pending + column/level->ratio;
+		if ((unsigned char)row[column] > (unsigned char)*cell)
+		{
+			*cell = row[column];
+		}
+	}
+	level->pending_rows++;
+	if (level->pending_rows == level->ratio)
+	{
+		flush_level(factor);
+	}
+}
+
+/* Writes the pending row of the level (if any rows went in) and passes it on to the children */
+void flush_level( int factor )
+{
+	LEVEL* level = &levels[factor];
+	int child;
+
+	if (level->pending_rows == 0)
+	{
+		return;
+	}
+	fwrite(level->pending, 1, level->width, level->out);
+	fputc('\n', level->out);
+	for (child = factor + 1; child <= MAX_FACTOR; child++)
+	{
+		if (levels[child].parent == factor)
+		{
+			pool_row(child, level->pending, level->width);
+		}
+	}
+	memset(level->pending, '0', level->width);
+	level->pending_rows = 0;
+}
+
+int main(int argc, char* argv[])
+{
+	FILE* file;
+	char* row;
+	char* out_name;
+	int cval;
+	int factor;
+	int divisor;
+
+	if (argc != 2)
+	{
+		Usage();
+		return 0;
+	}
+
+	file = fopen(argv[1], "r");
+	if (file == 0)
+	{
+		printf("\nCould not open file %s.\n", argv[1]);
+		return 0;
+	}
+	while ((cval = getc(file)) != EOF)
+	{
+		grid_width++;
+		if (cval == '\n')
+		{
+			break;
+		}
+	}
+	rewind(file);
+
+	row = (char*)malloc(grid_width + 1);
+	out_name = (char*)malloc(strlen(argv[1]) + 16);
+	if (row == 0 || out_name == 0)
+	{
+		printf("\nOut of memory.\n");
+		return 0;
+	}
+	for (factor = MIN_FACTOR; factor <= MAX_FACTOR; factor++)
+	{
+		levels[factor].parent = -1;
+		levels[factor].ratio = factor;
+		for (divisor = factor - 1; divisor >= MIN_FACTOR; divisor--)
+		{
+			if (factor % divisor == 0)
+			{
+				levels[factor].parent = divisor;
+				levels[factor].ratio = factor / divisor;
+				break;
+			}
+		}
+		levels[factor].width = (grid_width + factor - 1) / factor;
+		levels[factor].pending = (char*)malloc(levels[factor].width + 1);
+		if (levels[factor].pending == 0)
+		{
+			printf("\nOut of memory.\n");
+			return 0;
+		}
+		memset(levels[factor].pending, '0', levels[factor].width);
+		levels[factor].pending_rows = 0;
+		sprintf(out_name, "%s.x%d", argv[1], factor);
+		levels[factor].out = fopen(out_name, "w");
+		if (levels[factor].out == 0)
+		{
+			printf("\nCould not create file %s.\n", out_name);
+			return 0;
+		}
+	}
+
+	while (read_line(file, row, grid_width))
+	{
+		for (factor = MIN_FACTOR; factor <= MAX_FACTOR; factor++)
+		{
+			if (levels[factor].parent == -1)
+			{
+				pool_row(factor, row, grid_width);
+			}
+		}
+	}
+	fclose(file);
+
+	/* the last rows of each level may be fewer than the factor; parents come first so their
+	   final row reaches the children before the children are flushed */
+	for (factor = MIN_FACTOR; factor <= MAX_FACTOR; factor++)
+	{
+		flush_level(factor);
+		fclose(levels[factor].out);
+		free(levels[factor].pending);
+	}
+	free(row);
+	free(out_name);
+	return 0;
+}
@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gz_input.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* bytes read from the FASTA file at a time, and buffered for each output */
+#define BLOCK_SIZE (1L << 20)
+
+/* first bytes of a .2bit file, followed by the base count (8 bytes, little endian) */
+#define PACKED_MAGIC "ACGT2BIT"
+
+void Usage()
+{
+	printf("Usage: fasta2acgt <in file> <out file>\n");
+	printf("\n");
+	printf("  Writes the bases of <in file> to <out file>, upper case, A C G T only, skipping '>' lines.\n");
+	printf("  If <out file> already exists, does nothing.\n");
+	printf("  <in file> may be gzip or BGZF compressed (a .fa.gz), it is read as it is (see gz_input.h).\n");
+	printf("\n");
+	printf("  Also writes:\n");
+	printf("    <out file>.2bit  \"%s\", base count (8 bytes, little endian), then 4 bases per byte,\n", PACKED_MAGIC);
+	printf("                     first base in the low bits, A=0 C=1 G=2 T=3\n");
+	printf("    <out file>.mask  what <out file> leaves out, one per line, offsets are base offsets in <out file>:\n");
+	printf("                       > <offset> <header>   a '>' line\n");
+	printf("                       N <offset> <length>   <length> other characters (N, IUPAC codes) dropped before <offset>\n");
+	printf("                       S <offset> <length>   <length> bases from <offset> were lower case (soft masked)\n");
+}
+
+/* Output state; runs are open until a base ends them */
+FILE* acgt_file = NULL;
+FILE* packed_file = NULL;
+FILE* mask_file = NULL;
+unsigned char* acgt_buffer = NULL;
+long acgt_used = 0;
+unsigned char* packed_buffer = NULL;
+long packed_used = 0;
+unsigned long bases = 0;
+unsigned long n_run_length = 0;
+unsigned long soft_run_start = 0;
+int soft_run_open = 0;
+int at_line_start = 1;
+int in_header = 0;
+
+/* 2 bit code of an A C G T (either case): A=0 C=1 G=2 T=3 */
+#define BASE_CODE(c) ((((c) >> 1) ^ ((c) >> 2)) & 3)
+
+void flush_acgt()
+{
+	fwrite(acgt_buffer, 1, acgt_used, acgt_file);
+	acgt_used = 0;
+}
+
+void flush_packed()
+{
+	fwrite(packed_buffer, 1, packed_used, packed_file);
+	packed_used = 0;
+}
+
+void end_n_run()
+{
+	if (n_run_length > 0)
+	{
+		fprintf(mask_file, "N %lu %lu\n", bases, n_run_length);
+		n_run_length = 0;
+	}
+}
+
+void end_soft_run()
+{
+	if (soft_run_open)
+	{
+		fprintf(mask_file, "S %lu %lu\n", soft_run_start, bases - soft_run_start);
+		soft_run_open = 0;
+	}
+}
+
+/* Appends one base, cval already upper case */
+void add_base( unsigned char cval, int lower )
+{
+	if (lower && !soft_run_open)
+	{
+		soft_run_start = bases;
+		soft_run_open = 1;
+	}
+	else if (!lower)
+	{
+		end_soft_run();
+	}
+	if (acgt_used == BLOCK_SIZE)
+	{
+		flush_acgt();
+	}
+	acgt_buffer[acgt_used++] = cval;
+	if ((bases & 3) == 0)
+	{
+		if (packed_used == BLOCK_SIZE)
+		{
+			flush_packed();
+		}
+		packed_buffer[packed_used++] = (unsigned char)BASE_CODE(cval);
+	}
+	else
+	{
+		packed_buffer[packed_used - 1] |= (unsigned char)(BASE_CODE(cval) << ((bases & 3)*2));
+	}
+	bases++;
+}
+
+/* Handles one character of a sequence line */
+void add_character( unsigned char cval )
+{
+	unsigned char upper = cval & 0xDF;
+
+	if (upper == 'A' || upper == 'C' || upper == 'G' || upper == 'T')
+	{
+		end_n_run();
+		add_base(upper, upper != cval);
+	}
+	else if (cval != '\n' && cval != '\r' && cval != ' ' && cval != '\t')
+	{
+		n_run_length++;
+	}
+}
+
+/*
+ * Handles a piece of a sequence line holding no line end.  With SSE2, 16 characters are
+ * classified and case folded at once; blocks of nothing but A C G T of one case go straight
+ * to the output, anything else falls back to a character at a time.
+ */
+void add_sequence( const unsigned char* data, long length )
+{
+	long offset = 0;
+#ifdef __SSE2__
+	const __m128i fold = _mm_set1_epi8((char)0xDF);
+	const __m128i a = _mm_set1_epi8('A');
+	const __m128i c = _mm_set1_epi8('C');
+	const __m128i g = _mm_set1_epi8('G');
+	const __m128i t = _mm_set1_epi8('T');
+	__m128i block;
+	__m128i upper;
+	int acgt_mask;
+	int upper_mask;
+	int i;
+
+	for (; offset + 16 <= length; offset += 16)
+	{
+		block = _mm_loadu_si128((const __m128i*)(data + offset));
+		upper = _mm_and_si128(block, fold);
+		acgt_mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(upper, a), _mm_cmpeq_epi8(upper, c)),
+			_mm_or_si128(_mm_cmpeq_epi8(upper, g), _mm_cmpeq_epi8(upper, t))));
+		upper_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(upper, block));
+		if (acgt_mask != 0xFFFF || (upper_mask != 0xFFFF && upper_mask != 0) || acgt_used + 16 > BLOCK_SIZE)
+		{
+			for (i = 0; i < 16; i++)
+			{
+				add_character(data[offset + i]);
+			}
+			continue;
+		}
+		end_n_run();
+		if (upper_mask == 0 && !soft_run_open)
+		{
+			soft_run_start = bases;
+			soft_run_open = 1;
+		}
+		else if (upper_mask != 0)
+		{
+			end_soft_run();
+		}
+		_mm_storeu_si128((__m128i*)(acgt_buffer + acgt_used), upper);
+		for (i = 0; i < 16; i++)
+		{
+			if ((bases & 3) == 0)
+			{
+				if (packed_used == BLOCK_SIZE)
+				{
+					flush_packed();
+				}
+				packed_buffer[packed_used++] = (unsigned char)BASE_CODE(acgt_buffer[acgt_used]);
+			}
+			else
+			{
+				packed_buffer[packed_used - 1] |= (unsigned char)(BASE_CODE(acgt_buffer[acgt_used]) << ((bases & 3)*2));
+			}
+			acgt_used++;
+			bases++;
+		}
+	}
+#endif
+	for (; offset < length; offset++)
+	{
+		add_character(data[offset]);
+	}
+}
+
+/* Handles a block read from the FASTA file; lines may continue into the next block */
+void add_block( const unsigned char* data, long length )
+{
+	const unsigned char* end = data + length;
+	const unsigned char* line_end;
+
+	while (data < end)
+	{
+		if (at_line_start && *data == '>')
+		{
+			end_n_run();
+			end_soft_run();
+			fprintf(mask_file, "> %lu ", bases);
+			in_header = 1;
+			data++;
+		}
+		line_end = (const unsigned char*)memchr(data, '\n', end - data);
+		if (line_end == NULL)
+		{
+			line_end = end;
+		}
+		if (in_header)
+		{
+			fwrite(data, 1, (line_end > data && *(line_end - 1) == '\r') ? line_end - data - 1 : line_end - data, mask_file);
+		}
+		else
+		{
+			add_sequence(data, line_end - data);
+		}
+		at_line_start = 0;
+		data = line_end;
+		if (data < end)
+		{
+			if (in_header)
+			{
+				fputc('\n', mask_file);
+			}
+			in_header = 0;
+			at_line_start = 1;
+			data++;
+		}
+	}
+}
+
+FILE* create_file( const char* name, const char* suffix )
+{
+	char* full_name = (char*)malloc(strlen(name) + strlen(suffix) + 1);
+	FILE* file;
+
+	strcpy(full_name, name);
+	strcat(full_name, suffix);
+	file = fopen(full_name, "wb");
+	if (file == NULL)
+	{
+		printf("Could not create file %s.\n", full_name);
+		exit(0);
+	}
+	free(full_name);
+	return file;
+}
+
+int main(int argc, char* argv[])
+{
+	FILE* in_file;
+	FILE* existing;
+	unsigned char* block;
+	unsigned char count[8];
+	long length;
+	int i;
+
+	if (argc != 3)
+	{
+		Usage();
+		return 0;
+	}
+	in_file = GZ_Open(argv[1]);
+	if (in_file == NULL)
+	{
+		printf("Input file %s does NOT exist!\n", argv[1]);
+		return 0;
+	}
+	existing = fopen(argv[2], "rb");
+	if (existing != NULL)
+	{
+		fclose(existing);
+		printf("Output file %s already exists, input file NOT processed!\n", argv[2]);
+		return 0;
+	}
+
+	acgt_file = create_file(argv[2], "");
+	packed_file = create_file(argv[2], ".2bit");
+	mask_file = create_file(argv[2], ".mask");
+	block = (unsigned char*)malloc(BLOCK_SIZE);
+	acgt_buffer = (unsigned char*)malloc(BLOCK_SIZE);
+	packed_buffer = (unsigned char*)malloc(BLOCK_SIZE);
+	if (block == NULL || acgt_buffer == NULL || packed_buffer == NULL)
+	{
+		printf("\nOut of memory.\n");
+		return 0;
+	}
+
+	/* base count is filled in at the end */
+	fwrite(PACKED_MAGIC, 1, 8, packed_file);
+	memset(count, 0, 8);
+	fwrite(count, 1, 8, packed_file);
+
+	while ((length = (long)fread(block, 1, BLOCK_SIZE, in_file)) > 0)
+	{
+		add_block(block, length);
+	}
+	if (in_header)
+	{
+		fputc('\n', mask_file);
+	}
+	end_n_run();
+	end_soft_run();
+	flush_acgt();
+	flush_packed();
+
+	for (i = 0; i < 8; i++)
+	{
+		count[i] = (unsigned char)(bases >> (i*8));
+	}
+	fseek(packed_file, 8, SEEK_SET);
+	fwrite(count, 1, 8, packed_file);
+
+	fclose(in_file);
+	fclose(acgt_file);
+	fclose(packed_file);
+	fclose(mask_file);
+	free(block);
+	free(acgt_buffer);
+	free(packed_buffer);
+	return 0;
+}
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* bases per FASTA line */
+#define LINE_LENGTH 60
+/* alpha satellite monomer length, the most common tandem repeat unit in primate centromeres */
+#define ALPHA_SATELLITE_UNIT 171
+
+void Usage()
+{
+	printf("Usage: gen_genome <species1 file> <species2 file> <length> [<seed> <gc percent> <satellite percent> <duplications> <inversions> <divergence>]\n");
+	printf("\n");
+	printf(" Writes two FASTA files of <length> bases each, a synthetic chromosome of two related species:\n");
+	printf("\n");
+	printf("   <seed>               random seed, the same seed gives the same files (default 1)\n");
+	printf("   <gc percent>         G and C share of the random bases (default 41)\n");
+	printf("   <satellite percent>  share of species 1 made of tandem satellite arrays (default 5)\n");
+	printf("   <duplications>       segmental duplications within species 1, half reverse complemented (default 10)\n");
+	printf("   <inversions>         segments reverse complemented in species 2 (default 3)\n");
+	printf("   <divergence>         substitutions per thousand bases between the species (default 12)\n");
+	printf("\n");
+	printf(" Species 2 is species 1 with the substitutions and inversions.  The satellites,\n");
+	printf(" duplications and inversions are listed on the screen, one per line, base offsets from 0.\n");
+}
+
+unsigned long random_state = 1;
+
+/* xorshift64*, so a seed gives the same genome whatever the C library */
+unsigned long next_random()
+{
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return (random_state * 2685821657736338717UL) >> 11;
+}
+
+/* random number from 0 to range - 1 */
+unsigned long random_below( unsigned long range )
+{
+	return range == 0 ? 0 : next_random() % range;
+}
+
+/* random number from low to high */
+unsigned long random_between( unsigned long low, unsigned long high )
+{
+	return high <= low ? low : low + random_below(high - low + 1);
+}
+
+int gc_percent = 41;
+
+char random_base()
+{
+	if (random_below(100) < (unsigned long)gc_percent)
+	{
+		return random_below(2) ? 'G' : 'C';
+	}
+	return random_below(2) ? 'A' : 'T';
+}
+
+/* a base other than cval */
+char substitute( char cval )
+{
+	static const char bases[] = "ACGT";
+	char other;
+	do
+	{
+		other = bases[random_below(4)];
+	} while (other == cval);
+	return other;
+}
+
+char complement( char cval )
+{
+	switch (cval)
+	{
+	case 'A': return 'T';
+	case 'C': return 'G';
+	case 'G': return 'C';
+	case 'T': return 'A';
+	}
+	return cval;
+}
+
+void reverse_complement( char* sequence, unsigned long length )
+{
+	unsigned long i;
+	char cval;
+	for (i = 0; i < length / 2; i++)
+	{
+		cval = sequence[i];
+		sequence[i] = complement(sequence[length - 1 - i]);
+		sequence[length - 1 - i] = complement(cval);
+	}
+	if (length % 2 == 1)
+	{
+		sequence[length / 2] = complement(sequence[length / 2]);
+	}
+}
+
+/* substitutes about per_thousand of every thousand bases */
+void mutate( char* sequence, unsigned long length, int per_thousand )
+{
+	unsigned long i;
+	for (i = 0; i < length; i++)
+	{
+		if (random_below(1000) < (unsigned long)per_thousand)
+		{
+			sequence[i] = substitute(sequence[i]);
+		}
+	}
+}
+
+int write_fasta( const char* file_name, const char* header, const char* sequence, unsigned long length )
+{
+	FILE* file = fopen(file_name, "w");
+	unsigned long i;
+
+	if (file == NULL)
+	{
+		printf("File '%s' NOT CREATED.\n", file_name);
+		return 0;
+	}
+	fprintf(file, ">%s\n", header);
+	for (i = 0; i < length; i += LINE_LENGTH)
+	{
+		fwrite(sequence + i, 1, length - i < LINE_LENGTH ? length - i : LINE_LENGTH, file);
+		putc('\n', file);
+	}
+	if (fclose(file) != 0)
+	{
+		printf("File '%s' NOT WRITTEN.\n", file_name);
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long length;
+	unsigned long seed = 1;
+	int satellite_percent = 5;
+	int duplications = 10;
+	int inversions = 3;
+	int divergence = 12;
+	unsigned long satellite_bases;
+	unsigned long unit_length;
+	unsigned long start;
+	unsigned long size;
+	unsigned long source;
+	unsigned long i;
+	char* species1;
+	char* species2;
+	char header[256];
+	int n;
+
+	if (argc != 4 && argc != 10)
+	{
+		Usage();
+		return 0;
+	}
+	length = strtoul(argv[3], NULL, 10);
+	if (argc == 10)
+	{
+		seed = strtoul(argv[4], NULL, 10);
+		gc_percent = atoi(argv[5]);
+		satellite_percent = atoi(argv[6]);
+		duplications = atoi(argv[7]);
+		inversions = atoi(argv[8]);
+		divergence = atoi(argv[9]);
+	}
+	if (length < 1000 || gc_percent < 0 || gc_percent > 100 || satellite_percent < 0 || satellite_percent > 100
+		|| duplications < 0 || inversions < 0 || divergence < 0 || divergence > 1000)
+	{
+		Usage();
+		return 0;
+	}
+	/* xorshift needs a state other than 0; mix the seed so nearby seeds differ */
+	random_state = (seed + 1) * 0x9E3779B97F4A7C15UL;
+	if (random_state == 0)
+	{
+		random_state = 1;
+	}
+
+	species1 = (char*)malloc(length);
+	species2 = (char*)malloc(length);
+	if (species1 == NULL || species2 == NULL)
+	{
+		printf("\nOut of memory.\n");
+		return 0;
+	}
+	for (i = 0; i < length; i++)
+	{
+		species1[i] = random_base();
+	}
+
+	/* tandem arrays of a unit, each copy drifting a little from the unit */
+	satellite_bases = length / 100 * satellite_percent;
+	while (satellite_bases > 0)
+	{
+		unit_length = random_below(2) ? ALPHA_SATELLITE_UNIT : random_between(2, 68);
+		size = random_between(length / 200 + unit_length, length / 20 + unit_length);
+		if (size > satellite_bases)
+		{
+			size = satellite_bases;
+		}
+		if (size > length)
+		{
+			size = length;
+		}
+		start = random_below(length - size + 1);
+		for (i = 0; i < unit_length && i < size; i++)
+		{
+			species1[start + i] = random_base();
+		}
+		for (i = unit_length; i < size; i++)
+		{
+			species1[start + i] = random_below(100) < 2 ? substitute(species1[start + i - unit_length]) : species1[start + i - unit_length];
+		}
+		printf("satellite %lu %lu unit %lu\n", start, size, unit_length);
+		satellite_bases -= size;
+	}
+
+	for (n = 0; n < duplications; n++)
+	{
+		size = random_between(1000, length / 50 > 1000 ? length / 50 : 1000);
+		if (size > length / 2)
+		{
+			size = length / 2;
+		}
+		source = random_below(length - size + 1);
+		start = random_below(length - size + 1);
+		memmove(species1 + start, species1 + source, size);
+		mutate(species1 + start, size, 10);
+		if (random_below(2))
+		{
+			reverse_complement(species1 + start, size);
+			printf("duplication %lu %lu from %lu reversed\n", start, size, source);
+		}
+		else
+		{
+			printf("duplication %lu %lu from %lu\n", start, size, source);
+		}
+	}
+
+	memcpy(species2, species1, length);
+	mutate(species2, length, divergence);
+	for (n = 0; n < inversions; n++)
+	{
+		size = random_between(length / 100 + 1, length / 20 + 1);
+		start = random_below(length - size + 1);
+		reverse_complement(species2 + start, size);
+		printf("inversion %lu %lu\n", start, size);
+	}
+
+	sprintf(header, "species1 synthetic length=%lu seed=%lu gc=%d satellite=%d", length, seed, gc_percent, satellite_percent);
+	if (!write_fasta(argv[1], header, species1, length))
+	{
+		return 1;
+	}
+	sprintf(header, "species2 synthetic length=%lu seed=%lu divergence=%d inversions=%d", length, seed, divergence, inversions);
+	if (!write_fasta(argv[2], header, species2, length))
+	{
+		return 1;
+	}
+	free(species1);
+	free(species2);
+	return 0;
+}
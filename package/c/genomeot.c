@@ -0,0 +1,353 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file genomeot.c implementing the header file
+genomeot.h.
+*******************************************************************************/
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "suffix_tree.h"
+#include "st_index.h"
+#include "st_parallel.h"
+#include "genomeot.h"
+
+/* From suffix_tree.c */
+DBL_WORD get_node_label_end(SUFFIX_TREE* tree, NODE* node);
+
+struct GENOMEOTINDEX
+{
+   /* The index searched, or when there is none the tree */
+   ST_INDEX*      index;
+   SUFFIX_TREE*   tree;
+};
+
+/* Longest window searched on the stack, longer ones are allocated */
+#define GENOMEOT_WINDOW 256
+
+/******************************************************************************/
+/*
+   find_window :
+   Searches a string in the index or the tree.
+
+   Output: Its position (from 1), 0 if it is not there.
+*/
+
+static unsigned long find_window(GENOMEOT_INDEX* index, const char* window, unsigned long window_size)
+{
+   DBL_WORD position;
+
+   if(index->index != 0)
+      return STI_FindSubstring(index->index, window, window_size);
+   /* ST_ERROR is that of the last tree created, compared at once */
+   position = ST_FindSubstring(index->tree, (char*)window, window_size);
+   return position == ST_ERROR ? 0 : position;
+}
+
+/******************************************************************************/
+/*
+   reverse_complement :
+   Writes the reverse complement of a string (anything but A, C, G and T
+   becomes x, which matches nothing, as in chrcompare).
+*/
+
+static void reverse_complement(const char* from, char* to, unsigned long length)
+{
+   unsigned long i;
+
+   for(i = 0; i < length; i++)
+   {
+      switch(from[length - 1 - i])
+      {
+         case 'A': to[i] = 'T'; break;
+         case 'C': to[i] = 'G'; break;
+         case 'G': to[i] = 'C'; break;
+         case 'T': to[i] = 'A'; break;
+         default:  to[i] = 'x'; break;
+      }
+   }
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Version :
+   See genomeot.h for description.
+*/
+
+long GENOMEOT_Version(void)
+{
+   return GENOMEOT_ABI_VERSION;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Build :
+   See genomeot.h for description.
+*/
+
+GENOMEOT_INDEX* GENOMEOT_Build(const char* text, unsigned long length)
+{
+   GENOMEOT_INDEX* index;
+   DBL_WORD threads = ST_Threads();
+
+   if(text == 0 || length == 0)
+      return 0;
+   index = (GENOMEOT_INDEX*)malloc(sizeof(GENOMEOT_INDEX));
+   if(index == 0)
+      return 0;
+   index->index = 0;
+   index->tree  = threads == 1 ? ST_CreateTree(text, length) : ST_CreateTreeParallel(text, length, threads);
+   if(index->tree == 0)
+   {
+      free(index);
+      return 0;
+   }
+   index->index = ST_Freeze(index->tree, 0);
+   if(index->index != 0)
+   {
+      ST_DeleteTree(index->tree);
+      index->tree = 0;
+   }
+   else
+      ST_BuildJumpTable(index->tree, ST_JumpK());
+   return index;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_BuildFile :
+   See genomeot.h for description.
+*/
+
+long GENOMEOT_BuildFile(const char* text_file, const char* index_file, unsigned long memory_mb, unsigned long k)
+{
+   return STI_Build(text_file, index_file, memory_mb, k);
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Load :
+   See genomeot.h for description.
+*/
+
+GENOMEOT_INDEX* GENOMEOT_Load(const char* index_file)
+{
+   GENOMEOT_INDEX* index = (GENOMEOT_INDEX*)malloc(sizeof(GENOMEOT_INDEX));
+
+   if(index == 0)
+      return 0;
+   index->tree  = 0;
+   index->index = STI_Open(index_file);
+   if(index->index == 0)
+   {
+      free(index);
+      return 0;
+   }
+   return index;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Save :
+   See genomeot.h for description.
+*/
+
+long GENOMEOT_Save(GENOMEOT_INDEX* index, const char* index_file)
+{
+   if(index->index == 0)
+      return 0;
+   return STI_Write(index->index, index_file);
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Length :
+   See genomeot.h for description.
+*/
+
+unsigned long GENOMEOT_Length(GENOMEOT_INDEX* index)
+{
+   return index->index != 0 ? index->index->header->length : index->tree->length - 1;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_FindBatch :
+   See genomeot.h for description.
+*/
+
+unsigned long GENOMEOT_FindBatch(GENOMEOT_INDEX* index, const char* windows, unsigned long window_size,
+                                 unsigned long count, unsigned long* positions)
+{
+   unsigned long i, found = 0;
+
+   for(i = 0; i < count; i++)
+   {
+      positions[i] = find_window(index, windows + i * window_size, window_size);
+      if(positions[i] != 0)
+         found++;
+   }
+   return found;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Compare :
+   See genomeot.h for description.
+*/
+
+unsigned long GENOMEOT_Compare(GENOMEOT_INDEX* index, const char* query, unsigned long length,
+                               unsigned long segment_size, unsigned long window_size, unsigned long buckets,
+                               unsigned long* counts)
+{
+   char            stack_window[GENOMEOT_WINDOW];
+   char*           window = stack_window;
+   unsigned long   sections, s, offset, position, bucket;
+   unsigned long*  section;
+
+   if(segment_size == 0 || window_size == 0)
+      return 0;
+   if(window_size > GENOMEOT_WINDOW)
+   {
+      window = (char*)malloc(window_size);
+      if(window == 0)
+         return 0;
+   }
+   sections = length / segment_size;
+   memset(counts, 0, sections * (2 + 2 * buckets) * sizeof(unsigned long));
+   for(s = 0; s < sections; s++)
+   {
+      section = counts + s * (2 + 2 * buckets);
+      /* The windows that start in the section and end in the query */
+      for(offset = s * segment_size; offset < (s + 1) * segment_size && offset + window_size <= length;
+          offset += window_size)
+      {
+         position = find_window(index, query + offset, window_size);
+         if(position != 0)
+         {
+            section[0]++;
+            bucket = position / segment_size;
+            if(bucket < buckets)
+               section[2 + bucket]++;
+         }
+         reverse_complement(query + offset, window, window_size);
+         position = find_window(index, window, window_size);
+         if(position != 0)
+         {
+            section[1]++;
+            bucket = position / segment_size;
+            if(bucket < buckets)
+               section[2 + buckets + bucket]++;
+         }
+      }
+   }
+   if(window != stack_window)
+      free(window);
+   return sections;
+}
+
+/******************************************************************************/
+/*
+   mark_nodes :
+   Sets the leaf counts (for DAWG) and the left diverse marks (for LEFT) of a
+   subtree, as centromere's generate_node_marks.
+*/
+
+static void mark_nodes(NODE* node, long flags)
+{
+   NODE* son;
+   DBL_WORD leaves = 0;
+   char left_char = 0;
+   int left_diverse = 1;
+
+   if(node->sons == 0)
+   {
+      node->leaf_count = 1;
+      node->is_left_diverse = 1;
+      return;
+   }
+   for(son = node->sons; son != 0; son = son->right_sibling)
+   {
+      mark_nodes(son, flags);
+      leaves += son->leaf_count;
+      if(left_char == 0)
+         left_char = son->left_char;
+      else if(left_char != son->left_char)
+         left_diverse = 0;
+      if(son->is_left_diverse == 0)
+         left_diverse = 0;
+   }
+   node->leaf_count = leaves;
+   node->is_left_diverse = left_diverse;
+   if((flags & GENOMEOT_LEFT) && !left_diverse)
+      node->ignore_NODE = 1;
+}
+
+/******************************************************************************/
+/*
+   count_nodes :
+   Adds the nodes of a subtree in the depth range and their edge lengths to
+   the counts, as centromere's generate_node_counts.
+*/
+
+static void count_nodes(SUFFIX_TREE* tree, NODE* node, long depth, long flags, long min_depth, long max_depth,
+                        unsigned long* counts)
+{
+   NODE* son;
+   long edge = (long)(get_node_label_end(tree, node) - node->edge_label_start + 1);
+
+   depth += edge;
+   if(node->ignore_NODE)
+      return;
+   if((flags & GENOMEOT_DAWG) && node->suffix_link != 0 && node->leaf_count == node->suffix_link->leaf_count)
+      return;
+   if(max_depth == -1 || (depth >= min_depth && depth <= max_depth))
+   {
+      counts[0]++;
+      counts[1] += edge;
+   }
+   for(son = node->sons; son != 0; son = son->right_sibling)
+      count_nodes(tree, son, depth, flags, min_depth, max_depth, counts);
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_WindowCounts :
+   See genomeot.h for description.
+*/
+
+long GENOMEOT_WindowCounts(const char* window, unsigned long length, long flags, long min_depth, long max_depth,
+                           unsigned long* counts)
+{
+   SUFFIX_TREE* tree;
+
+   if(window == 0 || length == 0)
+      return 0;
+   /* DAWG follows suffix links, so the tree is Ukkonen's */
+   tree = ST_CreateTree(window, length);
+   if(tree == 0)
+      return 0;
+   counts[0] = counts[1] = 0;
+   if(flags & (GENOMEOT_DAWG | GENOMEOT_LEFT))
+      mark_nodes(tree->root, flags);
+   count_nodes(tree, tree->root, 0, flags, min_depth, max_depth, counts);
+   ST_DeleteTree(tree);
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   GENOMEOT_Free :
+   See genomeot.h for description.
+*/
+
+void GENOMEOT_Free(GENOMEOT_INDEX* index)
+{
+   if(index == 0)
+      return;
+   if(index->index != 0)
+      STI_Close(index->index);
+   if(index->tree != 0)
+      ST_DeleteTree(index->tree);
+   free(index);
+}
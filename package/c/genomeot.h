@@ -0,0 +1,150 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file genomeot.h of libgenomeot, the shared library
+of the suffix tree tools for callers in the same process (see
+package/ruby/genomeot.rb). An index is built or loaded once and then
+searched any number of times, with the data passed in and out as buffers
+rather than files and command lines.
+
+The interface is a stable C ABI: an opaque index handle, and plain char,
+long and unsigned long arguments, so that a binding only declares the
+functions. GENOMEOT_ABI_VERSION changes when any of them does.
+
+The environment settings of the tools apply (GENOMEOT_THREADS,
+GENOMEOT_JUMP_K and the placement of placement.h); the metrics counters
+are counted but the report is only written by the tools.
+*******************************************************************************/
+
+#define GENOMEOT_ABI_VERSION 1
+
+/* Flags of GENOMEOT_WindowCounts, as centromere's options */
+#define GENOMEOT_DAWG 1
+#define GENOMEOT_LEFT 2
+
+/* An index open for search: a frozen tree, an index file, or a tree of a
+   text that is not DNA */
+typedef struct GENOMEOTINDEX GENOMEOT_INDEX;
+
+/******************************************************************************/
+/*
+   GENOMEOT_Version :
+   Returns the GENOMEOT_ABI_VERSION the library was built with.
+*/
+
+long GENOMEOT_Version(void);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Build :
+   Builds the index of a text in memory: its tree, frozen when the text is
+   DNA (see ST_Freeze).
+
+   Input : The text and its length.
+
+   Output: The index, 0 on an error.
+*/
+
+GENOMEOT_INDEX* GENOMEOT_Build(const char* text, unsigned long length);
+
+/******************************************************************************/
+/*
+   GENOMEOT_BuildFile :
+   Builds an index file out of core, as st_mkindex does.
+
+   Input : The text file (A, C, G and T only), the index file, the memory
+           budget in MB and k (0 to choose it).
+
+   Output: 1 on success, 0 on an error (which is printed).
+*/
+
+long GENOMEOT_BuildFile(const char* text_file, const char* index_file, unsigned long memory_mb, unsigned long k);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Load :
+   Opens an index file (of st_mkindex or GENOMEOT_Save).
+
+   Output: The index, 0 on an error (which is printed).
+*/
+
+GENOMEOT_INDEX* GENOMEOT_Load(const char* index_file);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Save :
+   Writes an index to an index file.
+
+   Output: 1 on success, 0 on an error or for the tree of a text that is not
+           DNA, which has no file form.
+*/
+
+long GENOMEOT_Save(GENOMEOT_INDEX* index, const char* index_file);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Length :
+   Returns the length of the text of an index.
+*/
+
+unsigned long GENOMEOT_Length(GENOMEOT_INDEX* index);
+
+/******************************************************************************/
+/*
+   GENOMEOT_FindBatch :
+   Searches a batch of strings of one length.
+
+   Input : The index, the strings one after the other (count * window_size
+           characters), their length and number, and count positions to
+           fill in.
+
+   Output: The number found. The position of each string is that of
+           ST_FindSubstring (from 1), 0 if it is not there.
+*/
+
+unsigned long GENOMEOT_FindBatch(GENOMEOT_INDEX* index, const char* windows, unsigned long window_size,
+                                 unsigned long count, unsigned long* positions);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Compare :
+   Counts, as chrcompare does, the windows of each section of a query that
+   are in the index, forward and reverse complemented.
+
+   Input : The index, the query and its length, the section and window
+           sizes, the number of buckets the index text is divided into (by
+           the position of the match) and the counts to fill in: per
+           section, 2 + 2 * buckets values (forward, backward, the forward
+           count of each bucket, the backward count of each bucket), for
+           length / segment_size sections.
+
+   Output: The number of sections.
+*/
+
+unsigned long GENOMEOT_Compare(GENOMEOT_INDEX* index, const char* query, unsigned long length,
+                               unsigned long segment_size, unsigned long window_size, unsigned long buckets,
+                               unsigned long* counts);
+
+/******************************************************************************/
+/*
+   GENOMEOT_WindowCounts :
+   Counts the nodes and the distinct substrings of the tree of a window, as
+   a centromere column pair does (the substrings in full, where centromere
+   prints them modulo a million without intervals).
+
+   Input : The window and its length, GENOMEOT_DAWG and GENOMEOT_LEFT flags,
+           the depth range of the nodes counted (max_depth -1 for no limit)
+           and the 2 counts to fill in.
+
+   Output: 1 on success, 0 on an error.
+*/
+
+long GENOMEOT_WindowCounts(const char* window, unsigned long length, long flags, long min_depth, long max_depth,
+                           unsigned long* counts);
+
+/******************************************************************************/
+/*
+   GENOMEOT_Free :
+   Frees an index.
+*/
+
+void GENOMEOT_Free(GENOMEOT_INDEX* index);
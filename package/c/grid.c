@@ -0,0 +1,203 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file grid.c implementing the header file grid.h.
+*******************************************************************************/
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "grid.h"
+
+/* A grid file of the mosaic */
+typedef struct GRIDFILE
+{
+   FILE*            file;
+   /* Length of the first line, without its line end */
+   unsigned long    width;
+   unsigned long    lines;
+   /* Column of the grid in the mosaic */
+   unsigned long    x;
+} GRID_FILE;
+
+struct GRIDMOSAIC
+{
+   int              count;
+   GRID_FILE*       grids;
+   unsigned long    width;
+   unsigned long    height;
+   unsigned long    next_row;
+};
+
+/******************************************************************************/
+/*
+   measure_grid :
+   Measures the first line (without its line ending) and counts the lines, then
+   rewinds.
+*/
+
+void measure_grid(GRID_FILE* grid)
+{
+   int cval, first_line = 1, line_started = 0;
+   unsigned long length = 0;
+
+   grid->width = 0;
+   grid->lines = 0;
+   while((cval = getc(grid->file)) != EOF)
+   {
+      line_started = 1;
+      if(cval == '\n')
+      {
+         if(first_line)
+         {
+            grid->width = length;
+            first_line = 0;
+         }
+         grid->lines++;
+         line_started = 0;
+      }
+      else if(first_line && cval != '\r')
+         length++;
+   }
+   if(line_started)
+   {
+      if(first_line)
+         grid->width = length;
+      grid->lines++;
+   }
+   rewind(grid->file);
+}
+
+/******************************************************************************/
+/*
+   GRID_OpenMosaic :
+   See grid.h for description.
+*/
+
+GRID_MOSAIC* GRID_OpenMosaic(int count, char* names[])
+{
+   GRID_MOSAIC* mosaic;
+   int i;
+
+   mosaic = (GRID_MOSAIC*)malloc(sizeof(GRID_MOSAIC));
+   if(mosaic != 0)
+      mosaic->grids = (GRID_FILE*)malloc(count * sizeof(GRID_FILE));
+   if(mosaic == 0 || mosaic->grids == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   mosaic->count    = count;
+   mosaic->width    = GRID_BOUNDARY_WIDTH;
+   mosaic->height   = GRID_BOUNDARY_WIDTH;
+   mosaic->next_row = 0;
+   for(i = 0; i < count; i++)
+   {
+      mosaic->grids[i].file = fopen(names[i], "r");
+      if(mosaic->grids[i].file == 0)
+      {
+         printf("\nCould not open file %s.\n", names[i]);
+         while(--i >= 0)
+            fclose(mosaic->grids[i].file);
+         free(mosaic->grids);
+         free(mosaic);
+         return 0;
+      }
+      measure_grid(&mosaic->grids[i]);
+      mosaic->grids[i].x = mosaic->width;
+      mosaic->width += mosaic->grids[i].width + GRID_BOUNDARY_WIDTH;
+      if(i == 0)
+         mosaic->height += mosaic->grids[i].lines;
+   }
+   return mosaic;
+}
+
+unsigned long GRID_MosaicWidth(GRID_MOSAIC* mosaic)
+{
+   return mosaic->width;
+}
+
+unsigned long GRID_MosaicHeight(GRID_MOSAIC* mosaic)
+{
+   return mosaic->height;
+}
+
+/******************************************************************************/
+/*
+   GRID_ReadRow :
+   See grid.h for description.
+*/
+
+int GRID_ReadRow(GRID_MOSAIC* mosaic, char* row)
+{
+   GRID_FILE* grid;
+   unsigned long column;
+   int i, cval;
+
+   if(mosaic->next_row >= mosaic->height)
+      return 0;
+   memset(row, GRID_BACKGROUND, mosaic->width);
+   if(mosaic->next_row >= GRID_BOUNDARY_WIDTH)
+   {
+      for(i = 0; i < mosaic->count; i++)
+      {
+         grid = &mosaic->grids[i];
+         if(mosaic->next_row - GRID_BOUNDARY_WIDTH >= grid->lines)
+            continue;
+         memset(row + grid->x, '0', grid->width);
+         column = 0;
+         while((cval = getc(grid->file)) != EOF && cval != '\n')
+         {
+            if(column < grid->width)
+               row[grid->x + column] = (char)cval;
+            column++;
+         }
+      }
+   }
+   mosaic->next_row++;
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   GRID_CloseMosaic :
+   See grid.h for description.
+*/
+
+void GRID_CloseMosaic(GRID_MOSAIC* mosaic)
+{
+   int i;
+   for(i = 0; i < mosaic->count; i++)
+      fclose(mosaic->grids[i].file);
+   free(mosaic->grids);
+   free(mosaic);
+}
+
+/******************************************************************************/
+/*
+   GRID_Color :
+   See grid.h for description.
+*/
+
+const unsigned char* GRID_Color(int cval)
+{
+   static const unsigned char background[4] = {30, 30, 200, 200};
+   static const unsigned char black[4] = {0, 0, 0, 255};
+   static const unsigned char c1[4] = {10, 80, 10, 255};
+   static const unsigned char c2[4] = {10, 150, 10, 255};
+   static const unsigned char c3[4] = {10, 255, 20, 255};
+   static const unsigned char c9[4] = {255, 10, 10, 255};
+   static const unsigned char c8[4] = {150, 10, 10, 255};
+   static const unsigned char c7[4] = {80, 10, 10, 255};
+
+   switch(cval)
+   {
+   case GRID_BACKGROUND: return background;
+   case '1': return c1;
+   case '2': return c2;
+   case '3': return c3;
+   case '9': return c9;
+   case '8': return c8;
+   case '7': return c7;
+   }
+   return black;
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file grid.h for reading grid files (one character per
+cell, one line per row, as written by csv2grid.rb and chrcompare) laid out side
+by side into a mosaic, the way grid2png.rb draws them:
+
+   - every grid is as wide as its first line, the mosaic is as tall as the
+     first grid plus the boundary,
+   - GRID_BOUNDARY_WIDTH cells of background surround and separate the grids,
+   - a grid row shorter than the grid is padded with '0', characters past the
+     grid width are dropped, rows past the end of a grid are background.
+
+The mosaic is read a row at a time, so memory depends on its width only.
+*******************************************************************************/
+
+/* Cells of background between and around the grids */
+#define GRID_BOUNDARY_WIDTH 1
+
+/* Mosaic cell value for the background, below every grid character */
+#define GRID_BACKGROUND 0
+
+/* An open mosaic. The fields are private to grid.c */
+typedef struct GRIDMOSAIC GRID_MOSAIC;
+
+/******************************************************************************/
+/*
+   GRID_OpenMosaic :
+   Opens the grid files and measures them (one pass over each).
+
+   Input : The number of grid files and their names.
+
+   Output: The mosaic, 0 if a file could not be opened (a message is printed).
+*/
+
+GRID_MOSAIC* GRID_OpenMosaic(int count, char* names[]);
+
+/******************************************************************************/
+/*
+   GRID_MosaicWidth, GRID_MosaicHeight :
+   The size of the mosaic in cells, boundary included.
+*/
+
+unsigned long GRID_MosaicWidth(GRID_MOSAIC* mosaic);
+unsigned long GRID_MosaicHeight(GRID_MOSAIC* mosaic);
+
+/******************************************************************************/
+/*
+   GRID_ReadRow :
+   Reads the next row of the mosaic, top to bottom.
+
+   Input : The mosaic and a row of GRID_MosaicWidth characters to fill.
+
+   Output: 1 if a row was read, 0 after the last row.
+*/
+
+int GRID_ReadRow(GRID_MOSAIC* mosaic, char* row);
+
+/******************************************************************************/
+/*
+   GRID_CloseMosaic :
+   Closes the grid files and frees the mosaic.
+*/
+
+void GRID_CloseMosaic(GRID_MOSAIC* mosaic);
+
+/******************************************************************************/
+/*
+   GRID_Color :
+   The RGBA color grid2png.rb gives a mosaic cell: green shades for '1' '2' '3',
+   red shades for '7' '8' '9', blue background, black for anything else.
+
+   Input : The cell value.
+
+   Output: 4 bytes, red, green, blue and alpha.
+*/
+
+const unsigned char* GRID_Color(int cval);
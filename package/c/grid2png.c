@@ -0,0 +1,71 @@
+#include "grid.h"
+#include "png.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Usage()
+{
+	printf("Usage: grid2png <png file> <grid file1> [<grid file2>...<grid fileN>]\n");
+	printf("\n");
+	printf(" Renders the grids side by side into a single image, one pixel per grid cell.\n");
+	printf(" Each grid is as wide as its first line, the image is as tall as the first grid.\n");
+	printf(" The grids are streamed a row at a time so memory does not grow with their height.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	GRID_MOSAIC* mosaic;
+	PNG_WRITER* png;
+	char* cells;
+	unsigned char* row;
+	unsigned long width;
+	unsigned long x;
+
+	if (argc < 3)
+	{
+		Usage();
+		return 0;
+	}
+
+	mosaic = GRID_OpenMosaic(argc - 2, argv + 2);
+	if (mosaic == 0)
+	{
+		return 0;
+	}
+	width = GRID_MosaicWidth(mosaic);
+	printf("xDimension %lu, yDimension %lu\n", width, GRID_MosaicHeight(mosaic));
+
+	cells = (char*)malloc(width);
+	row = (unsigned char*)malloc(width*PNG_BYTES_PER_PIXEL);
+	if (cells == 0 || row == 0)
+	{
+		printf("\nOut of memory.\n");
+		return 0;
+	}
+	png = PNG_Open(argv[1], width, GRID_MosaicHeight(mosaic));
+	if (png == 0)
+	{
+		printf("\nCould not create file %s.\n", argv[1]);
+		return 0;
+	}
+
+	while (GRID_ReadRow(mosaic, cells))
+	{
+		for (x = 0; x < width; x++)
+		{
+			memcpy(row + x*PNG_BYTES_PER_PIXEL, GRID_Color(cells[x]), PNG_BYTES_PER_PIXEL);
+		}
+		PNG_WriteRow(png, row);
+	}
+
+	GRID_CloseMosaic(mosaic);
+	free(cells);
+	free(row);
+	if (!PNG_Close(png))
+	{
+		printf("\nError writing file %s.\n", argv[1]);
+		return 1;
+	}
+	return 0;
+}
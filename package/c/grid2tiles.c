@@ -0,0 +1,236 @@
+#define _POSIX_C_SOURCE 200112L
+#include "grid.h"
+#include "png.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* pixels on a side of a tile */
+#define TILE_SIZE 256
+
+void Usage()
+{
+	printf("Usage: grid2tiles <name> <grid file1> [<grid file2>...<grid fileN>]\n");
+	printf("\n");
+	printf(" Renders the grids side by side, as grid2png does, into a Deep Zoom tile pyramid:\n");
+	printf("\n");
+	printf("   <name>.dzi                            image size and tile size\n");
+	printf("   <name>_files/<level>/<column>_<row>.png  %d x %d tiles (smaller at the right and bottom)\n", TILE_SIZE, TILE_SIZE);
+	printf("\n");
+	printf(" The top level is the full image, each level below is condensed by 2 (each pixel the\n");
+	printf(" largest grid value of the 2 x 2 it covers, as condense does), level 0 is 1 x 1.\n");
+	printf(" All levels are built in a single pass; memory is a band of %d rows per level.\n", TILE_SIZE);
+	printf(" View with: ruby mktileview.rb <name>.dzi > <page>.html\n");
+}
+
+/* One level of the pyramid.
+ *
+ * Rows collect in the band until it holds a row of tiles, which is then written out.
+ * Pairs of rows are pooled into the pending row of the next level down.
+ */
+typedef struct LEVEL
+{
+	/* Deep Zoom level number, the full image has the largest */
+	int number;
+	unsigned long width;
+	char* band;
+	int band_rows;
+	unsigned long tile_row;
+	char* pending;
+	int pending_rows;
+} LEVEL;
+
+LEVEL* levels = NULL;
+int number_levels = 0;
+char* name = NULL;
+char* path = NULL;
+unsigned char* pixels = NULL;
+
+/* Writes the band of a level as a row of tiles */
+void write_band( LEVEL* level )
+{
+	unsigned long x0;
+	unsigned long tile_width;
+	unsigned long x;
+	int y;
+	PNG_WRITER* png;
+
+	for (x0 = 0; x0 < level->width; x0 += TILE_SIZE)
+	{
+		tile_width = level->width - x0 < TILE_SIZE ? level->width - x0 : TILE_SIZE;
+		sprintf(path, "%s_files/%d/%lu_%lu.png", name, level->number, x0 / TILE_SIZE, level->tile_row);
+		png = PNG_Open(path, tile_width, level->band_rows);
+		if (png == NULL)
+		{
+			printf("\nCould not create file %s.\n", path);
+			exit(0);
+		}
+		for (y = 0; y < level->band_rows; y++)
+		{
+			for (x = 0; x < tile_width; x++)
+			{
+				memcpy(pixels + x*PNG_BYTES_PER_PIXEL, GRID_Color(level->band[y*level->width + x0 + x]), PNG_BYTES_PER_PIXEL);
+			}
+			PNG_WriteRow(png, pixels);
+		}
+		if (!PNG_Close(png))
+		{
+			printf("\nError writing file %s.\n", path);
+			exit(1);
+		}
+	}
+	level->band_rows = 0;
+	level->tile_row++;
+}
+
+/* Adds a row to a level (index 0 is the full image) and pools it into the next */
+void add_row( int index, const char* row )
+{
+	LEVEL* level = &levels[index];
+	LEVEL* next;
+	unsigned long x;
+
+	memcpy(level->band + level->band_rows*level->width, row, level->width);
+	level->band_rows++;
+	if (level->band_rows == TILE_SIZE)
+	{
+		write_band(level);
+	}
+	if (index + 1 == number_levels)
+	{
+		return;
+	}
+	next = &levels[index + 1];
+	for (x = 0; x < level->width; x++)
+	{
+		if ((unsigned char)row[x] > (unsigned char)next->pending[x/2])
+		{
+			next->pending[x/2] = row[x];
+		}
+	}
+	next->pending_rows++;
+	if (next->pending_rows == 2)
+	{
+		add_row(index + 1, next->pending);
+		memset(next->pending, GRID_BACKGROUND, next->width);
+		next->pending_rows = 0;
+	}
+}
+
+/* Creates a directory, fine if it is there already */
+void make_directory( const char* directory )
+{
+	struct stat status;
+	if (mkdir(directory, 0755) != 0 && (stat(directory, &status) != 0 || !S_ISDIR(status.st_mode)))
+	{
+		printf("\nCould not create directory %s.\n", directory);
+		exit(0);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	GRID_MOSAIC* mosaic;
+	FILE* dzi;
+	char* row;
+	unsigned long width;
+	unsigned long height;
+	unsigned long size;
+	int i;
+
+	if (argc < 3)
+	{
+		Usage();
+		return 0;
+	}
+	name = argv[1];
+	mosaic = GRID_OpenMosaic(argc - 2, argv + 2);
+	if (mosaic == NULL)
+	{
+		return 0;
+	}
+	width = GRID_MosaicWidth(mosaic);
+	height = GRID_MosaicHeight(mosaic);
+	printf("xDimension %lu, yDimension %lu\n", width, height);
+
+	/* levels down to 1 x 1 */
+	for (size = 1, number_levels = 1; size < width || size < height; size *= 2)
+	{
+		number_levels++;
+	}
+	levels = (LEVEL*)malloc(number_levels*sizeof(LEVEL));
+	path = (char*)malloc(strlen(name) + 64);
+	row = (char*)malloc(width);
+	pixels = (unsigned char*)malloc(TILE_SIZE*PNG_BYTES_PER_PIXEL);
+	if (levels == NULL || path == NULL || row == NULL || pixels == NULL)
+	{
+		printf("\nOut of memory.\n");
+		return 0;
+	}
+	sprintf(path, "%s_files", name);
+	make_directory(path);
+	for (i = 0, size = 1; i < number_levels; i++, size *= 2)
+	{
+		levels[i].number = number_levels - 1 - i;
+		levels[i].width = (width + size - 1) / size;
+		levels[i].band = (char*)malloc(levels[i].width*TILE_SIZE);
+		levels[i].pending = (char*)malloc(levels[i].width);
+		if (levels[i].band == NULL || levels[i].pending == NULL)
+		{
+			printf("\nOut of memory.\n");
+			return 0;
+		}
+		memset(levels[i].pending, GRID_BACKGROUND, levels[i].width);
+		levels[i].band_rows = 0;
+		levels[i].pending_rows = 0;
+		levels[i].tile_row = 0;
+		sprintf(path, "%s_files/%d", name, levels[i].number);
+		make_directory(path);
+	}
+
+	while (GRID_ReadRow(mosaic, row))
+	{
+		add_row(0, row);
+	}
+	GRID_CloseMosaic(mosaic);
+
+	/* an odd last row still makes a row of the next level; finer levels go first so
+	   their last rows reach the coarser ones before those are written */
+	for (i = 0; i < number_levels; i++)
+	{
+		if (levels[i].pending_rows > 0)
+		{
+			add_row(i, levels[i].pending);
+		}
+		if (levels[i].band_rows > 0)
+		{
+			write_band(&levels[i]);
+		}
+	}
+
+	sprintf(path, "%s.dzi", name);
+	dzi = fopen(path, "w");
+	if (dzi == NULL)
+	{
+		printf("\nCould not create file %s.\n", path);
+		return 0;
+	}
+	fprintf(dzi, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	fprintf(dzi, "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"%d\" Overlap=\"0\" Format=\"png\">\n", TILE_SIZE);
+	fprintf(dzi, "  <Size Width=\"%lu\" Height=\"%lu\"/>\n", width, height);
+	fprintf(dzi, "</Image>\n");
+	fclose(dzi);
+
+	for (i = 0; i < number_levels; i++)
+	{
+		free(levels[i].band);
+		free(levels[i].pending);
+	}
+	free(levels);
+	free(path);
+	free(row);
+	free(pixels);
+	return 0;
+}
@@ -0,0 +1,607 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file gz_input.c implementing the header file
+gz_input.h.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "sys/types.h"
+#include "sys/stat.h"
+#include "zlib.h"
+#include "gz_input.h"
+
+/* BGZF members inflated per thread in a batch, about 1 MB, and in all */
+#define GZ_BLOCKS_PER_THREAD 16
+#define GZ_MAX_BATCH_BLOCKS  1024
+/* Bytes inflated at a time from a gzip stream, and kept before them for
+   seeks back */
+#define GZ_CHUNK   (1 << 20)
+#define GZ_HISTORY (1 << 20)
+/* Compressed bytes read at a time from a gzip stream */
+#define GZ_INPUT   (1 << 16)
+/* Fixed header of a gzip member, before its extra field */
+#define GZ_HEADER  12
+
+struct GZSTREAM;
+
+/* The decompressed bytes of BGZF members [first, last) */
+typedef struct GZBATCH
+{
+   struct GZSTREAM*  stream;
+   unsigned long     first;
+   unsigned long     last;
+   unsigned char*    compressed;
+   unsigned char*    data;
+   /* The next member to inflate, taken by the threads in turn */
+   unsigned long     next;
+   int               error;
+   /* 1 while it is inflated in the background */
+   int               running;
+   pthread_t         thread;
+} GZ_BATCH;
+
+typedef struct GZSTREAM
+{
+   const char*       file_name;
+   int               file;
+   /* Read position and size of the decompressed bytes, -1 until known */
+   long              position;
+   long              size;
+   int               error;
+   /* BGZF: the file offset and decompressed start of each member (one more
+      at the end), the batch read from and the one inflated meanwhile */
+   int               bgzf;
+   unsigned long     number_blocks;
+   unsigned long*    block_offsets;
+   unsigned long*    block_starts;
+   unsigned long     threads;
+   unsigned long     batch_blocks;
+   GZ_BATCH          batches[2];
+   int               current;
+   /* Any other gzip: the stream, its input, and the bytes inflated last
+      from data_start on */
+   z_stream          z;
+   unsigned char*    input;
+   unsigned long     input_offset;
+   int               ended;
+   unsigned char*    data;
+   long              data_start;
+   unsigned long     data_length;
+} GZ_STREAM;
+
+/******************************************************************************/
+/*
+   gz_threads :
+   The threads of a batch, from GENOMEOT_THREADS as ST_Threads reads it, but
+   one per core when it is not set.
+*/
+
+static unsigned long gz_threads(void)
+{
+   const char* value = getenv("GENOMEOT_THREADS");
+   long threads = value != 0 ? atol(value) : 0;
+
+   if(threads <= 0)
+      threads = sysconf(_SC_NPROCESSORS_ONLN);
+   return threads > 0 ? (unsigned long)threads : 1;
+}
+
+/******************************************************************************/
+/*
+   gz_fail :
+   Reports a damaged file, once.
+*/
+
+static void gz_fail(GZ_STREAM* stream)
+{
+   if(!stream->error)
+      printf("File '%s' is not valid gzip.\n", stream->file_name);
+   stream->error = 1;
+}
+
+/******************************************************************************/
+/*
+   list_blocks :
+   Lists the members of a BGZF file: each must have the BC subfield with its
+   size in its extra field.
+
+   Output: 1 if the file is BGZF, 0 if not.
+*/
+
+static int list_blocks(GZ_STREAM* stream)
+{
+   unsigned char header[GZ_HEADER + 256], trailer[4];
+   unsigned long offset = 0, allocated = 0, extra, at, size = 0, block_size, file_size;
+   struct stat status;
+
+   if(fstat(stream->file, &status) != 0)
+      return 0;
+   file_size = status.st_size;
+   while(offset < file_size)
+   {
+      if(pread(stream->file, header, sizeof(header), offset) < GZ_HEADER || header[0] != 0x1f || header[1] != 0x8b
+         || header[2] != 8 || !(header[3] & 4))
+         return 0;
+      extra = header[10] | header[11] << 8;
+      block_size = 0;
+      for(at = GZ_HEADER; at + 4 <= GZ_HEADER + extra && at + 4 <= sizeof(header);
+          at += 4 + (header[at + 2] | header[at + 3] << 8))
+         if(header[at] == 'B' && header[at + 1] == 'C' && (header[at + 2] | header[at + 3] << 8) == 2
+            && at + 6 <= sizeof(header))
+            block_size = (header[at + 4] | header[at + 5] << 8) + 1;
+      if(block_size < GZ_HEADER + extra + 8 || offset + block_size > file_size
+         || pread(stream->file, trailer, 4, offset + block_size - 4) != 4)
+         return 0;
+      if(stream->number_blocks + 1 >= allocated)
+      {
+         allocated = allocated == 0 ? 1024 : allocated * 2;
+         stream->block_offsets = (unsigned long*)realloc(stream->block_offsets, allocated * sizeof(unsigned long));
+         stream->block_starts  = (unsigned long*)realloc(stream->block_starts, allocated * sizeof(unsigned long));
+         if(stream->block_offsets == 0 || stream->block_starts == 0)
+         {
+            printf("\nOut of memory.\n");
+            exit(0);
+         }
+      }
+      stream->block_offsets[stream->number_blocks] = offset;
+      stream->block_starts[stream->number_blocks]  = size;
+      stream->number_blocks++;
+      size   += trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (unsigned long)trailer[3] << 24;
+      offset += block_size;
+   }
+   if(stream->number_blocks == 0)
+      return 0;
+   stream->block_offsets[stream->number_blocks] = offset;
+   stream->block_starts[stream->number_blocks]  = size;
+   stream->size = size;
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   inflate_blocks :
+   A thread of a batch: inflates the members in turn until there are none
+   left, checking each against the length and CRC of its trailer.
+*/
+
+static void* inflate_blocks(void* argument)
+{
+   GZ_BATCH* batch = (GZ_BATCH*)argument;
+   GZ_STREAM* stream = batch->stream;
+   unsigned long block, start, length, header;
+   unsigned char* member;
+   unsigned char* trailer;
+   z_stream z;
+
+   for(;;)
+   {
+      block = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+      if(block >= batch->last)
+         break;
+      member  = batch->compressed + stream->block_offsets[block] - stream->block_offsets[batch->first];
+      length  = stream->block_offsets[block + 1] - stream->block_offsets[block];
+      header  = GZ_HEADER + (member[10] | member[11] << 8);
+      trailer = member + length - 8;
+      start   = stream->block_starts[block] - stream->block_starts[batch->first];
+      /* The empty member that ends a file */
+      if(stream->block_starts[block + 1] == stream->block_starts[block])
+         continue;
+      memset(&z, 0, sizeof(z));
+      if(inflateInit2(&z, -15) != Z_OK)
+      {
+         batch->error = 1;
+         break;
+      }
+      z.next_in   = member + header;
+      z.avail_in  = length - header - 8;
+      z.next_out  = batch->data + start;
+      z.avail_out = stream->block_starts[block + 1] - stream->block_starts[block];
+      if(inflate(&z, Z_FINISH) != Z_STREAM_END || z.avail_out != 0
+         || crc32(0L, batch->data + start, z.total_out)
+            != (trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (unsigned long)trailer[3] << 24))
+         batch->error = 1;
+      inflateEnd(&z);
+   }
+   return 0;
+}
+
+/******************************************************************************/
+/*
+   inflate_batch :
+   Reads the members of a batch and inflates them on the threads of the
+   stream (this one and helpers).
+*/
+
+static void* inflate_batch(void* argument)
+{
+   GZ_BATCH* batch = (GZ_BATCH*)argument;
+   GZ_STREAM* stream = batch->stream;
+   unsigned long compressed = stream->block_offsets[batch->last] - stream->block_offsets[batch->first];
+   unsigned long helpers = 0, i;
+   pthread_t* threads = 0;
+
+   batch->next = batch->first;
+   if(pread(stream->file, batch->compressed, compressed, stream->block_offsets[batch->first]) != (ssize_t)compressed)
+   {
+      batch->error = 1;
+      return 0;
+   }
+   if(stream->threads > 1 && batch->last - batch->first > 1)
+      threads = (pthread_t*)malloc((stream->threads - 1) * sizeof(pthread_t));
+   while(threads != 0 && helpers < stream->threads - 1 && helpers < batch->last - batch->first - 1
+         && pthread_create(threads + helpers, 0, inflate_blocks, batch) == 0)
+      helpers++;
+   inflate_blocks(batch);
+   for(i = 0; i < helpers; i++)
+      pthread_join(threads[i], 0);
+   free(threads);
+   return 0;
+}
+
+/******************************************************************************/
+/*
+   start_batch :
+   Inflates the batch from a member on, in the background or at once.
+*/
+
+static void start_batch(GZ_STREAM* stream, GZ_BATCH* batch, unsigned long first, int background)
+{
+   batch->first = first;
+   batch->last  = first + stream->batch_blocks < stream->number_blocks ? first + stream->batch_blocks
+                                                                     : stream->number_blocks;
+   batch->error = 0;
+   batch->running = background && pthread_create(&batch->thread, 0, inflate_batch, batch) == 0;
+   if(!batch->running)
+      inflate_batch(batch);
+}
+
+/******************************************************************************/
+/*
+   finish_batch :
+   Waits for a batch inflated in the background.
+*/
+
+static void finish_batch(GZ_BATCH* batch)
+{
+   if(batch->running)
+      pthread_join(batch->thread, 0);
+   batch->running = 0;
+}
+
+/******************************************************************************/
+/*
+   covers :
+   Whether a batch holds a decompressed position.
+*/
+
+static int covers(GZ_STREAM* stream, GZ_BATCH* batch, long position)
+{
+   return batch->last > batch->first && (unsigned long)position >= stream->block_starts[batch->first]
+          && (unsigned long)position < stream->block_starts[batch->last];
+}
+
+/******************************************************************************/
+/*
+   read_bgzf :
+   Reads from the batch that holds the position: the current one, the one
+   inflated meanwhile, or a new one; then has the next inflated meanwhile.
+*/
+
+static ssize_t read_bgzf(GZ_STREAM* stream, char* buffer, size_t size)
+{
+   GZ_BATCH* batch = stream->batches + stream->current;
+   GZ_BATCH* ahead = stream->batches + 1 - stream->current;
+   unsigned long low = 0, high = stream->number_blocks, middle, available;
+
+   if(stream->position >= stream->size)
+      return 0;
+   if(!covers(stream, batch, stream->position))
+   {
+      finish_batch(ahead);
+      if(covers(stream, ahead, stream->position))
+      {
+         stream->current = 1 - stream->current;
+         batch = ahead;
+         ahead = stream->batches + 1 - stream->current;
+      }
+      else
+      {
+         /* The last member that starts at or before the position */
+         while(high - low > 1)
+         {
+            middle = (low + high) / 2;
+            if(stream->block_starts[middle] <= (unsigned long)stream->position)
+               low = middle;
+            else
+               high = middle;
+         }
+         start_batch(stream, batch, low, 0);
+      }
+      if(batch->error)
+      {
+         gz_fail(stream);
+         errno = EIO;
+         return -1;
+      }
+      if(batch->last < stream->number_blocks)
+         start_batch(stream, ahead, batch->last, 1);
+   }
+   available = stream->block_starts[batch->last] - stream->position;
+   if(size > available)
+      size = available;
+   memcpy(buffer, batch->data + stream->position - stream->block_starts[batch->first], size);
+   stream->position += size;
+   return size;
+}
+
+/******************************************************************************/
+/*
+   restart :
+   Goes back to the start of a gzip stream.
+*/
+
+static void restart(GZ_STREAM* stream)
+{
+   inflateReset(&stream->z);
+   stream->z.avail_in   = 0;
+   stream->input_offset = 0;
+   stream->ended        = 0;
+   stream->data_start   = 0;
+   stream->data_length  = 0;
+}
+
+/******************************************************************************/
+/*
+   inflate_stream :
+   Inflates up to length bytes of a gzip stream into out, reading its input
+   as needed and going on to the next member at the end of one.
+
+   Output: The bytes inflated, 0 at the end, -1 on an error.
+*/
+
+static long inflate_stream(GZ_STREAM* stream, unsigned char* out, unsigned long length)
+{
+   z_stream* z = &stream->z;
+   ssize_t count;
+   int status;
+
+   z->next_out  = out;
+   z->avail_out = length;
+   while(z->avail_out > 0 && !stream->ended)
+   {
+      if(z->avail_in == 0)
+      {
+         count = pread(stream->file, stream->input, GZ_INPUT, stream->input_offset);
+         if(count < 0)
+            return -1;
+         if(count == 0)
+         {
+            /* Input ended inside a member */
+            if(z->total_in > 0)
+               return -1;
+            stream->ended = 1;
+            break;
+         }
+         stream->input_offset += count;
+         z->next_in  = stream->input;
+         z->avail_in = count;
+      }
+      status = inflate(z, Z_NO_FLUSH);
+      if(status == Z_STREAM_END)
+         inflateReset(z);
+      else if(status != Z_OK && status != Z_BUF_ERROR)
+         return -1;
+   }
+   return length - z->avail_out;
+}
+
+/******************************************************************************/
+/*
+   read_gzip :
+   Reads from the bytes inflated last, inflating further (keeping the last
+   GZ_HISTORY bytes for seeks back) or from the start again as needed.
+*/
+
+static ssize_t read_gzip(GZ_STREAM* stream, char* buffer, size_t size)
+{
+   unsigned long keep, available;
+   long count;
+
+   if(stream->position < stream->data_start)
+      restart(stream);
+   while(stream->position >= stream->data_start + (long)stream->data_length)
+   {
+      if(stream->ended)
+         return 0;
+      keep = stream->data_length < GZ_HISTORY ? stream->data_length : GZ_HISTORY;
+      memmove(stream->data, stream->data + stream->data_length - keep, keep);
+      stream->data_start += stream->data_length - keep;
+      stream->data_length = keep;
+      count = inflate_stream(stream, stream->data + keep, GZ_CHUNK);
+      if(count < 0)
+      {
+         gz_fail(stream);
+         errno = EIO;
+         return -1;
+      }
+      stream->data_length += count;
+   }
+   available = stream->data_start + stream->data_length - stream->position;
+   if(size > available)
+      size = available;
+   memcpy(buffer, stream->data + stream->position - stream->data_start, size);
+   stream->position += size;
+   return size;
+}
+
+/******************************************************************************/
+/*
+   gzip_size :
+   The decompressed size of a gzip stream, from a pass over all of it.
+*/
+
+static long gzip_size(GZ_STREAM* stream)
+{
+   long position = stream->position, size = 0;
+   unsigned char* scratch;
+   long count;
+
+   /* Count from the start with the stream of the reads, which then inflate
+      from the start again up to where they were */
+   scratch = (unsigned char*)malloc(GZ_CHUNK);
+   if(scratch == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   restart(stream);
+   while((count = inflate_stream(stream, scratch, GZ_CHUNK)) > 0)
+      size += count;
+   free(scratch);
+   restart(stream);
+   stream->position = position;
+   if(count < 0)
+   {
+      gz_fail(stream);
+      return -1;
+   }
+   return size;
+}
+
+/******************************************************************************/
+/*
+   gz_read, gz_seek, gz_close :
+   The functions of the FILE (see fopencookie).
+*/
+
+static ssize_t gz_read(void* cookie, char* buffer, size_t size)
+{
+   GZ_STREAM* stream = (GZ_STREAM*)cookie;
+
+   if(stream->error)
+   {
+      errno = EIO;
+      return -1;
+   }
+   return stream->bgzf ? read_bgzf(stream, buffer, size) : read_gzip(stream, buffer, size);
+}
+
+static int gz_seek(void* cookie, off64_t* offset, int whence)
+{
+   GZ_STREAM* stream = (GZ_STREAM*)cookie;
+   long position;
+
+   if(whence == SEEK_END && stream->size < 0)
+      stream->size = gzip_size(stream);
+   if(whence == SEEK_END && stream->size < 0)
+      return -1;
+   position = (long)*offset + (whence == SEEK_SET ? 0 : whence == SEEK_CUR ? stream->position : stream->size);
+   if(position < 0)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+   stream->position = position;
+   *offset = position;
+   return 0;
+}
+
+static int gz_close(void* cookie)
+{
+   GZ_STREAM* stream = (GZ_STREAM*)cookie;
+   int i;
+
+   for(i = 0; i < 2; i++)
+   {
+      finish_batch(stream->batches + i);
+      free(stream->batches[i].compressed);
+      free(stream->batches[i].data);
+   }
+   if(!stream->bgzf)
+      inflateEnd(&stream->z);
+   free(stream->block_offsets);
+   free(stream->block_starts);
+   free(stream->input);
+   free(stream->data);
+   close(stream->file);
+   free(stream);
+   return 0;
+}
+
+/******************************************************************************/
+/*
+   GZ_Open :
+   See gz_input.h for description.
+*/
+
+FILE* GZ_Open(const char* file_name)
+{
+   cookie_io_functions_t functions;
+   unsigned char magic[2];
+   GZ_STREAM* stream;
+   FILE* file;
+   int i, descriptor = open(file_name, O_RDONLY);
+
+   if(descriptor < 0)
+      return 0;
+   if(pread(descriptor, magic, 2, 0) != 2 || magic[0] != 0x1f || magic[1] != 0x8b)
+   {
+      close(descriptor);
+      return fopen(file_name, "rb");
+   }
+   stream = (GZ_STREAM*)calloc(1, sizeof(GZ_STREAM));
+   if(stream == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   stream->file_name = file_name;
+   stream->file      = descriptor;
+   stream->size      = -1;
+   stream->bgzf      = list_blocks(stream);
+   if(stream->bgzf)
+   {
+      stream->threads      = gz_threads();
+      stream->batch_blocks = stream->threads * GZ_BLOCKS_PER_THREAD;
+      if(stream->batch_blocks > GZ_MAX_BATCH_BLOCKS)
+         stream->batch_blocks = GZ_MAX_BATCH_BLOCKS;
+      for(i = 0; i < 2; i++)
+      {
+         stream->batches[i].stream     = stream;
+         /* Members are at most 64 KB, compressed or not */
+         stream->batches[i].compressed = (unsigned char*)malloc(stream->batch_blocks << 16);
+         stream->batches[i].data       = (unsigned char*)malloc(stream->batch_blocks << 16);
+         if(stream->batches[i].compressed == 0 || stream->batches[i].data == 0)
+         {
+            printf("\nOut of memory.\n");
+            exit(0);
+         }
+      }
+   }
+   else
+   {
+      stream->input = (unsigned char*)malloc(GZ_INPUT);
+      stream->data  = (unsigned char*)malloc(GZ_HISTORY + GZ_CHUNK);
+      /* 15 + 32: a window of 32 KB, gzip or zlib header */
+      if(stream->input == 0 || stream->data == 0 || inflateInit2(&stream->z, 15 + 32) != Z_OK)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+   }
+   functions.read  = gz_read;
+   functions.write = 0;
+   functions.seek  = gz_seek;
+   functions.close = gz_close;
+   file = fopencookie(stream, "r", functions);
+   if(file == 0)
+      gz_close(stream);
+   return file;
+}
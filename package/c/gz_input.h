@@ -0,0 +1,37 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file gz_input.h for reading input files that are
+compressed with gzip (chr1.fa.gz) as they are, with no copy decompressed to
+disk first. GZ_Open returns a FILE that reads the decompressed bytes, so the
+readers of the tools (fgetc, fread, fseek and ftell) are the same for a plain
+and a compressed file; a file that is not gzip is opened as it is.
+
+BGZF (bgzip, samtools) writes a file as gzip members of at most 64 KB, each
+telling its compressed size in its header and its decompressed size in its
+trailer. The members are listed when the file is opened, so its size is
+known and a seek goes straight to the member it lands in. They are inflated
+in batches, the members of a batch on several threads, and the batch after
+the one being read is inflated in the background meanwhile.
+
+Any other gzip file (one or more members, gzip or pigz) is inflated in one
+stream. Seeking forward inflates up to the place; seeking back beyond the last
+MB read starts again from the top, and its size (fseek to SEEK_END) takes a
+pass over the whole file, so BGZF is the one for random access (chrcompare
+file1 offsets, the reverse strand of MEM/MUM).
+
+The threads inflating BGZF are those of building trees, from the environment:
+
+   GENOMEOT_THREADS=<n>   n threads, 0 or not set for one per core
+*******************************************************************************/
+
+/******************************************************************************/
+/*
+   GZ_Open :
+   Opens a file for reading, decompressed if it is gzip.
+
+   Input : The file name.
+
+   Output: The open file (close it with fclose), 0 if it could not be opened.
+*/
+
+FILE* GZ_Open(const char* file_name);
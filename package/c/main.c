@@ -1,4 +1,6 @@
 #include "suffix_tree.h"
+#include "metrics.h"
+#include "gz_input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -63,9 +65,7 @@ int main(int argc, char* argv[])
 	FILE* file = 0;
 	DBL_WORD i,len = 0;
 
-#ifdef STATISTICS
-	counter = heap = 0;
-#endif
+	METRICS_Init("suffixtree");
 
 	/*If less then 3 arguments - print a proper message and exit the program.*/
 	if(argc < 3)
@@ -91,7 +91,7 @@ int main(int argc, char* argv[])
 	/*'s' means a file*/
 	case 'f':
 		filename = (unsigned char*)argv[2];
-		file = fopen((const char*)filename,"r");
+		file = GZ_Open((const char*)filename);
 		/*Check for validity of the file.*/
 		if(file == 0)
 		{
@@ -102,6 +102,7 @@ int main(int argc, char* argv[])
 		fseek(file, 0, SEEK_END);
 		len = ftell(file);
 		fseek(file, 0, SEEK_SET);
+		METRICS_Start(METRICS_READ);
 		str = (unsigned char*)malloc(len*sizeof(unsigned char));
 		if(str == 0)
 		{
@@ -112,6 +113,7 @@ int main(int argc, char* argv[])
 		/*When freestr = 1 it means that a temporary string has been allocated and therefor 
 		must be deleted afterwards.*/
 		freestr = 1;
+		METRICS_Stop(METRICS_READ);
 		break;
 	default:
 		PrintUsage();
@@ -125,22 +127,14 @@ int main(int argc, char* argv[])
 	if((argc == 5 && argv[4][0] == 'p') || (argv[1][0] == 't' && argc == 4 && argv[3][0] == 'p'))
 		ST_PrintTree(tree);
 
-#ifdef STATISTICS
-	printf("\nN = %lu\n",tree->length);
-	printf("Construction: Bytes allocated per text symbol   = %.3f\n", ((double)heap/tree->length));
-	printf("              Atomic operations per text symbol = %.3f\n", ((double)counter/tree->length));
-#endif
+	/* Construction and search measures: run with GENOMEOT_METRICS=1 (see metrics.h) */
 	if(argv[1][0] == 't')
 		ST_SelfTest(tree);
 	else
 	{
-#ifdef STATISTICS
-		counter = 0;
-#endif
+		METRICS_Start(METRICS_QUERY);
 		i = (DBL_WORD)ST_FindSubstring(tree, argv[3], strlen(argv[3]));
-#ifdef STATISTICS
-		printf("\nSearching:    Atomic operations per text symbol = %.3f\n", ((double)counter/strlen(argv[3])));
-#endif
+		METRICS_Stop(METRICS_QUERY);
 		if(i == ST_ERROR)
 			printf("\nResults:      String is not a substring.\n\n");
 		else
@@ -0,0 +1,276 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file metrics.c implementing the header file
+metrics.h.
+*******************************************************************************/
+
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/time.h"
+#include "sys/resource.h"
+#ifdef __linux__
+#include "sys/syscall.h"
+#include "linux/perf_event.h"
+typedef __u64 HW_VALUE;
+#else
+typedef unsigned long HW_VALUE;
+#endif
+#include "metrics.h"
+
+METRICS_COUNTERS metrics;
+__thread METRICS_COUNTERS* metrics_lookups = &metrics;
+const char* metrics_huge_pages = "none";
+const char* metrics_numa       = "default";
+
+static const char* phase_names[METRICS_PHASES] = {"read", "build", "analyze", "query", "output"};
+
+/* Hardware events counted with GENOMEOT_METRICS_HW */
+#define HW_EVENTS 4
+static const char* hw_names[HW_EVENTS] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+static struct
+{
+   int            enabled;
+   const char*    tool;
+   const char*    destination;
+   double         start;
+   double         phase_start[METRICS_PHASES];
+   double         phase_seconds[METRICS_PHASES];
+   unsigned long  phase_calls[METRICS_PHASES];
+   /* -1 when the event could not be opened */
+   int            hw_files[HW_EVENTS];
+   int            hw_requested;
+   METRICS_STAGE  stages[METRICS_MAX_STAGES];
+   int            number_stages;
+} state;
+
+static double metrics_now(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/******************************************************************************/
+/*
+   hw_open :
+   Opens the hardware counters of this process (user space only), counting from
+   now. The threads it starts from now on inherit them, and their counts are
+   added in as each one exits (the tools join their threads before the
+   report). Counters that can not be opened (no PMU, perf_event_paranoid)
+   stay -1.
+*/
+
+static void hw_open(void)
+{
+   int i;
+#ifdef __linux__
+   static const HW_VALUE configs[HW_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+   struct perf_event_attr attr;
+
+   for(i = 0; i < HW_EVENTS; i++)
+   {
+      memset(&attr, 0, sizeof(attr));
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.size           = sizeof(attr);
+      attr.config         = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.inherit        = 1;
+      state.hw_files[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+   }
+#else
+   for(i = 0; i < HW_EVENTS; i++)
+      state.hw_files[i] = -1;
+#endif
+}
+
+static void metrics_exit(void)
+{
+   FILE* out = stderr;
+
+   if(strcmp(state.destination, "1") != 0 && strcmp(state.destination, "stderr") != 0)
+   {
+      out = fopen(state.destination, "w");
+      if(out == 0)
+      {
+         fprintf(stderr, "\nCould not create file %s.\n", state.destination);
+         return;
+      }
+   }
+   METRICS_Write(out);
+   if(out != stderr)
+      fclose(out);
+}
+
+/******************************************************************************/
+/*
+   METRICS_Init :
+   See metrics.h for description.
+*/
+
+void METRICS_Init(const char* tool)
+{
+   const char* hw = getenv("GENOMEOT_METRICS_HW");
+   int i;
+
+   state.tool        = tool;
+   state.destination = getenv("GENOMEOT_METRICS");
+   state.enabled     = state.destination != 0 && state.destination[0] != 0 && strcmp(state.destination, "0") != 0;
+   if(!state.enabled)
+      return;
+   for(i = 0; i < HW_EVENTS; i++)
+      state.hw_files[i] = -1;
+   state.hw_requested = hw != 0 && hw[0] != 0 && strcmp(hw, "0") != 0;
+   if(state.hw_requested)
+      hw_open();
+   state.start = metrics_now();
+   atexit(metrics_exit);
+}
+
+/******************************************************************************/
+/*
+   METRICS_Start, METRICS_Stop :
+   See metrics.h for description.
+*/
+
+void METRICS_Start(METRICS_PHASE phase)
+{
+   if(state.enabled)
+      state.phase_start[phase] = metrics_now();
+}
+
+void METRICS_Stop(METRICS_PHASE phase)
+{
+   if(state.enabled)
+   {
+      state.phase_seconds[phase] += metrics_now() - state.phase_start[phase];
+      state.phase_calls[phase]++;
+   }
+}
+
+/******************************************************************************/
+/*
+   METRICS_Now :
+   See metrics.h for description.
+*/
+
+double METRICS_Now(void)
+{
+   return metrics_now();
+}
+
+/******************************************************************************/
+/*
+   METRICS_ThreadCounters :
+   See metrics.h for description.
+*/
+
+void METRICS_ThreadCounters(METRICS_COUNTERS* counters)
+{
+   METRICS_AddCounters();
+   if(counters == 0)
+      counters = &metrics;
+   else
+      memset(counters, 0, sizeof(METRICS_COUNTERS));
+   metrics_lookups = counters;
+}
+
+/******************************************************************************/
+/*
+   METRICS_AddCounters :
+   See metrics.h for description.
+*/
+
+void METRICS_AddCounters(void)
+{
+   if(metrics_lookups == &metrics)
+      return;
+   __atomic_fetch_add(&metrics.lookups, metrics_lookups->lookups, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&metrics.found, metrics_lookups->found, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&metrics.matched, metrics_lookups->matched, __ATOMIC_RELAXED);
+   metrics_lookups->lookups = 0;
+   metrics_lookups->found   = 0;
+   metrics_lookups->matched = 0;
+}
+
+/******************************************************************************/
+/*
+   METRICS_Stage :
+   See metrics.h for description.
+*/
+
+void METRICS_Stage(const METRICS_STAGE* stage)
+{
+   if(state.number_stages < METRICS_MAX_STAGES)
+      state.stages[state.number_stages++] = *stage;
+}
+
+/******************************************************************************/
+/*
+   METRICS_Write :
+   See metrics.h for description.
+*/
+
+void METRICS_Write(FILE* out)
+{
+   struct rusage usage;
+   HW_VALUE value;
+   double symbols = metrics.symbols > 0 ? (double)metrics.symbols : 1.0, capacity;
+   const METRICS_STAGE* stage;
+   int i, first = 1;
+
+   getrusage(RUSAGE_SELF, &usage);
+   fprintf(out, "{\"tool\":\"%s\",\"wall_seconds\":%.6f,\"peak_rss_kb\":%ld,\"phases\":{",
+      state.tool != 0 ? state.tool : "", state.enabled ? metrics_now() - state.start : 0.0, usage.ru_maxrss);
+   for(i = 0; i < METRICS_PHASES; i++)
+      fprintf(out, "%s\"%s\":{\"seconds\":%.6f,\"calls\":%lu}", i > 0 ? "," : "", phase_names[i],
+         state.phase_seconds[i], state.phase_calls[i]);
+   fprintf(out, "},\"counters\":{\"trees\":%lu,\"symbols\":%lu,\"nodes\":%lu,\"splits\":%lu,"
+      "\"extensions\":%lu,\"suffix_links\":%lu,\"skips\":%lu,\"bytes\":%lu,"
+      "\"lookups\":%lu,\"found\":%lu,\"matched\":%lu}",
+      metrics.trees, metrics.symbols, metrics.nodes, metrics.splits, metrics.extensions,
+      metrics.suffix_links, metrics.skips, metrics.bytes, metrics.lookups, metrics.found, metrics.matched);
+   fprintf(out, ",\"per_symbol\":{\"nodes\":%.4f,\"bytes\":%.4f,\"suffix_links\":%.4f,\"skips\":%.4f,\"build_ns\":%.2f}",
+      metrics.nodes / symbols, metrics.bytes / symbols, metrics.suffix_links / symbols, metrics.skips / symbols,
+      state.phase_seconds[METRICS_BUILD] * 1e9 / symbols);
+   fprintf(out, ",\"placement\":{\"huge_pages\":\"%s\",\"numa\":\"%s\",\"numa_nodes\":%lu,\"placed_bytes\":%lu,\"huge_page_bytes\":%lu,"
+      "\"numa_bytes\":%lu,\"pinned_threads\":%lu}",
+      metrics_huge_pages, metrics_numa, metrics.numa_nodes, metrics.placed_bytes, metrics.huge_page_bytes, metrics.numa_bytes,
+      metrics.pinned_threads);
+   if(state.number_stages > 0)
+   {
+      fprintf(out, ",\"stages\":[");
+      for(i = 0; i < state.number_stages; i++)
+      {
+         stage = state.stages + i;
+         capacity = stage->threads * stage->wall_seconds;
+         fprintf(out, "%s{\"name\":\"%s\",\"threads\":%lu,\"items\":%lu,\"busy_seconds\":%.6f,"
+            "\"input_wait_seconds\":%.6f,\"output_wait_seconds\":%.6f,\"utilization\":%.4f}", i > 0 ? "," : "",
+            stage->name, stage->threads, stage->items, stage->busy_seconds, stage->input_wait_seconds,
+            stage->output_wait_seconds, capacity > 0 ? stage->busy_seconds / capacity : 0.0);
+      }
+      fprintf(out, "]");
+   }
+   if(state.hw_requested)
+   {
+      fprintf(out, ",\"hardware\":{");
+      for(i = 0; i < HW_EVENTS; i++)
+      {
+         if(state.hw_files[i] < 0 || read(state.hw_files[i], &value, sizeof(value)) != sizeof(value))
+            continue;
+         fprintf(out, "%s\"%s\":%lu", first ? "" : ",", hw_names[i], (unsigned long)value);
+         first = 0;
+      }
+      if(first)
+         fprintf(out, "\"error\":\"unavailable\"");
+      fprintf(out, "}");
+   }
+   fprintf(out, "}\n");
+}
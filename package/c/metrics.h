@@ -0,0 +1,158 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file metrics.h for the run time measures of the suffix
+tree tools. The counters are always compiled in and always counted (once per
+event, never per character or per sibling scanned); the timers and the report
+are switched on at run time by the environment:
+
+   GENOMEOT_METRICS=1            report to stderr when the tool exits
+   GENOMEOT_METRICS=<file name>  report to the file instead
+   GENOMEOT_METRICS_HW=1         also count cache and branch misses with
+                                 perf_event_open (Linux, when permitted), over
+                                 every thread started after METRICS_Init
+
+The report is a single JSON object: the tool, wall time, time per phase, the
+counters, per symbol costs, peak resident memory, the placement of index
+memory and threads (see placement.h) and the utilization of the stages of a
+pipeline (see stage_queue.h).
+*******************************************************************************/
+
+#include "stdio.h"
+
+/* Timed phases of a run */
+typedef enum METRICS_PHASE
+{
+   METRICS_READ,
+   METRICS_BUILD,
+   METRICS_ANALYZE,
+   METRICS_QUERY,
+   METRICS_OUTPUT,
+   METRICS_PHASES
+} METRICS_PHASE;
+
+typedef struct METRICSCOUNTERS
+{
+   /* Text symbols of all trees built, $ included */
+   unsigned long   symbols;
+   unsigned long   trees;
+   /* Nodes created, of them internal nodes made by splitting an edge */
+   unsigned long   nodes;
+   unsigned long   splits;
+   /* Extensions (SEA), suffix links followed, edges hopped by the skip trick */
+   unsigned long   extensions;
+   unsigned long   suffix_links;
+   unsigned long   skips;
+   /* Bytes allocated for trees */
+   unsigned long   bytes;
+   /* ST_FindSubstring calls, found ones and symbols of the pattern matched */
+   unsigned long   lookups;
+   unsigned long   found;
+   unsigned long   matched;
+   /* NUMA nodes of the host (0 if no placement was read), bytes of index
+      memory placed, of them on huge pages and under a NUMA policy, and build
+      threads pinned to a core */
+   unsigned long   numa_nodes;
+   unsigned long   placed_bytes;
+   unsigned long   huge_page_bytes;
+   unsigned long   numa_bytes;
+   unsigned long   pinned_threads;
+} METRICS_COUNTERS;
+
+extern METRICS_COUNTERS metrics;
+
+/* The counters the lookups of the calling thread count in: metrics, or the
+   thread's own (METRICS_ThreadCounters) when threads search at the same
+   time, so they neither race on metrics nor share its cache line */
+extern __thread METRICS_COUNTERS* metrics_lookups;
+
+/* Most pipeline stages reported */
+#define METRICS_MAX_STAGES 8
+
+/* A stage of a pipeline, over its threads */
+typedef struct METRICSSTAGE
+{
+   const char*     name;
+   unsigned long   threads;
+   /* Items done (sections for chrcompare) */
+   unsigned long   items;
+   /* Time working, waiting for an item and waiting for room to pass it on,
+      and the time the pipeline ran */
+   double          busy_seconds;
+   double          input_wait_seconds;
+   double          output_wait_seconds;
+   double          wall_seconds;
+} METRICS_STAGE;
+/* The placement of index memory asked for: huge pages "none", "transparent"
+   or "explicit", NUMA policy "default", "interleave" or "node <n>" */
+extern const char* metrics_huge_pages;
+extern const char* metrics_numa;
+
+/******************************************************************************/
+/*
+   METRICS_Init :
+   Reads the environment; if metrics are on, starts the wall clock (and the
+   hardware counters) and has the report written when the tool exits.
+
+   Input : The tool name for the report.
+*/
+
+void METRICS_Init(const char* tool);
+
+/******************************************************************************/
+/*
+   METRICS_Start, METRICS_Stop :
+   Time a phase, the time adds up over every Start - Stop pair. Nothing is done
+   when metrics are off.
+*/
+
+void METRICS_Start(METRICS_PHASE phase);
+void METRICS_Stop(METRICS_PHASE phase);
+
+/******************************************************************************/
+/*
+   METRICS_Now :
+   Returns the time of a monotonic clock, in seconds.
+*/
+
+double METRICS_Now(void);
+
+/******************************************************************************/
+/*
+   METRICS_ThreadCounters :
+   Has the lookups of the calling thread counted in counters of its own, or
+   in metrics again; what its own counters hold is added to metrics first.
+
+   Input : The thread's counters (zeroed here), 0 for metrics.
+*/
+
+void METRICS_ThreadCounters(METRICS_COUNTERS* counters);
+
+/******************************************************************************/
+/*
+   METRICS_AddCounters :
+   Adds the lookups counted in the calling thread's own counters to metrics
+   and zeroes them, after each item the thread does so that the progress
+   sees them. Threads add at the same time, atomically.
+*/
+
+void METRICS_AddCounters(void);
+
+/******************************************************************************/
+/*
+   METRICS_Stage :
+   Adds a stage of a pipeline to the report, with its utilization (busy time
+   over threads times wall time). Stages past METRICS_MAX_STAGES are left
+   out.
+*/
+
+void METRICS_Stage(const METRICS_STAGE* stage);
+
+/******************************************************************************/
+/*
+   METRICS_Write :
+   Writes the report as one line of JSON.
+
+   Input : The file to write to.
+*/
+
+void METRICS_Write(FILE* out);
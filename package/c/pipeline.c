@@ -0,0 +1,599 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+void Usage()
+{
+	printf("Usage: pipeline <pipeline file> [<cores>] [DRYRUN]\n");
+	printf("\n");
+	printf(" Runs the steps of <pipeline file>, independent steps in parallel using at most <cores>\n");
+	printf(" cores (default: all online cores). A step is skipped when its key matches the key of its\n");
+	printf(" last successful run and its outputs exist. The key hashes the step's command (which holds\n");
+	printf(" its parameters), the size and modification time of its inputs and the keys of the steps\n");
+	printf(" it depends on, so a change anywhere upstream reruns everything downstream of it.\n");
+	printf(" [DRYRUN] prints the steps that would run without running them.\n");
+	printf("\n");
+	printf(" Pipeline file, one step per block:\n");
+	printf("\n");
+	printf("   step <name>\n");
+	printf("   cmd <shell command>\n");
+	printf("   in <input file>        (any number; a file another step outputs makes a dependency)\n");
+	printf("   out <output file>      (any number)\n");
+	printf("   after <step name>      (any number; a dependency without a shared file)\n");
+	printf("   cores <number>         (cores the command uses, default 1)\n");
+	printf("   end\n");
+	printf("\n");
+	printf(" Blank lines and lines starting with '#' are ignored. Keys, and each step's output\n");
+	printf(" (stdout and stderr), are kept in <pipeline file>.state/\n");
+}
+
+/* states of a step */
+#define WAITING 0
+#define RUNNING 1
+#define DONE 2
+#define SKIPPED 3
+#define FAILED 4
+#define BLOCKED 5
+
+typedef struct STEP
+{
+	char* name;
+	char* command;
+	char** inputs;
+	int number_inputs;
+	char** outputs;
+	int number_outputs;
+	char** after;
+	int number_after;
+	/* indices of the steps this one depends on, from after and inputs */
+	int* depends;
+	int number_depends;
+	int cores;
+	int state;
+	pid_t pid;
+	unsigned long key;
+	time_t start;
+} STEP;
+
+STEP* steps = NULL;
+int number_steps = 0;
+char* state_folder = NULL;
+
+/* 64 bit FNV-1a, continuing from hash */
+#define HASH_START 14695981039346656037UL
+unsigned long hash_bytes( unsigned long hash, const void* data, size_t length )
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t i;
+	for (i = 0; i < length; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211UL;
+	}
+	return hash;
+}
+
+unsigned long hash_string( unsigned long hash, const char* text )
+{
+	/* the terminator too, so "ab","c" and "a","bc" differ */
+	return hash_bytes(hash, text, strlen(text) + 1);
+}
+
+char* copy_string( const char* text )
+{
+	char* copy = (char*)malloc(strlen(text) + 1);
+	if (copy == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(1);
+	}
+	strcpy(copy, text);
+	return copy;
+}
+
+void add_string( char*** list, int* count, const char* text )
+{
+	*list = (char**)realloc(*list, (*count + 1)*sizeof(char*));
+	if (*list == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(1);
+	}
+	(*list)[(*count)++] = copy_string(text);
+}
+
+int find_step( const char* name )
+{
+	int i;
+	for (i = 0; i < number_steps; i++)
+	{
+		if (strcmp(steps[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void add_depend( STEP* step, int index )
+{
+	int i;
+	for (i = 0; i < step->number_depends; i++)
+	{
+		if (step->depends[i] == index)
+		{
+			return;
+		}
+	}
+	step->depends = (int*)realloc(step->depends, (step->number_depends + 1)*sizeof(int));
+	if (step->depends == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(1);
+	}
+	step->depends[step->number_depends++] = index;
+}
+
+/* Reads the pipeline file, returns 0 (after printing why) if it is not valid */
+int read_pipeline( const char* file_name )
+{
+	FILE* file;
+	char line[8192];
+	char* keyword;
+	char* value;
+	char* end;
+	STEP* step = NULL;
+	int line_number = 0;
+	int i;
+	int j;
+	int k;
+	int l;
+
+	file = fopen(file_name, "r");
+	if (file == NULL)
+	{
+		printf("File '%s' NOT FOUND.\n", file_name);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		line_number++;
+		end = line + strlen(line);
+		while (end > line && (*(end - 1) == '\n' || *(end - 1) == '\r' || *(end - 1) == ' ' || *(end - 1) == '\t'))
+		{
+			*(--end) = 0;
+		}
+		keyword = line;
+		while (*keyword == ' ' || *keyword == '\t')
+		{
+			keyword++;
+		}
+		if (*keyword == 0 || *keyword == '#')
+		{
+			continue;
+		}
+		value = keyword;
+		while (*value != 0 && *value != ' ' && *value != '\t')
+		{
+			value++;
+		}
+		if (*value != 0)
+		{
+			*(value++) = 0;
+			while (*value == ' ' || *value == '\t')
+			{
+				value++;
+			}
+		}
+
+		if (strcmp(keyword, "step") == 0)
+		{
+			if (step != NULL || *value == 0 || find_step(value) >= 0)
+			{
+				printf("%s line %d: step without a name, inside another step or named twice.\n", file_name, line_number);
+				return 0;
+			}
+			steps = (STEP*)realloc(steps, (number_steps + 1)*sizeof(STEP));
+			if (steps == NULL)
+			{
+				printf("\nOut of memory.\n");
+				exit(1);
+			}
+			step = &steps[number_steps++];
+			memset(step, 0, sizeof(STEP));
+			step->name = copy_string(value);
+			step->cores = 1;
+			step->state = WAITING;
+		}
+		else if (step == NULL)
+		{
+			printf("%s line %d: '%s' outside of a step.\n", file_name, line_number, keyword);
+			return 0;
+		}
+		else if (strcmp(keyword, "cmd") == 0)
+		{
+			free(step->command);
+			step->command = copy_string(value);
+		}
+		else if (strcmp(keyword, "in") == 0)
+		{
+			add_string(&step->inputs, &step->number_inputs, value);
+		}
+		else if (strcmp(keyword, "out") == 0)
+		{
+			add_string(&step->outputs, &step->number_outputs, value);
+		}
+		else if (strcmp(keyword, "after") == 0)
+		{
+			add_string(&step->after, &step->number_after, value);
+		}
+		else if (strcmp(keyword, "cores") == 0)
+		{
+			step->cores = atoi(value) > 0 ? atoi(value) : 1;
+		}
+		else if (strcmp(keyword, "end") == 0)
+		{
+			if (step->command == NULL)
+			{
+				printf("%s line %d: step '%s' has no cmd.\n", file_name, line_number, step->name);
+				return 0;
+			}
+			step = NULL;
+		}
+		else
+		{
+			printf("%s line %d: unknown keyword '%s'.\n", file_name, line_number, keyword);
+			return 0;
+		}
+	}
+	fclose(file);
+	if (step != NULL)
+	{
+		printf("%s: step '%s' has no end.\n", file_name, step->name);
+		return 0;
+	}
+
+	/* dependencies: named ones, and the steps that output the inputs */
+	for (i = 0; i < number_steps; i++)
+	{
+		for (j = 0; j < steps[i].number_after; j++)
+		{
+			k = find_step(steps[i].after[j]);
+			if (k < 0)
+			{
+				printf("%s: step '%s' is after unknown step '%s'.\n", file_name, steps[i].name, steps[i].after[j]);
+				return 0;
+			}
+			add_depend(&steps[i], k);
+		}
+		for (j = 0; j < steps[i].number_inputs; j++)
+		{
+			for (k = 0; k < number_steps; k++)
+			{
+				for (l = 0; l < steps[k].number_outputs; l++)
+				{
+					if (k != i && strcmp(steps[i].inputs[j], steps[k].outputs[l]) == 0)
+					{
+						add_depend(&steps[i], k);
+					}
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/* Path of a file kept for a step in the state folder */
+char* state_path( STEP* step, const char* suffix )
+{
+	char* path = (char*)malloc(strlen(state_folder) + strlen(step->name) + strlen(suffix) + 2);
+	char* scanner;
+	if (path == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(1);
+	}
+	sprintf(path, "%s/", state_folder);
+	scanner = path + strlen(path);
+	strcat(path, step->name);
+	for (; *scanner != 0; scanner++)
+	{
+		if (*scanner == '/')
+		{
+			*scanner = '_';
+		}
+	}
+	strcat(path, suffix);
+	return path;
+}
+
+/* The key of a step whose dependencies are done */
+unsigned long step_key( STEP* step )
+{
+	unsigned long hash = hash_string(HASH_START, step->command);
+	struct stat status;
+	long fingerprint[3];
+	int i;
+
+	for (i = 0; i < step->number_inputs; i++)
+	{
+		hash = hash_string(hash, step->inputs[i]);
+		memset(fingerprint, 0, sizeof(fingerprint));
+		if (stat(step->inputs[i], &status) == 0)
+		{
+			fingerprint[0] = (long)status.st_size;
+			fingerprint[1] = (long)status.st_mtim.tv_sec;
+			fingerprint[2] = (long)status.st_mtim.tv_nsec;
+		}
+		hash = hash_bytes(hash, fingerprint, sizeof(fingerprint));
+	}
+	for (i = 0; i < step->number_depends; i++)
+	{
+		hash = hash_bytes(hash, &steps[step->depends[i]].key, sizeof(unsigned long));
+	}
+	return hash;
+}
+
+int outputs_exist( STEP* step )
+{
+	struct stat status;
+	int i;
+	for (i = 0; i < step->number_outputs; i++)
+	{
+		if (stat(step->outputs[i], &status) != 0)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* 1 if the key of the last successful run is the step's key and the outputs are there */
+int up_to_date( STEP* step )
+{
+	char* path = state_path(step, ".key");
+	FILE* file = fopen(path, "r");
+	unsigned long saved = 0;
+	int matched = 0;
+
+	if (file != NULL)
+	{
+		matched = fscanf(file, "%lx", &saved) == 1 && saved == step->key;
+		fclose(file);
+	}
+	free(path);
+	return matched && outputs_exist(step);
+}
+
+void save_key( STEP* step, int valid )
+{
+	char* path = state_path(step, ".key");
+	FILE* file;
+	if (!valid)
+	{
+		remove(path);
+	}
+	else if ((file = fopen(path, "w")) != NULL)
+	{
+		fprintf(file, "%lx\n", step->key);
+		fclose(file);
+	}
+	free(path);
+}
+
+void start_step( STEP* step )
+{
+	char* log_path = state_path(step, ".log");
+	int log_file;
+
+	/* a run that is cut short must not leave the old key looking valid */
+	save_key(step, 0);
+	step->start = time(NULL);
+	step->pid = fork();
+	if (step->pid < 0)
+	{
+		printf("Could not start step '%s'.\n", step->name);
+		exit(1);
+	}
+	if (step->pid == 0)
+	{
+		log_file = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (log_file >= 0)
+		{
+			dup2(log_file, 1);
+			dup2(log_file, 2);
+			close(log_file);
+		}
+		execl("/bin/sh", "sh", "-c", step->command, (char*)NULL);
+		_exit(127);
+	}
+	step->state = RUNNING;
+	printf("[run]  %s\n", step->name);
+	fflush(stdout);
+	free(log_path);
+}
+
+int main(int argc, char* argv[])
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int dry_run = 0;
+	int cores_in_use = 0;
+	int running = 0;
+	int progress = 1;
+	int failed = 0;
+	int ran = 0;
+	int skipped = 0;
+	int ready;
+	int status;
+	int i;
+	int j;
+	pid_t pid;
+	STEP* step;
+
+	if (argc < 2)
+	{
+		Usage();
+		return 0;
+	}
+	for (i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "DRYRUN") == 0)
+		{
+			dry_run = 1;
+		}
+		else if (atoi(argv[i]) > 0)
+		{
+			cores = atoi(argv[i]);
+		}
+		else
+		{
+			Usage();
+			return 0;
+		}
+	}
+	if (cores < 1)
+	{
+		cores = 1;
+	}
+	if (!read_pipeline(argv[1]))
+	{
+		return 1;
+	}
+	state_folder = (char*)malloc(strlen(argv[1]) + 8);
+	sprintf(state_folder, "%s.state", argv[1]);
+	if (mkdir(state_folder, 0755) != 0 && access(state_folder, W_OK) != 0)
+	{
+		printf("Could not create folder '%s'.\n", state_folder);
+		return 1;
+	}
+
+	while (progress || running > 0)
+	{
+		progress = 0;
+		for (i = 0; i < number_steps; i++)
+		{
+			step = &steps[i];
+			if (step->state != WAITING)
+			{
+				continue;
+			}
+			ready = 1;
+			for (j = 0; j < step->number_depends; j++)
+			{
+				switch (steps[step->depends[j]].state)
+				{
+				case FAILED:
+				case BLOCKED:
+					step->state = BLOCKED;
+					progress = 1;
+					break;
+				case DONE:
+				case SKIPPED:
+					break;
+				default:
+					ready = 0;
+				}
+			}
+			if (step->state != WAITING || !ready)
+			{
+				continue;
+			}
+			step->key = step_key(step);
+			if (up_to_date(step))
+			{
+				step->state = SKIPPED;
+				skipped++;
+				progress = 1;
+				printf("[skip] %s\n", step->name);
+				continue;
+			}
+			if (dry_run)
+			{
+				/* what depends on it would see a new key */
+				step->key = ~step->key;
+				step->state = DONE;
+				ran++;
+				progress = 1;
+				printf("[run]  %s\n       %s\n", step->name, step->command);
+				continue;
+			}
+			/* a step wanting more than all the cores runs alone */
+			if (failed || (cores_in_use > 0 && cores_in_use + step->cores > cores))
+			{
+				continue;
+			}
+			start_step(step);
+			cores_in_use += step->cores;
+			running++;
+			progress = 1;
+		}
+		if (running == 0)
+		{
+			continue;
+		}
+
+		pid = wait(&status);
+		if (pid < 0)
+		{
+			break;
+		}
+		for (i = 0; i < number_steps; i++)
+		{
+			step = &steps[i];
+			if (step->state != RUNNING || step->pid != pid)
+			{
+				continue;
+			}
+			running--;
+			cores_in_use -= step->cores;
+			progress = 1;
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && outputs_exist(step))
+			{
+				step->state = DONE;
+				ran++;
+				save_key(step, 1);
+				printf("[done] %s (%lds)\n", step->name, (long)(time(NULL) - step->start));
+			}
+			else
+			{
+				step->state = FAILED;
+				failed++;
+				if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+				{
+					printf("[fail] %s: an output is missing, see %s/\n", step->name, state_folder);
+				}
+				else
+				{
+					printf("[fail] %s: exit status %d, see %s/\n", step->name, WIFEXITED(status) ? WEXITSTATUS(status) : -1, state_folder);
+				}
+			}
+			fflush(stdout);
+		}
+	}
+
+	j = 0;
+	for (i = 0; i < number_steps; i++)
+	{
+		if (steps[i].state == WAITING)
+		{
+			if (!failed)
+			{
+				printf("[wait] %s: depends on itself\n", steps[i].name);
+			}
+			j++;
+		}
+		else if (steps[i].state == BLOCKED)
+		{
+			j++;
+		}
+	}
+	printf("%d steps: %d %s, %d skipped, %d failed, %d not run\n", number_steps, ran, dry_run ? "to run" : "run", skipped, failed, j);
+	return (failed > 0 || j > 0) ? 1 : 0;
+}
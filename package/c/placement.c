@@ -0,0 +1,236 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file placement.c implementing the header file
+placement.h.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "sys/mman.h"
+#ifdef __linux__
+#include "sched.h"
+#include "sys/syscall.h"
+#include "linux/mempolicy.h"
+#endif
+#include "metrics.h"
+#include "placement.h"
+
+/* Size of an explicit huge page, the x86-64 and arm64 default */
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+/* Most NUMA nodes of a policy */
+#define MAX_NUMA_NODES 1024
+
+#define HUGE_NONE         0
+#define HUGE_TRANSPARENT  1
+#define HUGE_EXPLICIT     2
+
+static struct
+{
+   int            huge_pages;
+   /* -1 none, -2 interleave, else the node */
+   long           numa;
+   int            pin;
+   /* Number of NUMA nodes (the highest possible one plus 1) */
+   unsigned long  numa_nodes;
+#ifdef __linux__
+   /* The cores of the process before any thread was pinned, 0 if unknown */
+   cpu_set_t      allowed;
+   int            cores;
+#endif
+} state;
+
+static pthread_once_t  read_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t pin_lock  = PTHREAD_MUTEX_INITIALIZER;
+
+/******************************************************************************/
+/*
+   numa_nodes :
+   Returns the number of NUMA nodes of the host from sysfs, 1 if it is not
+   there.
+*/
+
+static unsigned long numa_nodes(void)
+{
+   FILE* file = fopen("/sys/devices/system/node/possible", "r");
+   char  line[64];
+   char* last;
+
+   if(file == 0)
+      return 1;
+   if(fgets(line, sizeof(line), file) == 0)
+   {
+      fclose(file);
+      return 1;
+   }
+   fclose(file);
+   /* "0" or "0-3", the highest node last */
+   last = strrchr(line, '-');
+   return strtoul(last != 0 ? last + 1 : line, 0, 10) + 1;
+}
+
+/******************************************************************************/
+/*
+   environment_read :
+   Reads the environment, and records the placement for the metrics report.
+*/
+
+static void environment_read(void)
+{
+   static const char* huge_names[] = {"none", "transparent", "explicit"};
+   static char numa_name[32];
+   const char* huge = getenv("GENOMEOT_HUGEPAGES");
+   const char* numa = getenv("GENOMEOT_NUMA");
+   const char* pin  = getenv("GENOMEOT_PIN");
+
+   state.huge_pages = huge != 0 ? atoi(huge) : HUGE_NONE;
+   if(state.huge_pages > HUGE_EXPLICIT)
+      state.huge_pages = HUGE_EXPLICIT;
+   if(state.huge_pages < HUGE_NONE)
+      state.huge_pages = HUGE_NONE;
+   state.numa_nodes = numa_nodes();
+   state.numa = -1;
+#ifdef __linux__
+   /* Interleaving one node, or binding to a node the host does not have, is
+      no policy */
+   if(numa != 0 && strcmp(numa, "interleave") == 0 && state.numa_nodes > 1)
+      state.numa = -2;
+   else if(numa != 0 && numa[0] >= '0' && numa[0] <= '9' && (unsigned long)atol(numa) < state.numa_nodes)
+      state.numa = atol(numa);
+#endif
+   state.pin = pin != 0 && atoi(pin) != 0;
+#ifdef __linux__
+   if(sched_getaffinity(0, sizeof(state.allowed), &state.allowed) == 0)
+      state.cores = CPU_COUNT(&state.allowed);
+#endif
+
+   if(state.numa >= 0)
+      sprintf(numa_name, "node %ld", state.numa);
+   else
+      strcpy(numa_name, state.numa == -2 ? "interleave" : "default");
+   metrics.numa_nodes = state.numa_nodes;
+   metrics_huge_pages = huge_names[state.huge_pages];
+   metrics_numa       = numa_name;
+}
+
+/* Reads the environment the first time, from whichever thread */
+static void placement_read(void)
+{
+   pthread_once(&read_once, environment_read);
+}
+
+/******************************************************************************/
+/*
+   PLACEMENT_Active :
+   See placement.h for description.
+*/
+
+int PLACEMENT_Active(void)
+{
+   placement_read();
+   return state.huge_pages != HUGE_NONE || state.numa != -1;
+}
+
+/******************************************************************************/
+/*
+   PLACEMENT_Alloc :
+   See placement.h for description.
+*/
+
+void* PLACEMENT_Alloc(unsigned long size)
+{
+   void* block = MAP_FAILED;
+#ifdef __linux__
+   unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+   unsigned long node;
+#endif
+
+   placement_read();
+   if(size == 0)
+      size = 1;
+   /* Whole huge pages, whichever kind the block ends up on */
+   if(state.huge_pages == HUGE_EXPLICIT)
+      size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+   if(state.huge_pages == HUGE_EXPLICIT)
+   {
+      block = mmap(0, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if(block != MAP_FAILED)
+         metrics.huge_page_bytes += size;
+   }
+#endif
+   if(block == MAP_FAILED)
+   {
+      block = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(block == MAP_FAILED)
+         return 0;
+#ifdef MADV_HUGEPAGE
+      /* No page is touched yet, so the policies below hold for all of them */
+      if(state.huge_pages != HUGE_NONE && madvise(block, size, MADV_HUGEPAGE) == 0)
+         metrics.huge_page_bytes += size;
+#endif
+   }
+#ifdef __linux__
+   if(state.numa != -1 && state.numa_nodes <= MAX_NUMA_NODES)
+   {
+      memset(mask, 0, sizeof(mask));
+      for(node = 0; node < state.numa_nodes; node++)
+         if(state.numa == -2 || (long)node == state.numa)
+            mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+      if(syscall(SYS_mbind, block, size, state.numa == -2 ? MPOL_INTERLEAVE : MPOL_BIND, mask,
+                 state.numa_nodes + 1, 0) == 0)
+         metrics.numa_bytes += size;
+   }
+#endif
+   metrics.placed_bytes += size;
+   return block;
+}
+
+/******************************************************************************/
+/*
+   PLACEMENT_Free :
+   See placement.h for description.
+*/
+
+void PLACEMENT_Free(void* block, unsigned long size)
+{
+   if(size == 0)
+      size = 1;
+   if(state.huge_pages == HUGE_EXPLICIT)
+      size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+   munmap(block, size);
+}
+
+/******************************************************************************/
+/*
+   PLACEMENT_PinThread :
+   See placement.h for description.
+*/
+
+void PLACEMENT_PinThread(unsigned long thread)
+{
+#ifdef __linux__
+   cpu_set_t one;
+   unsigned long cpu, seen = 0;
+
+   placement_read();
+   if(!state.pin || state.cores == 0)
+      return;
+   for(cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      if(CPU_ISSET(cpu, &state.allowed) && seen++ == thread % state.cores)
+         break;
+   CPU_ZERO(&one);
+   CPU_SET(cpu, &one);
+   /* The calling thread only, the others keep their own mask */
+   if(sched_setaffinity(0, sizeof(one), &one) == 0)
+   {
+      pthread_mutex_lock(&pin_lock);
+      metrics.pinned_threads++;
+      pthread_mutex_unlock(&pin_lock);
+   }
+#endif
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file placement.h for where the memory of a search
+index goes and where the threads that build and search it run. A frozen or loaded
+index (see st_index.h) is one large block searched at random, so on a big
+host its pages are best spread over the NUMA nodes of every socket that
+queries it, and on huge pages so that a descent does not miss the TLB at
+every node. It is set by the environment:
+
+   GENOMEOT_HUGEPAGES=1           transparent huge pages (madvise)
+   GENOMEOT_HUGEPAGES=2           explicit huge pages (MAP_HUGETLB, from the
+                                  pool of vm.nr_hugepages), transparent ones
+                                  when the pool is short
+   GENOMEOT_NUMA=interleave       pages interleaved over all NUMA nodes
+   GENOMEOT_NUMA=<node>           pages on that node only
+   GENOMEOT_PIN=1                 each thread of a pool pinned to a core of
+                                  its own, in turn: the tree builders, the
+                                  query workers of chrcompare, the st_scan
+                                  file pool and the st_server connections
+
+NUMA policies are set with the mbind system call, so no library is needed;
+on a host of one node or other than Linux they are left out. The placement
+chosen, and the bytes that got it, are in the metrics report (see metrics.h)
+as "placement".
+*******************************************************************************/
+
+/******************************************************************************/
+/*
+   PLACEMENT_Active :
+   Tells whether index memory is to be placed (huge pages or a NUMA policy
+   were asked for), in which case an index file is read into placed memory
+   rather than mapped.
+*/
+
+int PLACEMENT_Active(void);
+
+/******************************************************************************/
+/*
+   PLACEMENT_Alloc :
+   Allocates a block of zeroed memory placed as the environment asks.
+
+   Input : The size in bytes.
+
+   Output: The block, 0 when there is no memory.
+*/
+
+void* PLACEMENT_Alloc(unsigned long size);
+
+/******************************************************************************/
+/*
+   PLACEMENT_Free :
+   Frees a block of PLACEMENT_Alloc.
+
+   Input : The block and its size.
+*/
+
+void PLACEMENT_Free(void* block, unsigned long size);
+
+/******************************************************************************/
+/*
+   PLACEMENT_PinThread :
+   Pins the calling thread to a core when GENOMEOT_PIN is set, nothing if not.
+
+   Input : The number of the thread among its pool, from 0; thread i runs on
+           the i-th core the process may use (modulo their number), those of
+           the process when placement was first asked for, so a pool started
+           from a pinned thread is spread all the same.
+*/
+
+void PLACEMENT_PinThread(unsigned long thread);
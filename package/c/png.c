@@ -0,0 +1,208 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file png.c implementing the header file png.h.
+
+A PNG file is the 8 byte signature followed by chunks, each one:
+
+   length (4 bytes, big endian) | type (4 bytes) | data | CRC of type and data
+
+The writer emits IHDR, then IDAT chunks holding one zlib stream of all rows
+(each row prefixed with filter type 0), then IEND. The zlib stream is flushed
+into an IDAT chunk every time the output buffer fills, so nothing but the
+current row and one buffer is ever held in memory.
+*******************************************************************************/
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "zlib.h"
+#include "png.h"
+
+/* Size of the compressed data buffer, also the largest IDAT chunk written */
+#define PNG_CHUNK_SIZE 65536
+
+struct PNGWRITER
+{
+   FILE*            file;
+   unsigned long    width;
+   unsigned long    height;
+   unsigned long    rows_written;
+   z_stream         stream;
+   unsigned char*   chunk;
+   /* Row with the filter type byte in front */
+   unsigned char*   row;
+   int              failed;
+};
+
+/******************************************************************************/
+/*
+   png_write_chunk :
+   Writes one chunk: length, type, data and the CRC over type and data.
+*/
+
+void png_write_chunk(PNG_WRITER* png, const char* type, const unsigned char* data, unsigned long length)
+{
+   unsigned char header[8];
+   unsigned char trailer[4];
+   unsigned long crc;
+
+   header[0] = (unsigned char)(length >> 24);
+   header[1] = (unsigned char)(length >> 16);
+   header[2] = (unsigned char)(length >> 8);
+   header[3] = (unsigned char)length;
+   memcpy(header + 4, type, 4);
+
+   crc = crc32(0L, Z_NULL, 0);
+   crc = crc32(crc, header + 4, 4);
+   if(length > 0)
+      crc = crc32(crc, data, (uInt)length);
+   trailer[0] = (unsigned char)(crc >> 24);
+   trailer[1] = (unsigned char)(crc >> 16);
+   trailer[2] = (unsigned char)(crc >> 8);
+   trailer[3] = (unsigned char)crc;
+
+   if(fwrite(header, 1, 8, png->file) != 8 ||
+      (length > 0 && fwrite(data, 1, length, png->file) != length) ||
+      fwrite(trailer, 1, 4, png->file) != 4)
+      png->failed = 1;
+}
+
+/******************************************************************************/
+/*
+   png_deflate :
+   Runs deflate over whatever input is pending, writing an IDAT chunk every
+   time the buffer fills, and the remainder too when finishing.
+*/
+
+void png_deflate(PNG_WRITER* png, int flush)
+{
+   int result;
+
+   do
+   {
+      result = deflate(&png->stream, flush);
+      if(png->stream.avail_out == 0 || (flush == Z_FINISH && png->stream.avail_out < PNG_CHUNK_SIZE))
+      {
+         png_write_chunk(png, "IDAT", png->chunk, PNG_CHUNK_SIZE - png->stream.avail_out);
+         png->stream.next_out  = png->chunk;
+         png->stream.avail_out = PNG_CHUNK_SIZE;
+      }
+   }
+   while(png->stream.avail_in > 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+}
+
+/******************************************************************************/
+/*
+   PNG_Open :
+   See png.h for description.
+*/
+
+PNG_WRITER* PNG_Open(const char* file_name, unsigned long width, unsigned long height)
+{
+   static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+   unsigned char header[13];
+   PNG_WRITER* png;
+
+   png = (PNG_WRITER*)malloc(sizeof(PNG_WRITER));
+   if(png == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   png->file = fopen(file_name, "wb");
+   if(png->file == 0)
+   {
+      free(png);
+      return 0;
+   }
+   png->width        = width;
+   png->height       = height;
+   png->rows_written = 0;
+   png->failed       = 0;
+   png->chunk        = (unsigned char*)malloc(PNG_CHUNK_SIZE);
+   png->row          = (unsigned char*)malloc(width*PNG_BYTES_PER_PIXEL + 1);
+   if(png->chunk == 0 || png->row == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+
+   memset(&png->stream, 0, sizeof(z_stream));
+   deflateInit(&png->stream, Z_DEFAULT_COMPRESSION);
+   png->stream.next_out  = png->chunk;
+   png->stream.avail_out = PNG_CHUNK_SIZE;
+
+   if(fwrite(signature, 1, 8, png->file) != 8)
+      png->failed = 1;
+
+   /* width, height, bit depth 8, color type 6 (RGBA), compression, filter and interlace 0 */
+   header[0]  = (unsigned char)(width >> 24);
+   header[1]  = (unsigned char)(width >> 16);
+   header[2]  = (unsigned char)(width >> 8);
+   header[3]  = (unsigned char)width;
+   header[4]  = (unsigned char)(height >> 24);
+   header[5]  = (unsigned char)(height >> 16);
+   header[6]  = (unsigned char)(height >> 8);
+   header[7]  = (unsigned char)height;
+   header[8]  = 8;
+   header[9]  = 6;
+   header[10] = 0;
+   header[11] = 0;
+   header[12] = 0;
+   png_write_chunk(png, "IHDR", header, 13);
+   return png;
+}
+
+/******************************************************************************/
+/*
+   PNG_WriteRow :
+   See png.h for description.
+*/
+
+void PNG_WriteRow(PNG_WRITER* png, const unsigned char* row)
+{
+   if(png->rows_written >= png->height)
+      return;
+   /* filter type 0, the row as is */
+   png->row[0] = 0;
+   memcpy(png->row + 1, row, png->width*PNG_BYTES_PER_PIXEL);
+   png->stream.next_in  = png->row;
+   png->stream.avail_in = (uInt)(png->width*PNG_BYTES_PER_PIXEL + 1);
+   png_deflate(png, Z_NO_FLUSH);
+   png->rows_written++;
+}
+
+/******************************************************************************/
+/*
+   PNG_Close :
+   See png.h for description.
+*/
+
+int PNG_Close(PNG_WRITER* png)
+{
+   int ok;
+
+   /* missing rows are written transparent, the decoder expects all of them */
+   png->row[0] = 0;
+   memset(png->row + 1, 0, png->width*PNG_BYTES_PER_PIXEL);
+   for(; png->rows_written < png->height; png->rows_written++)
+   {
+      png->stream.next_in  = png->row;
+      png->stream.avail_in = (uInt)(png->width*PNG_BYTES_PER_PIXEL + 1);
+      png_deflate(png, Z_NO_FLUSH);
+   }
+
+   png->stream.next_in  = Z_NULL;
+   png->stream.avail_in = 0;
+   png_deflate(png, Z_FINISH);
+   deflateEnd(&png->stream);
+   png_write_chunk(png, "IEND", 0, 0);
+
+   ok = !png->failed;
+   if(fclose(png->file) != 0)
+      ok = 0;
+   free(png->chunk);
+   free(png->row);
+   free(png);
+   return ok;
+}
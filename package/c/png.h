@@ -0,0 +1,53 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file png.h for a minimal streaming PNG writer. Rows are
+handed over one at a time, compressed with zlib and written as IDAT chunks as
+the compressed data fills up, so an image of any height is written with memory
+for one row only.
+
+Images are 8 bit RGBA (PNG color type 6), no interlacing.
+*******************************************************************************/
+
+/* An open PNG file. The fields are private to png.c */
+typedef struct PNGWRITER PNG_WRITER;
+
+/* Bytes per pixel in the rows handed to PNG_WriteRow (R, G, B, A) */
+#define PNG_BYTES_PER_PIXEL 4
+
+/******************************************************************************/
+/*
+   PNG_Open :
+   Creates the file and writes the signature and the image header.
+
+   Input : The file name, image width and height in pixels.
+
+   Output: The writer, 0 if the file could not be created.
+*/
+
+PNG_WRITER* PNG_Open(const char* file_name, unsigned long width, unsigned long height);
+
+/******************************************************************************/
+/*
+   PNG_WriteRow :
+   Compresses one row of width*PNG_BYTES_PER_PIXEL bytes. Rows must be written
+   top to bottom, exactly height of them.
+
+   Input : The writer and the row.
+
+   Output: None.
+*/
+
+void PNG_WriteRow(PNG_WRITER* png, const unsigned char* row);
+
+/******************************************************************************/
+/*
+   PNG_Close :
+   Flushes the compressed data, writes the end chunk, closes the file and frees
+   the writer.
+
+   Input : The writer.
+
+   Output: 1 for success, 0 if a write failed.
+*/
+
+int PNG_Close(PNG_WRITER* png);
@@ -0,0 +1,195 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file progress.c implementing the header file
+progress.h.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "metrics.h"
+#include "progress.h"
+
+/* Seconds between reports when GENOMEOT_PROGRESS_INTERVAL is not set */
+#define PROGRESS_INTERVAL 10
+
+PROGRESS_COUNTERS progress;
+
+static struct
+{
+   int               running;
+   int               stopping;
+   const char*       tool;
+   const char*       destination;
+   unsigned long     total;
+   double            interval;
+   double            start;
+   /* Counters at the last report, for the rates */
+   double            last_time;
+   unsigned long     last_bases;
+   unsigned long     last_windows;
+   unsigned long     last_lookups;
+   pthread_t         thread;
+   pthread_mutex_t   lock;
+   pthread_cond_t    wake;
+} reporter = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static double progress_now(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_REALTIME, &now);
+   return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Resident memory now, in KB */
+static long progress_rss_kb(void)
+{
+   FILE* status = fopen("/proc/self/statm", "r");
+   long pages = 0, resident = 0;
+
+   if(status == 0)
+      return 0;
+   if(fscanf(status, "%ld %ld", &pages, &resident) != 2)
+      resident = 0;
+   fclose(status);
+   return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/******************************************************************************/
+/*
+   progress_report :
+   Writes one report. The rates are since the previous report, the estimate of
+   the time left is from the average rate of the whole run.
+*/
+
+static void progress_report(int done)
+{
+   double now = progress_now();
+   double elapsed = now - reporter.start;
+   double since = now - reporter.last_time > 0 ? now - reporter.last_time : 1e-9;
+   unsigned long bases = progress.bases, windows = progress.windows, lookups = __atomic_load_n(&metrics.lookups, __ATOMIC_RELAXED);
+   double bases_per_second = (bases - reporter.last_bases) / since;
+   double windows_per_second = (windows - reporter.last_windows) / since;
+   double lookups_per_second = (lookups - reporter.last_lookups) / since;
+   double percent = -1, eta = -1;
+   FILE* out;
+
+   if(reporter.total > 0)
+   {
+      percent = bases * 100.0 / reporter.total;
+      if(done)
+         eta = 0;
+      else if(bases > 0 && bases < reporter.total)
+         eta = elapsed * (reporter.total - bases) / bases;
+   }
+   if(strcmp(reporter.destination, "1") == 0 || strcmp(reporter.destination, "stderr") == 0)
+   {
+      fprintf(stderr, "%s: %s", reporter.tool, done ? "done " : "");
+      if(percent >= 0)
+         fprintf(stderr, "%.1f%% ", percent);
+      fprintf(stderr, "bases %lu", bases);
+      if(reporter.total > 0)
+         fprintf(stderr, "/%lu", reporter.total);
+      fprintf(stderr, " (%.0f/s) windows %lu (%.2f/s) lookups %lu (%.0f/s) rss %ld KB elapsed %.0fs",
+         bases_per_second, windows, windows_per_second, lookups, lookups_per_second, progress_rss_kb(), elapsed);
+      if(eta >= 0)
+         fprintf(stderr, " eta %.0fs", eta);
+      fprintf(stderr, "\n");
+   }
+   else
+   {
+      /* Rewritten whole, renamed into place so a reader never sees half of it */
+      char* temporary = (char*)malloc(strlen(reporter.destination) + 8);
+      if(temporary == 0)
+         return;
+      sprintf(temporary, "%s.tmp", reporter.destination);
+      out = fopen(temporary, "w");
+      if(out != 0)
+      {
+         fprintf(out, "{\"tool\":\"%s\",\"pid\":%ld,\"done\":%s,\"bases\":%lu,\"total_bases\":%lu,\"percent\":%.2f,"
+            "\"bases_per_second\":%.0f,\"windows\":%lu,\"windows_per_second\":%.3f,\"lookups\":%lu,"
+            "\"lookups_per_second\":%.0f,\"rss_kb\":%ld,\"elapsed_seconds\":%.0f,\"eta_seconds\":%.0f,\"time\":%.0f}\n",
+            reporter.tool, (long)getpid(), done ? "true" : "false", bases, reporter.total, percent,
+            bases_per_second, windows, windows_per_second, lookups, lookups_per_second, progress_rss_kb(),
+            elapsed, eta, now);
+         fclose(out);
+         rename(temporary, reporter.destination);
+      }
+      free(temporary);
+   }
+   reporter.last_time = now;
+   reporter.last_bases = bases;
+   reporter.last_windows = windows;
+   reporter.last_lookups = lookups;
+}
+
+static void* progress_thread(void* unused)
+{
+   struct timespec until;
+   double next;
+
+   (void)unused;
+   pthread_mutex_lock(&reporter.lock);
+   while(!reporter.stopping)
+   {
+      next = progress_now() + reporter.interval;
+      until.tv_sec = (time_t)next;
+      until.tv_nsec = (long)((next - (double)until.tv_sec) * 1e9);
+      while(!reporter.stopping && pthread_cond_timedwait(&reporter.wake, &reporter.lock, &until) == 0)
+         ;
+      if(!reporter.stopping)
+         progress_report(0);
+   }
+   pthread_mutex_unlock(&reporter.lock);
+   return 0;
+}
+
+/******************************************************************************/
+/*
+   PROGRESS_Start :
+   See progress.h for description.
+*/
+
+void PROGRESS_Start(const char* tool, unsigned long total_bases)
+{
+   const char* interval = getenv("GENOMEOT_PROGRESS_INTERVAL");
+
+   reporter.destination = getenv("GENOMEOT_PROGRESS");
+   if(reporter.running || reporter.destination == 0 || reporter.destination[0] == 0 || strcmp(reporter.destination, "0") == 0)
+      return;
+   reporter.tool      = tool;
+   reporter.total     = total_bases;
+   reporter.interval  = PROGRESS_INTERVAL;
+   if(interval != 0 && atof(interval) > 0)
+      reporter.interval = atof(interval);
+   reporter.start     = progress_now();
+   reporter.last_time = reporter.start;
+   reporter.stopping  = 0;
+   if(pthread_create(&reporter.thread, 0, progress_thread, 0) != 0)
+      return;
+   reporter.running = 1;
+   atexit(PROGRESS_Stop);
+}
+
+/******************************************************************************/
+/*
+   PROGRESS_Stop :
+   See progress.h for description.
+*/
+
+void PROGRESS_Stop(void)
+{
+   if(!reporter.running)
+      return;
+   pthread_mutex_lock(&reporter.lock);
+   reporter.stopping = 1;
+   pthread_cond_signal(&reporter.wake);
+   pthread_mutex_unlock(&reporter.lock);
+   pthread_join(reporter.thread, 0);
+   reporter.running = 0;
+   progress_report(1);
+}
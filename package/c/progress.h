@@ -0,0 +1,50 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file progress.h for the live progress of long runs.
+A reporter thread samples the counters the tool updates (once per window or
+section, never per base) and writes, every interval:
+
+   bases done of the total, windows and ST_FindSubstring lookups with their
+   rates since the last sample, resident memory, elapsed time and an estimate
+   of the time left.
+
+It is switched on by the environment:
+
+   GENOMEOT_PROGRESS=1                  a line to stderr every interval
+   GENOMEOT_PROGRESS=<file name>        the file is rewritten every interval
+                                        with one JSON object, for schedulers
+   GENOMEOT_PROGRESS_INTERVAL=<seconds> default 10
+
+When it is off no thread is started and the counters are just stores.
+*******************************************************************************/
+
+typedef struct PROGRESSCOUNTERS
+{
+   /* Bases of the input done so far */
+   volatile unsigned long   bases;
+   /* Windows (centromere) or sections (chrcompare) done so far */
+   volatile unsigned long   windows;
+} PROGRESS_COUNTERS;
+
+extern PROGRESS_COUNTERS progress;
+
+/******************************************************************************/
+/*
+   PROGRESS_Start :
+   Reads the environment and, if progress is on, starts the reporter thread.
+   The last report (marked done) is written when the tool exits.
+
+   Input : The tool name and the bases of the whole run (0 if not known, then
+           there is no estimate of the time left).
+*/
+
+void PROGRESS_Start(const char* tool, unsigned long total_bases);
+
+/******************************************************************************/
+/*
+   PROGRESS_Stop :
+   Stops the reporter thread after a last report. Called at exit, may be
+   called before.
+*/
+
+void PROGRESS_Stop(void);
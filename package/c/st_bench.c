@@ -0,0 +1,377 @@
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "st_parallel.h"
+#include "gz_input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/* each benchmark is run this many times and the fastest run reported */
+#define REPEATS 3
+/* bases of the find_substring_jump table when GENOMEOT_JUMP_K is not set */
+#define JUMP_K 10
+
+void Usage()
+{
+	printf("Usage: st_bench <file1> <file2> <tree length> [<window size> <tool folder>]\n");
+	printf("\n");
+	printf(" Macro benchmarks on two ACGT files (see gen_genome and fasta2acgt), the fastest of %d runs:\n", REPEATS);
+	printf("\n");
+	printf("   create_tree     ST_CreateTree on the first <tree length> bases of <file1>\n");
+	printf("   find_substring  ST_FindSubstring of every <window size> string (default 20) in as many bases of <file2>\n");
+	printf("   find_substring_jump   find_substring from a jump table of GENOMEOT_JUMP_K bases (default %d)\n", JUMP_K);
+	printf("   create_tree_parallel  ST_CreateTreeParallel of create_tree, on every core\n");
+	printf("   centromere      <tool folder>centromere on <file1>, windows of <tree length> / 4 overlapping by half\n");
+	printf("   chrcompare      <tool folder>chrcompare of a <tree length> section of <file1> against all of <file2>\n");
+	printf("\n");
+	printf(" <tool folder> defaults to ./  Prints one JSON object per benchmark: seconds, throughput, cost\n");
+	printf(" per symbol and peak resident memory (KB), to compare across commits with bench_compare.rb.\n");
+}
+
+double now()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+long peak_rss_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/* Resident memory now, in KB */
+long rss_kb()
+{
+	FILE* status = fopen("/proc/self/statm", "r");
+	long pages = 0;
+	long resident = 0;
+	if (status != NULL)
+	{
+		if (fscanf(status, "%ld %ld", &pages, &resident) != 2)
+		{
+			resident = 0;
+		}
+		fclose(status);
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Reads up to length bytes from the start of a file, returns how many in *read */
+char* read_file( const char* file_name, unsigned long length, unsigned long* read )
+{
+	FILE* file = GZ_Open(file_name);
+	char* data;
+
+	if (file == NULL)
+	{
+		printf("File '%s' NOT FOUND.\n", file_name);
+		exit(0);
+	}
+	data = (char*)malloc(length + 1);
+	if (data == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	*read = fread(data, 1, length, file);
+	fclose(file);
+	return data;
+}
+
+unsigned long file_size( const char* file_name )
+{
+	FILE* file = GZ_Open(file_name);
+	long size = 0;
+	if (file != NULL)
+	{
+		fseek(file, 0, SEEK_END);
+		size = ftell(file);
+		fclose(file);
+	}
+	return size < 0 ? 0 : (unsigned long)size;
+}
+
+/*
+ *  run_tool -- runs a command line with its output discarded, returns 1 if it exited with 0,
+ *  its wall time in *seconds and its peak resident memory in *peak_kb
+ */
+int run_tool( char* const arguments[], double* seconds, long* peak_kb )
+{
+	struct rusage usage;
+	double start = now();
+	int status;
+	int null_file;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+	{
+		return 0;
+	}
+	if (pid == 0)
+	{
+		null_file = open("/dev/null", O_WRONLY);
+		if (null_file >= 0)
+		{
+			dup2(null_file, 1);
+			close(null_file);
+		}
+		execv(arguments[0], arguments);
+		_exit(127);
+	}
+	if (wait4(pid, &status, 0, &usage) != pid)
+	{
+		return 0;
+	}
+	*seconds = now() - start;
+	*peak_kb = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	char* file1;
+	char* file2;
+	unsigned long tree_length;
+	unsigned long window_size = 20;
+	const char* tool_folder = "./";
+	char* text;
+	char* queries;
+	unsigned long text_length;
+	unsigned long query_length;
+	unsigned long lookups;
+	unsigned long found;
+	unsigned long i;
+	unsigned long window;
+	unsigned long overlap;
+	long rss_before;
+	long tree_kb = 0;
+	long peak_kb;
+	double start;
+	double seconds;
+	double best;
+	double build_seconds;
+	double lookup_seconds;
+	double table_seconds;
+	unsigned long jump_k;
+	long threads;
+	int run;
+	SUFFIX_TREE* tree = NULL;
+	char tool[1024];
+	char offset_arg[32];
+	char length_arg[32];
+	char segment_arg[32];
+	char window_arg[32];
+	char overlap_arg[32];
+	char* arguments[8];
+
+	if (argc != 4 && argc != 6)
+	{
+		Usage();
+		return 0;
+	}
+	METRICS_Init("st_bench");
+	file1 = argv[1];
+	file2 = argv[2];
+	tree_length = strtoul(argv[3], NULL, 10);
+	if (argc == 6)
+	{
+		window_size = strtoul(argv[4], NULL, 10);
+		tool_folder = argv[5];
+	}
+	if (tree_length < 100 || window_size < 1)
+	{
+		Usage();
+		return 0;
+	}
+
+	/* create_tree */
+	text = read_file(file1, tree_length, &text_length);
+	best = 0;
+	for (run = 0; run < REPEATS; run++)
+	{
+		if (tree != NULL)
+		{
+			ST_DeleteTree(tree);
+		}
+		rss_before = rss_kb();
+		start = now();
+		tree = ST_CreateTree(text, text_length);
+		seconds = now() - start;
+		/* later runs reuse the freed memory of the first */
+		if (run == 0)
+		{
+			tree_kb = rss_kb() - rss_before;
+		}
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	printf("{\"benchmark\":\"create_tree\",\"input\":\"%s\",\"symbols\":%lu,\"seconds\":%.6f,\"symbols_per_second\":%.0f,\"ns_per_symbol\":%.2f,\"tree_bytes_per_symbol\":%.2f,\"peak_rss_kb\":%ld}\n",
+		file1, text_length, best, text_length / best, best * 1e9 / text_length, tree_kb * 1024.0 / text_length, peak_rss_kb());
+	fflush(stdout);
+	build_seconds = best;
+
+	/* find_substring */
+	queries = read_file(file2, tree_length, &query_length);
+	lookups = query_length >= window_size ? query_length - window_size + 1 : 0;
+	found = 0;
+	best = 0;
+	for (run = 0; run < REPEATS && lookups > 0; run++)
+	{
+		found = 0;
+		start = now();
+		for (i = 0; i < lookups; i++)
+		{
+			if (ST_FindSubstring(tree, queries + i, window_size) != ST_ERROR)
+			{
+				found++;
+			}
+		}
+		seconds = now() - start;
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	if (lookups > 0)
+	{
+		printf("{\"benchmark\":\"find_substring\",\"input\":\"%s\",\"window\":%lu,\"lookups\":%lu,\"found\":%lu,\"seconds\":%.6f,\"lookups_per_second\":%.0f,\"ns_per_lookup\":%.2f,\"ns_per_symbol\":%.2f,\"peak_rss_kb\":%ld}\n",
+			file2, window_size, lookups, found, best, lookups / best, best * 1e9 / lookups, best * 1e9 / (lookups * window_size), peak_rss_kb());
+		fflush(stdout);
+	}
+
+	/* find_substring_jump, its speedup over find_substring */
+	lookup_seconds = best;
+	jump_k = ST_JumpK() > 0 ? ST_JumpK() : JUMP_K;
+	start = now();
+	ST_BuildJumpTable(tree, jump_k);
+	table_seconds = now() - start;
+	best = 0;
+	for (run = 0; run < REPEATS && lookups > 0; run++)
+	{
+		found = 0;
+		start = now();
+		for (i = 0; i < lookups; i++)
+		{
+			if (ST_FindSubstring(tree, queries + i, window_size) != ST_ERROR)
+			{
+				found++;
+			}
+		}
+		seconds = now() - start;
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	if (lookups > 0)
+	{
+		printf("{\"benchmark\":\"find_substring_jump\",\"input\":\"%s\",\"window\":%lu,\"k\":%lu,\"lookups\":%lu,\"found\":%lu,\"table_seconds\":%.6f,\"seconds\":%.6f,\"lookups_per_second\":%.0f,\"ns_per_lookup\":%.2f,\"speedup\":%.2f,\"peak_rss_kb\":%ld}\n",
+			file2, window_size, jump_k, lookups, found, table_seconds, best, lookups / best, best * 1e9 / lookups, lookup_seconds / best, peak_rss_kb());
+		fflush(stdout);
+	}
+	ST_DeleteTree(tree);
+
+	/* create_tree_parallel, its speedup over create_tree */
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	best = 0;
+	for (run = 0; run < REPEATS; run++)
+	{
+		start = now();
+		tree = ST_CreateTreeParallel(text, text_length, 0);
+		seconds = now() - start;
+		ST_DeleteTree(tree);
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	printf("{\"benchmark\":\"create_tree_parallel\",\"input\":\"%s\",\"symbols\":%lu,\"threads\":%ld,\"seconds\":%.6f,\"symbols_per_second\":%.0f,\"ns_per_symbol\":%.2f,\"speedup\":%.2f,\"peak_rss_kb\":%ld}\n",
+		file1, text_length, threads, best, text_length / best, best * 1e9 / text_length, build_seconds / best, peak_rss_kb());
+	fflush(stdout);
+	free(text);
+	free(queries);
+
+	/* centromere */
+	window = tree_length / 4 < 10 ? 10 : tree_length / 4;
+	overlap = window / 2;
+	text_length = file_size(file1);
+	sprintf(tool, "%scentromere", tool_folder);
+	sprintf(window_arg, "%lu", window);
+	sprintf(overlap_arg, "%lu", overlap);
+	arguments[0] = tool;
+	arguments[1] = file1;
+	arguments[2] = window_arg;
+	arguments[3] = overlap_arg;
+	arguments[4] = NULL;
+	best = 0;
+	peak_kb = 0;
+	for (run = 0; run < REPEATS; run++)
+	{
+		if (!run_tool(arguments, &seconds, &peak_kb))
+		{
+			printf("{\"benchmark\":\"centromere\",\"error\":\"%s failed\"}\n", tool);
+			break;
+		}
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	if (run == REPEATS)
+	{
+		i = text_length > window ? (text_length - window) / (window - overlap) + 1 : 1;
+		printf("{\"benchmark\":\"centromere\",\"input\":\"%s\",\"window\":%lu,\"overlap\":%lu,\"windows\":%lu,\"symbols\":%lu,\"seconds\":%.6f,\"windows_per_second\":%.2f,\"symbols_per_second\":%.0f,\"ns_per_symbol\":%.2f,\"peak_rss_kb\":%ld}\n",
+			file1, window, overlap, i, text_length, best, i / best, text_length / best, best * 1e9 / text_length, peak_kb);
+	}
+	fflush(stdout);
+
+	/* chrcompare */
+	query_length = file_size(file2);
+	sprintf(tool, "%schrcompare", tool_folder);
+	sprintf(offset_arg, "%d", 0);
+	sprintf(length_arg, "%lu", tree_length);
+	sprintf(segment_arg, "%lu", tree_length / 10 < window_size ? window_size : tree_length / 10);
+	sprintf(window_arg, "%lu", window_size);
+	arguments[0] = tool;
+	arguments[1] = file1;
+	arguments[2] = offset_arg;
+	arguments[3] = length_arg;
+	arguments[4] = file2;
+	arguments[5] = segment_arg;
+	arguments[6] = window_arg;
+	arguments[7] = NULL;
+	best = 0;
+	for (run = 0; run < REPEATS; run++)
+	{
+		if (!run_tool(arguments, &seconds, &peak_kb))
+		{
+			printf("{\"benchmark\":\"chrcompare\",\"error\":\"%s failed\"}\n", tool);
+			break;
+		}
+		if (run == 0 || seconds < best)
+		{
+			best = seconds;
+		}
+	}
+	if (run == REPEATS)
+	{
+		printf("{\"benchmark\":\"chrcompare\",\"input\":\"%s\",\"tree_symbols\":%lu,\"symbols\":%lu,\"window\":%lu,\"seconds\":%.6f,\"symbols_per_second\":%.0f,\"ns_per_symbol\":%.2f,\"peak_rss_kb\":%ld}\n",
+			file2, tree_length, query_length, window_size, best, query_length / best, best * 1e9 / query_length, peak_kb);
+	}
+	return 0;
+}
@@ -0,0 +1,260 @@
+#define _POSIX_C_SOURCE 200809L
+#include "suffix_tree.h"
+#include "st_protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* windows sent in one STP_FIND request */
+#define FIND_BATCH 4096
+/* requests and windows per request of BENCH when not given */
+#define BENCH_REQUESTS 1000
+#define BENCH_BATCH 64
+
+void Usage()
+{
+	printf("Usage: st_client <socket path> STATUS\n");
+	printf("       st_client <socket path> <index> LOAD\n");
+	printf("       st_client <socket path> <index> FIND <window size> <file>\n");
+	printf("       st_client <socket path> <index> OCCURRENCES <string> [<most>]\n");
+	printf("       st_client <socket path> <index> SCAN <window size> <file>\n");
+	printf("       st_client <socket path> <index> BENCH <window size> <file> [<requests> [<batch>]]\n");
+	printf("\n");
+	printf(" Queries the st_server listening on <socket path>.  <index> is the index or text file as the\n");
+	printf(" server sees it (an absolute path, or one relative to where it was started).\n");
+	printf("\n");
+	printf("   STATUS       the resident indices: name,bytes,requests,last use; then total,bytes,budget\n");
+	printf("   LOAD         loads or builds <index> ahead of its queries\n");
+	printf("   FIND         each <window size> string of <file>: offset,position (from 1, 0 if absent)\n");
+	printf("   OCCURRENCES  <string>,count then the position of each (at most <most>, default all)\n");
+	printf("   SCAN         the windows of <file> against <index>, the line of st_scan\n");
+	printf("   BENCH        latency of <requests> (default %d) FIND requests of <batch> (default %d)\n", BENCH_REQUESTS, BENCH_BATCH);
+	printf("                windows of <file> each, one JSON object as st_bench\n");
+}
+
+double now()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/* the contents of a file, exits if it is not there */
+char* read_file( const char* name, DBL_WORD* length )
+{
+	FILE* file = fopen(name, "rb");
+	char* data_buffer = NULL;
+
+	if (file == NULL)
+	{
+		printf("File '%s' NOT FOUND.\n", name);
+		exit(1);
+	}
+	fseek(file, 0L, SEEK_END);
+	*length = ftell(file);
+	fseek(file, 0L, SEEK_SET);
+	data_buffer = (char*)malloc(*length + 1);
+	if (data_buffer == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	*length = fread(data_buffer, 1, *length, file);
+	fclose(file);
+	return data_buffer;
+}
+
+/* sends a request, exits on an error; the answer is to free */
+char* request( int s, unsigned int type, const char* name, unsigned int item_length, DBL_WORD count,
+	const void* payload, DBL_WORD payload_length, STP_RESPONSE* response )
+{
+	char* answer = NULL;
+
+	if (!STP_Request(s, type, name, item_length, count, payload, payload_length, response, &answer))
+	{
+		printf("Connection to the server lost.\n");
+		exit(1);
+	}
+	if (response->status != STP_OK)
+	{
+		printf("%s\n", answer != NULL ? answer : "Request failed.");
+		exit(1);
+	}
+	return answer;
+}
+
+int compare_times( const void* a, const void* b )
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+/* FIND requests of <batch> windows of the file in turn, timed one by one */
+void bench( int s, const char* name, DBL_WORD window_size, const char* file_name, DBL_WORD requests, DBL_WORD batch )
+{
+	STP_RESPONSE response;
+	DBL_WORD length = 0;
+	DBL_WORD windows = 0;
+	DBL_WORD next = 0;
+	DBL_WORD found = 0;
+	DBL_WORD i = 0;
+	DBL_WORD j = 0;
+	char* data_buffer = read_file(file_name, &length);
+	char* payload = (char*)malloc(batch*window_size);
+	double* times = (double*)malloc(requests*sizeof(double));
+	double load = 0;
+	double start = 0;
+	double total = 0;
+	DBL_WORD* answer = NULL;
+
+	windows = length / window_size;
+	if (windows == 0 || payload == NULL || times == NULL)
+	{
+		printf("{\"benchmark\":\"server_find\",\"error\":\"no windows\"}\n");
+		exit(1);
+	}
+	start = now();
+	free(request(s, STP_LOAD, name, 0, 0, NULL, 0, &response));
+	load = now() - start;
+	for (i = 0; i < requests; i++)
+	{
+		for (j = 0; j < batch; j++)
+		{
+			memcpy(payload + j*window_size, data_buffer + next*window_size, window_size);
+			next = (next + 1) % windows;
+		}
+		start = now();
+		answer = (DBL_WORD*)request(s, STP_FIND, name, window_size, batch, payload, batch*window_size, &response);
+		times[i] = now() - start;
+		total += times[i];
+		for (j = 0; j < batch; j++)
+		{
+			found += answer[j] != 0;
+		}
+		free(answer);
+	}
+	qsort(times, requests, sizeof(double), compare_times);
+	printf("{\"benchmark\":\"server_find\",\"input\":\"%s\",\"window\":%lu,\"batch\":%lu,\"requests\":%lu,\"found\":%lu,\"load_seconds\":%.6f,\"seconds\":%.6f,\"lookups_per_second\":%.0f,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+		file_name, window_size, batch, requests, found, load, total, requests*batch/total,
+		times[requests/2]*1e6, times[requests*9/10]*1e6, times[requests*99/100]*1e6, times[requests - 1]*1e6);
+	free(times);
+	free(payload);
+	free(data_buffer);
+}
+
+int main(int argc, char* argv[])
+{
+	STP_RESPONSE response;
+	DBL_WORD window_size = 0;
+	DBL_WORD length = 0;
+	DBL_WORD count = 0;
+	DBL_WORD windows = 0;
+	DBL_WORD i = 0;
+	DBL_WORD j = 0;
+	DBL_WORD requests = BENCH_REQUESTS;
+	DBL_WORD batch = BENCH_BATCH;
+	DBL_WORD* answer = NULL;
+	char* data_buffer = NULL;
+	char* text = NULL;
+	const char* name = NULL;
+	const char* command = NULL;
+	int s = 0;
+
+	if (argc < 3)
+	{
+		Usage();
+		exit(0);
+	}
+	command = argc == 3 ? argv[2] : argv[3];
+	name = argv[2];
+	if (strcmp(command, "STATUS") == 0 ? argc != 3 :
+		strcmp(command, "LOAD") == 0 ? argc != 4 :
+		strcmp(command, "OCCURRENCES") == 0 ? argc < 5 || argc > 6 :
+		strcmp(command, "FIND") == 0 || strcmp(command, "SCAN") == 0 ? argc != 6 :
+		strcmp(command, "BENCH") == 0 ? argc < 6 || argc > 8 : 1)
+	{
+		Usage();
+		exit(0);
+	}
+	if (argc > 4 && strcmp(command, "OCCURRENCES") != 0)
+	{
+		window_size = atol(argv[4]);
+		if (window_size == 0)
+		{
+			Usage();
+			exit(0);
+		}
+	}
+	s = STP_Connect(argv[1]);
+	if (s < 0)
+	{
+		exit(1);
+	}
+
+	if (strcmp(command, "STATUS") == 0)
+	{
+		text = request(s, STP_STATUS, NULL, 0, 0, NULL, 0, &response);
+		printf("%s", text != NULL ? text : "");
+	}
+	else if (strcmp(command, "LOAD") == 0)
+	{
+		text = request(s, STP_LOAD, name, 0, 0, NULL, 0, &response);
+	}
+	else if (strcmp(command, "OCCURRENCES") == 0)
+	{
+		answer = (DBL_WORD*)request(s, STP_OCCURRENCES, name, 0, argc > 5 ? atol(argv[5]) : 0,
+			argv[4], strlen(argv[4]), &response);
+		printf("%s,%lu\n", argv[4], response.count);
+		for (i = 0; i < response.payload_length / sizeof(DBL_WORD); i++)
+		{
+			printf("%lu\n", answer[i]);
+		}
+	}
+	else if (strcmp(command, "FIND") == 0)
+	{
+		data_buffer = read_file(argv[5], &length);
+		windows = length / window_size;
+		for (i = 0; i < windows; i += count)
+		{
+			count = windows - i < FIND_BATCH ? windows - i : FIND_BATCH;
+			answer = (DBL_WORD*)request(s, STP_FIND, name, window_size, count,
+				data_buffer + i*window_size, count*window_size, &response);
+			for (j = 0; j < count; j++)
+			{
+				printf("%lu,%lu\n", (i + j)*window_size, answer[j]);
+			}
+			free(answer);
+		}
+		answer = NULL;
+	}
+	else if (strcmp(command, "SCAN") == 0)
+	{
+		data_buffer = read_file(argv[5], &length);
+		answer = (DBL_WORD*)request(s, STP_SCAN, name, window_size, 0, data_buffer, length, &response);
+		printf("%s,%s,%lu,%lu,%lu,%lu\n", name, argv[5], answer[0], answer[1], answer[2], answer[3]);
+	}
+	else
+	{
+		if (argc > 6)
+		{
+			requests = atol(argv[6]);
+		}
+		if (argc > 7)
+		{
+			batch = atol(argv[7]);
+		}
+		if (requests == 0 || batch == 0)
+		{
+			Usage();
+			exit(0);
+		}
+		bench(s, name, window_size, argv[5], requests, batch);
+	}
+	free(answer);
+	free(text);
+	free(data_buffer);
+	close(s);
+	return 0;
+}
@@ -0,0 +1,1228 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file st_index.c implementing the header file
+st_index.h.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "placement.h"
+#include "gz_input.h"
+#include "st_sort.h"
+#include "st_index.h"
+
+/* From suffix_tree.c, the 2 bit packing shared with the tree */
+#define PACKED_BASES (sizeof(DBL_WORD)*4)
+extern const unsigned char base_codes[256];
+int pack_word(const char* str, DBL_WORD count, DBL_WORD* word);
+DBL_WORD packed_word(const DBL_WORD* words, DBL_WORD i);
+DBL_WORD get_node_label_end(SUFFIX_TREE* tree, NODE* node);
+DBL_WORD get_node_label_length(SUFFIX_TREE* tree, NODE* node);
+
+/* Memory a partition takes while it is built: the position of each suffix,
+   and for the subtree of the k-mer with most suffixes at most 2 nodes per
+   suffix, each a BUILD_NODE, an STI_NODE and an unsigned int of the breadth
+   first order, and a stack entry per suffix */
+#define STI_PARTITION_BYTES(suffixes, largest) ((suffixes) * sizeof(unsigned int) \
+   + (2 * (largest) + 1) * (sizeof(BUILD_NODE) + sizeof(STI_NODE) + sizeof(unsigned int)) \
+   + ((largest) + 1) * sizeof(unsigned int))
+/* Longest k-mers of the table, 4^13 entries take 256 MB */
+#define STI_MAX_K 13
+/* Bytes of the text read at a time */
+#define STI_READ_SIZE (1 << 20)
+
+/* A node of the subtree of a k-mer while it is built */
+typedef struct BUILDNODE
+{
+   unsigned int   path_position;
+   unsigned int   depth;
+   unsigned int   first_son;
+   unsigned int   right_sibling;
+} BUILD_NODE;
+
+/* The sample the suffixes of a partition are sorted with (qsort has no
+   context) and the bases they share */
+static const ST_SAMPLE* sort_sample;
+static DBL_WORD         sort_k;
+
+/* The base at index i of packed words */
+#define PACKED_BASE(words, i) (((words)[(i) / PACKED_BASES] >> (((i) % PACKED_BASES) * 2)) & 3)
+
+/******************************************************************************/
+/*
+   compare_suffixes :
+   qsort order of the suffixes of one k-mer: by their bases, a suffix before
+   the longer ones it is a prefix of (the $ is the smallest symbol).
+*/
+
+static int compare_suffixes(const void* a, const void* b)
+{
+   return STS_Compare(sort_sample, *(const unsigned int*)a, *(const unsigned int*)b, sort_k, 0);
+}
+
+/******************************************************************************/
+/*
+   add_son :
+   Adds a son (whose subtree is complete) to a node. As in the tree of
+   Ukkonen's algorithm (see st_parallel.c), a node takes the smallest path
+   position below it and sons are in path position order, so a search finds
+   the position ST_FindSubstring finds.
+*/
+
+static void add_son(BUILD_NODE* build, unsigned int father, unsigned int son)
+{
+   unsigned int* link = &build[father].first_son;
+
+   if(build[son].path_position < build[father].path_position)
+      build[father].path_position = build[son].path_position;
+   while(*link != STI_NONE && build[*link].path_position < build[son].path_position)
+      link = &build[*link].right_sibling;
+   build[son].right_sibling = *link;
+   *link = son;
+}
+
+/******************************************************************************/
+/*
+   build_subtree :
+   Builds the subtree of the sorted suffixes of one k-mer, the way a tree is
+   built from a suffix array and its common prefixes, and lays it out breadth
+   first.
+
+   Input : The sample of the text, the bases the suffixes share, the sorted
+           suffixes and their number, the work arrays (build and
+           order of 2 * count + 1 entries, stack of count + 1), the nodes to
+           lay out and the index of the first of them in the file.
+
+   Output: The number of nodes laid out, the subtree root first.
+*/
+
+static DBL_WORD build_subtree(const ST_SAMPLE* sample, DBL_WORD k, const unsigned int* suffixes,
+                              DBL_WORD count, BUILD_NODE* build, unsigned int* order, unsigned int* stack,
+                              STI_NODE* out, DBL_WORD first_index)
+{
+   DBL_WORD i, common = 0, top = 0, nodes = 0, laid = 1, q;
+   unsigned int last, son;
+
+   /* Node 0 is the root of the whole tree, the k-mer subtree is its only son */
+   build[0].path_position = 0;
+   build[0].depth = 0;
+   build[0].first_son = STI_NONE;
+   stack[0] = 0;
+   for(i = 0; i < count; i++)
+   {
+      if(i > 0)
+         STS_Compare(sample, suffixes[i - 1], suffixes[i], k, &common);
+      while(build[stack[top]].depth > common)
+      {
+         last = stack[top--];
+         if(build[stack[top]].depth < common)
+         {
+            /* The previous suffixes branch off below the top of the stack */
+            nodes++;
+            build[nodes].path_position = build[last].path_position;
+            build[nodes].depth         = (unsigned int)common;
+            build[nodes].first_son     = STI_NONE;
+            add_son(build, (unsigned int)nodes, last);
+            stack[++top] = (unsigned int)nodes;
+            break;
+         }
+         add_son(build, stack[top], last);
+      }
+      nodes++;
+      build[nodes].path_position = suffixes[i];
+      build[nodes].depth         = (unsigned int)(sample->length + 2 - suffixes[i]);
+      build[nodes].first_son     = STI_NONE;
+      stack[++top] = (unsigned int)nodes;
+   }
+   while(top > 0)
+   {
+      last = stack[top--];
+      add_son(build, stack[top], last);
+   }
+
+   order[0] = build[0].first_son;
+   for(q = 0; q < laid; q++)
+   {
+      out[q].path_position = build[order[q]].path_position;
+      out[q].depth         = build[order[q]].depth;
+      out[q].first_son     = 0;
+      out[q].sons          = 0;
+      for(son = build[order[q]].first_son; son != STI_NONE; son = build[son].right_sibling)
+      {
+         if(out[q].sons++ == 0)
+            out[q].first_son = (unsigned int)(first_index + laid);
+         order[laid++] = son;
+      }
+   }
+   return laid;
+}
+
+/* Enough k-mers for the partitions to be small, about 64 suffixes each */
+static DBL_WORD default_k(DBL_WORD length)
+{
+   DBL_WORD k;
+
+   for(k = 1; k < STI_MAX_K && ((DBL_WORD)1 << (2 * k)) * 64 < length; k++)
+      ;
+   return k;
+}
+
+/******************************************************************************/
+/*
+   read_text :
+   Reads a text file into packed words.
+
+   Output: The words (with a spare word at the end), 0 on an error.
+*/
+
+static DBL_WORD* read_text(const char* text_file, DBL_WORD* length, DBL_WORD* number_words)
+{
+   FILE* file = GZ_Open(text_file);
+   char* buffer;
+   DBL_WORD* words;
+   DBL_WORD read, i, index = 1;
+   unsigned char code;
+
+   if(file == 0)
+   {
+      printf("File '%s' NOT FOUND.\n", text_file);
+      return 0;
+   }
+   fseek(file, 0, SEEK_END);
+   *length = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   if(*length == 0 || *length >= STI_NONE - 2)
+   {
+      printf("File '%s' is empty or too long to index.\n", text_file);
+      fclose(file);
+      return 0;
+   }
+   *number_words = (*length + 1) / PACKED_BASES + 2;
+   words  = (DBL_WORD*)calloc(*number_words, sizeof(DBL_WORD));
+   buffer = (char*)malloc(STI_READ_SIZE);
+   if(words == 0 || buffer == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   while((read = fread(buffer, 1, STI_READ_SIZE, file)) > 0)
+   {
+      for(i = 0; i < read; i++, index++)
+      {
+         code = base_codes[(unsigned char)buffer[i]];
+         if(code > 3)
+         {
+            printf("File '%s' has '%c' at %lu, only A, C, G and T are indexed.\n", text_file, buffer[i], index);
+            free(buffer);
+            free(words);
+            fclose(file);
+            return 0;
+         }
+         words[index / PACKED_BASES] |= (DBL_WORD)code << ((index % PACKED_BASES) * 2);
+      }
+   }
+   free(buffer);
+   fclose(file);
+   return words;
+}
+
+/******************************************************************************/
+/*
+   write_nodes :
+   Appends nodes to the nodes of the index file.
+*/
+
+static void write_nodes(FILE* out, STI_HEADER* header, const STI_NODE* nodes, DBL_WORD count)
+{
+   if(header->number_nodes + count >= STI_NONE)
+   {
+      printf("Too many nodes for the index format.\n");
+      exit(0);
+   }
+   fseek(out, (long)(header->nodes_offset + header->number_nodes * sizeof(STI_NODE)), SEEK_SET);
+   fwrite(nodes, sizeof(STI_NODE), count, out);
+   header->number_nodes += count;
+}
+
+static int build_keys(const ST_SAMPLE* sample, const DBL_WORD* words, DBL_WORD bases, DBL_WORD shift,
+                      DBL_WORD prefix, const unsigned int* counts, DBL_WORD keys, unsigned int* table,
+                      STI_NODE* roots, DBL_WORD capacity, FILE* out, STI_HEADER* header);
+
+/******************************************************************************/
+/*
+   split_kmer :
+   Builds the subtree of a k-mer whose suffixes do not fit the budget in one
+   partition. The suffixes are grouped by their first k + j bases, j the
+   smallest for which the largest group fits, and the subtree of each group
+   is built alone (its root kept, the rest written). The top of the k-mer
+   subtree is then built from the root of each group (the smallest position
+   in it) and the suffixes too short for a group, the common prefix of two
+   groups being shorter than k + j bases, and each group root takes the place
+   of its leaf.
+
+   Input : The sample of the text, the packed text, k, the k-mer, its number
+           of suffixes, the memory budget for them, the index file and its
+           header, and where to put the index of the subtree root.
+
+   Output: 1 on success, 0 when no prefix up to 31 bases splits the suffixes
+           small enough.
+*/
+
+static int split_kmer(const ST_SAMPLE* sample, const DBL_WORD* words, DBL_WORD k, DBL_WORD code,
+                      DBL_WORD count, DBL_WORD capacity, FILE* out, STI_HEADER* header, unsigned int* root)
+{
+   DBL_WORD       j, g, p, q, i, word, laid, length = sample->length, groups = 0, extra = 0, items = 0;
+   DBL_WORD       largest, mask = 0, kmer_mask = ((DBL_WORD)1 << (2 * k)) - 1;
+   unsigned int*  group_counts = 0;
+   unsigned int*  cursor;
+   STI_NODE*      roots;
+   unsigned int*  suffixes;
+   unsigned int*  order;
+   unsigned int*  stack;
+   BUILD_NODE*    build;
+   STI_NODE*      nodes;
+
+   for(j = 1; k + j < PACKED_BASES; j++)
+   {
+      /* The count, cursor and root of each group */
+      groups = (DBL_WORD)1 << (2 * j);
+      extra  = groups * (2 * sizeof(unsigned int) + sizeof(STI_NODE));
+      if(extra >= capacity)
+         break;
+      mask = ((DBL_WORD)1 << (2 * (k + j))) - 1;
+      group_counts = (unsigned int*)calloc(groups, sizeof(unsigned int));
+      if(group_counts == 0)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+      for(p = 1; p + k + j <= length + 1; p++)
+      {
+         word = packed_word(words, p) & mask;
+         if((word & kmer_mask) == code)
+            group_counts[word >> (2 * k)]++;
+      }
+      /* The top has a leaf per group and per short suffix */
+      items = count;
+      largest = 0;
+      for(g = 0; g < groups; g++)
+      {
+         if(group_counts[g] > 0)
+            items -= group_counts[g] - 1;
+         if(group_counts[g] > largest)
+            largest = group_counts[g];
+      }
+      if(STI_PARTITION_BYTES(largest, largest) + extra <= capacity && STI_PARTITION_BYTES(items, items) + extra <= capacity)
+         break;
+      free(group_counts);
+      group_counts = 0;
+   }
+   if(group_counts == 0)
+      return 0;
+
+   cursor = (unsigned int*)malloc(groups * sizeof(unsigned int));
+   roots  = (STI_NODE*)malloc(groups * sizeof(STI_NODE));
+   if(cursor == 0 || roots == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   build_keys(sample, words, k + j, 2 * k, code, group_counts, groups, cursor, roots, capacity - extra, out, header);
+
+   suffixes = (unsigned int*)malloc(items * sizeof(unsigned int));
+   build    = (BUILD_NODE*)malloc((2 * items + 1) * sizeof(BUILD_NODE));
+   nodes    = (STI_NODE*)malloc((2 * items + 1) * sizeof(STI_NODE));
+   order    = (unsigned int*)malloc((2 * items + 1) * sizeof(unsigned int));
+   stack    = (unsigned int*)malloc((items + 1) * sizeof(unsigned int));
+   if(suffixes == 0 || build == 0 || nodes == 0 || order == 0 || stack == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(g = 0, i = 0; g < groups; g++)
+      if(group_counts[g] > 0)
+         suffixes[i++] = roots[g].path_position;
+   for(p = length + 2 > k + j ? length + 2 - k - j : 1; p + k <= length + 1; p++)
+      if((packed_word(words, p) & kmer_mask) == code)
+         suffixes[i++] = (unsigned int)p;
+   sort_sample = sample;
+   sort_k      = k;
+   qsort(suffixes, items, sizeof(unsigned int), compare_suffixes);
+   laid = build_subtree(sample, k, suffixes, items, build, order, stack, nodes, header->number_nodes);
+   for(q = 0; q < laid; q++)
+   {
+      p = nodes[q].path_position;
+      if(nodes[q].sons == 0 && p + k + j <= length + 1)
+         nodes[q] = roots[(packed_word(words, p) & mask) >> (2 * k)];
+   }
+   *root = (unsigned int)header->number_nodes;
+   write_nodes(out, header, nodes, laid);
+   header->number_partitions++;
+   free(group_counts);
+   free(cursor);
+   free(roots);
+   free(suffixes);
+   free(build);
+   free(nodes);
+   free(order);
+   free(stack);
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   build_keys :
+   Builds the subtrees of the suffixes by their first bases (the keys), in
+   partitions of consecutive keys that fit the budget, and writes them. A key
+   is a k-mer, or the bases after a k-mer when split_kmer splits it.
+
+   Input : The sample of the text, the packed text, the bases of a key with
+           the k-mer below them (2 * k bits to shift out, 0 for the k-mers
+           themselves) and that k-mer, the number of suffixes of each key and
+           the number of keys, the table (where the subtree of each k-mer is
+           put, the next suffix of each key while they are gathered), the roots
+           of the subtrees of the keys after a k-mer (kept, not written; 0 for
+           the k-mers), the memory budget, the index file and its header.
+
+   Output: 1 on success, 0 when the suffixes of one k-mer do not fit the
+           budget even split.
+*/
+
+static int build_keys(const ST_SAMPLE* sample, const DBL_WORD* words, DBL_WORD bases, DBL_WORD shift,
+                      DBL_WORD prefix, const unsigned int* counts, DBL_WORD keys, unsigned int* table,
+                      STI_NODE* roots, DBL_WORD capacity, FILE* out, STI_HEADER* header)
+{
+   DBL_WORD       first, last, total, largest, start, laid, p, key, word, length = sample->length;
+   DBL_WORD       mask = ((DBL_WORD)1 << (2 * bases)) - 1, prefix_mask = ((DBL_WORD)1 << shift) - 1;
+   unsigned int*  suffixes;
+   unsigned int*  order;
+   unsigned int*  stack;
+   BUILD_NODE*    build;
+   STI_NODE*      nodes;
+
+   for(first = 0; first < keys; first = last)
+   {
+      /* The partition: keys from first while their suffixes fit the budget */
+      total = largest = 0;
+      for(last = first; last < keys; last++)
+      {
+         if(last > first && STI_PARTITION_BYTES(total + counts[last], counts[last] > largest ? counts[last] : largest) > capacity)
+            break;
+         total += counts[last];
+         if(counts[last] > largest)
+            largest = counts[last];
+      }
+      if(total == 0)
+         continue;
+      if(STI_PARTITION_BYTES(total, largest) > capacity)
+      {
+         /* A k-mer with more suffixes than that is split by longer prefixes */
+         if(roots != 0 || !split_kmer(sample, words, bases, first, total, capacity, out, header, &table[first]))
+            return 0;
+         continue;
+      }
+
+      suffixes = (unsigned int*)malloc(total * sizeof(unsigned int));
+      build    = (BUILD_NODE*)malloc((2 * largest + 1) * sizeof(BUILD_NODE));
+      nodes    = (STI_NODE*)malloc((2 * largest + 1) * sizeof(STI_NODE));
+      order    = (unsigned int*)malloc((2 * largest + 1) * sizeof(unsigned int));
+      stack    = (unsigned int*)malloc((largest + 1) * sizeof(unsigned int));
+      if(suffixes == 0 || build == 0 || nodes == 0 || order == 0 || stack == 0)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+
+      /* Gather the suffixes of the partition by key, the table holding where
+         the next one of each key goes */
+      for(key = first, start = 0; key < last; start += counts[key], key++)
+         table[key] = (unsigned int)start;
+      for(p = 1; p + bases <= length + 1; p++)
+      {
+         word = packed_word(words, p) & mask;
+         key  = word >> shift;
+         if((word & prefix_mask) == prefix && key >= first && key < last)
+            suffixes[table[key]++] = (unsigned int)p;
+      }
+
+      sort_sample = sample;
+      sort_k      = bases;
+      for(key = first; key < last; key++)
+      {
+         if(counts[key] == 0)
+         {
+            table[key] = STI_NONE;
+            continue;
+         }
+         start = table[key] - counts[key];
+         qsort(suffixes + start, counts[key], sizeof(unsigned int), compare_suffixes);
+         if(roots == 0)
+         {
+            laid = build_subtree(sample, bases, suffixes + start, counts[key], build, order, stack, nodes,
+                                 header->number_nodes);
+            table[key] = (unsigned int)header->number_nodes;
+            write_nodes(out, header, nodes, laid);
+         }
+         else
+         {
+            /* The root is kept for split_kmer, its sons written from number_nodes on */
+            laid = build_subtree(sample, bases, suffixes + start, counts[key], build, order, stack, nodes,
+                                 header->number_nodes - 1);
+            roots[key] = nodes[0];
+            write_nodes(out, header, nodes + 1, laid - 1);
+         }
+      }
+      header->number_partitions++;
+      free(suffixes);
+      free(build);
+      free(nodes);
+      free(order);
+      free(stack);
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   STI_Build :
+   See st_index.h for description.
+*/
+
+int STI_Build(const char* text_file, const char* index_file, DBL_WORD memory_mb, DBL_WORD k)
+{
+   STI_HEADER     header;
+   FILE*          out;
+   DBL_WORD*      words;
+   DBL_WORD       length, number_words, kmers, mask, fixed, capacity, p, code;
+   unsigned int*  counts;
+   unsigned int*  table;
+   ST_SAMPLE*     sample;
+   int            built;
+
+   METRICS_Start(METRICS_READ);
+   words = read_text(text_file, &length, &number_words);
+   METRICS_Stop(METRICS_READ);
+   if(words == 0)
+      return 0;
+
+   if(k == 0)
+      k = default_k(length);
+   if(k > STI_MAX_K)
+      k = STI_MAX_K;
+   kmers = (DBL_WORD)1 << (2 * k);
+   mask  = kmers - 1;
+
+   /* Repeats sort as fast as the rest through a ranked sample of the suffixes,
+      whose size and the peak of ranking it follow from the length */
+   fixed = number_words * sizeof(DBL_WORD) + 2 * kmers * sizeof(unsigned int);
+   if(memory_mb * 1024 * 1024 <= fixed + STS_Bytes(length))
+   {
+      printf("A memory budget of %lu MB is too small, the text, k-mer table and suffix sample alone take %lu MB.\n",
+         memory_mb, (fixed + STS_Bytes(length)) / (1024 * 1024) + 1);
+      free(words);
+      return 0;
+   }
+   METRICS_Start(METRICS_BUILD);
+   sample = STS_Create(words, 0, length);
+   METRICS_Stop(METRICS_BUILD);
+   capacity = memory_mb * 1024 * 1024 - fixed - sample->bytes;
+
+   counts = (unsigned int*)calloc(kmers, sizeof(unsigned int));
+   table  = (unsigned int*)malloc(kmers * sizeof(unsigned int));
+   if(counts == 0 || table == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(p = 1; p + k <= length + 1; p++)
+      counts[packed_word(words, p) & mask]++;
+   for(code = 0; code < kmers; code++)
+      table[code] = STI_NONE;
+
+   out = fopen(index_file, "wb");
+   if(out == 0)
+   {
+      printf("File '%s' NOT CREATED.\n", index_file);
+      STS_Delete(sample);
+      free(words);
+      free(counts);
+      free(table);
+      return 0;
+   }
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, STI_MAGIC, sizeof(header.magic));
+   header.length       = length;
+   header.k            = k;
+   header.table_offset = sizeof(STI_HEADER);
+   header.text_offset  = header.table_offset + kmers * sizeof(unsigned int);
+   header.nodes_offset = header.text_offset + number_words * sizeof(DBL_WORD);
+   fseek(out, (long)header.text_offset, SEEK_SET);
+   fwrite(words, sizeof(DBL_WORD), number_words, out);
+
+   METRICS_Start(METRICS_BUILD);
+   built = build_keys(sample, words, k, 0, 0, counts, kmers, table, 0, capacity, out, &header);
+   METRICS_Stop(METRICS_BUILD);
+   if(!built)
+   {
+      printf("A memory budget of %lu MB is too small for the suffixes of one %lu-mer, even split by longer prefixes.\n",
+         memory_mb, k);
+      STS_Delete(sample);
+      free(words);
+      free(counts);
+      free(table);
+      fclose(out);
+      remove(index_file);
+      return 0;
+   }
+   metrics.trees++;
+   metrics.symbols += length + 1;
+   metrics.nodes   += header.number_nodes;
+   metrics.bytes   += header.nodes_offset + header.number_nodes * sizeof(STI_NODE);
+
+   fseek(out, (long)header.table_offset, SEEK_SET);
+   fwrite(table, sizeof(unsigned int), kmers, out);
+   fseek(out, 0, SEEK_SET);
+   fwrite(&header, sizeof(header), 1, out);
+   STS_Delete(sample);
+   free(words);
+   free(counts);
+   free(table);
+   if(fclose(out) != 0)
+   {
+      printf("File '%s' NOT WRITTEN.\n", index_file);
+      return 0;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   STI_IsIndex :
+   See st_index.h for description.
+*/
+
+int STI_IsIndex(const char* file_name)
+{
+   char  magic[sizeof(STI_MAGIC) - 1];
+   FILE* file = fopen(file_name, "rb");
+   int   is_index;
+
+   if(file == 0)
+      return 0;
+   is_index = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, STI_MAGIC, sizeof(magic)) == 0;
+   fclose(file);
+   return is_index;
+}
+
+/******************************************************************************/
+/*
+   STI_Open :
+   See st_index.h for description.
+*/
+
+ST_INDEX* STI_Open(const char* index_file)
+{
+   ST_INDEX*   index;
+   struct stat status;
+   STI_HEADER* header;
+   int         file = open(index_file, O_RDONLY);
+
+   if(file < 0)
+   {
+      printf("File '%s' NOT FOUND.\n", index_file);
+      return 0;
+   }
+   index = (ST_INDEX*)malloc(sizeof(ST_INDEX));
+   if(index == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   if(fstat(file, &status) != 0 || (DBL_WORD)status.st_size < sizeof(STI_HEADER)
+      || (index->map = mmap(0, status.st_size, PROT_READ, MAP_SHARED, file, 0)) == MAP_FAILED)
+   {
+      printf("File '%s' is not an index.\n", index_file);
+      close(file);
+      free(index);
+      return 0;
+   }
+   index->map_size = status.st_size;
+   index->mapped   = 1;
+   index->shortest = 0;
+   if(PLACEMENT_Active())
+   {
+      /* A copy in placed memory instead of the page cache */
+      void* placed = PLACEMENT_Alloc(index->map_size);
+      if(placed == 0)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+      memcpy(placed, index->map, index->map_size);
+      munmap(index->map, index->map_size);
+      index->map    = placed;
+      index->mapped = 0;
+   }
+   close(file);
+   header = (STI_HEADER*)index->map;
+   if(memcmp(header->magic, STI_MAGIC, sizeof(header->magic)) != 0 || header->k == 0 || header->k > STI_MAX_K
+      || header->nodes_offset + header->number_nodes * sizeof(STI_NODE) != index->map_size)
+   {
+      printf("File '%s' is not an index.\n", index_file);
+      STI_Close(index);
+      return 0;
+   }
+   index->header        = header;
+   index->table         = (const unsigned int*)((char*)index->map + header->table_offset);
+   index->packed_string = (const DBL_WORD*)((char*)index->map + header->text_offset);
+   index->nodes         = (const STI_NODE*)((char*)index->map + header->nodes_offset);
+   return index;
+}
+
+/******************************************************************************/
+/*
+   freeze_roots :
+   Finds the nodes under node whose incoming edge holds the k-th character of
+   their path, the roots of the k-mer subtrees (as jump_fill in suffix_tree.c).
+
+   Input : The tree, a node, the length of its father's path, k and the roots
+           by k-mer to fill in.
+*/
+
+static void freeze_roots(SUFFIX_TREE* tree, NODE* node, DBL_WORD father_depth, DBL_WORD k, NODE** roots)
+{
+   DBL_WORD depth = father_depth + get_node_label_length(tree, node);
+
+   if(depth < k)
+   {
+      for(node = node->sons; node != 0; node = node->right_sibling)
+         freeze_roots(tree, node, depth, k, roots);
+      return;
+   }
+   /* A path of fewer bases ends with the $ inside the k characters */
+   if(node->path_position + k > tree->length)
+      return;
+   roots[packed_word(tree->packed_string, node->path_position) & (((DBL_WORD)1 << (2 * k)) - 1)] = node;
+}
+
+/******************************************************************************/
+/*
+   subtree_size :
+   Returns the number of nodes of the subtree of a node, walking it through
+   the father pointers rather than recursing down long repeats.
+*/
+
+static DBL_WORD subtree_size(NODE* root)
+{
+   NODE* node = root;
+   DBL_WORD size = 0;
+
+   for(;;)
+   {
+      size++;
+      if(node->sons != 0)
+      {
+         node = node->sons;
+         continue;
+      }
+      while(node != root && node->right_sibling == 0)
+         node = node->father;
+      if(node == root)
+         return size;
+      node = node->right_sibling;
+   }
+}
+
+/******************************************************************************/
+/*
+   ST_Freeze :
+   See st_index.h for description.
+*/
+
+ST_INDEX* ST_Freeze(SUFFIX_TREE* tree, DBL_WORD k)
+{
+   ST_INDEX*      index;
+   STI_HEADER*    header;
+   unsigned int*  table;
+   STI_NODE*      nodes;
+   NODE**         roots;
+   NODE**         order;
+   NODE*          son;
+   DBL_WORD       length, kmers, code, number_words, number_nodes = 0, largest = 0, size, laid, q;
+
+   if(tree->packed_string == 0)
+      return 0;
+   length = tree->length - 1;
+   if(k == 0)
+      k = default_k(length);
+   if(k > STI_MAX_K)
+      k = STI_MAX_K;
+   kmers        = (DBL_WORD)1 << (2 * k);
+   number_words = tree->length / PACKED_BASES + 2;
+
+   METRICS_Start(METRICS_BUILD);
+   roots = (NODE**)calloc(kmers, sizeof(NODE*));
+   if(roots == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(son = tree->root->sons; son != 0; son = son->right_sibling)
+      freeze_roots(tree, son, 0, k, roots);
+   for(code = 0; code < kmers; code++)
+      if(roots[code] != 0)
+      {
+         size = subtree_size(roots[code]);
+         number_nodes += size;
+         if(size > largest)
+            largest = size;
+      }
+   if(number_nodes >= STI_NONE)
+   {
+      printf("Too many nodes for the index format.\n");
+      exit(0);
+   }
+
+   /* One block, laid out as the index file */
+   index = (ST_INDEX*)malloc(sizeof(ST_INDEX));
+   order = (NODE**)malloc((largest + 1) * sizeof(NODE*));
+   if(index != 0)
+   {
+      index->map_size = sizeof(STI_HEADER) + kmers * sizeof(unsigned int) + number_words * sizeof(DBL_WORD)
+                        + number_nodes * sizeof(STI_NODE);
+      index->map      = PLACEMENT_Alloc(index->map_size);
+   }
+   if(index == 0 || order == 0 || index->map == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   header = (STI_HEADER*)index->map;
+   memcpy(header->magic, STI_MAGIC, sizeof(header->magic));
+   header->length            = length;
+   header->k                 = k;
+   header->number_nodes      = number_nodes;
+   header->number_partitions = 1;
+   header->table_offset      = sizeof(STI_HEADER);
+   header->text_offset       = header->table_offset + kmers * sizeof(unsigned int);
+   header->nodes_offset      = header->text_offset + number_words * sizeof(DBL_WORD);
+   table = (unsigned int*)((char*)index->map + header->table_offset);
+   nodes = (STI_NODE*)((char*)index->map + header->nodes_offset);
+   memcpy((char*)index->map + header->text_offset, tree->packed_string, number_words * sizeof(DBL_WORD));
+
+   /* Each k-mer subtree breadth first, the sons of a node next to each other
+      in the tree's order */
+   number_nodes = 0;
+   for(code = 0; code < kmers; code++)
+   {
+      if(roots[code] == 0)
+      {
+         table[code] = STI_NONE;
+         continue;
+      }
+      table[code] = (unsigned int)number_nodes;
+      order[0] = roots[code];
+      laid = 1;
+      for(q = 0; q < laid; q++)
+      {
+         nodes[number_nodes + q].path_position = (unsigned int)order[q]->path_position;
+         nodes[number_nodes + q].depth = (unsigned int)(get_node_label_end(tree, order[q]) - order[q]->path_position + 1);
+         for(son = order[q]->sons; son != 0; son = son->right_sibling)
+         {
+            if(nodes[number_nodes + q].sons++ == 0)
+               nodes[number_nodes + q].first_son = (unsigned int)(number_nodes + laid);
+            order[laid++] = son;
+         }
+      }
+      number_nodes += laid;
+   }
+   free(roots);
+   free(order);
+   METRICS_Stop(METRICS_BUILD);
+   metrics.bytes += index->map_size;
+
+   index->header        = header;
+   index->table         = table;
+   index->packed_string = (const DBL_WORD*)((char*)index->map + header->text_offset);
+   index->nodes         = nodes;
+   index->mapped        = 0;
+   index->shortest      = 0;
+   return index;
+}
+
+/******************************************************************************/
+/*
+   STI_Frozen :
+   See st_index.h for description.
+*/
+
+int STI_Frozen(void)
+{
+   const char* freeze = getenv("GENOMEOT_FREEZE");
+
+   return freeze != 0 && atoi(freeze) != 0;
+}
+
+/******************************************************************************/
+/*
+   STI_Write :
+   See st_index.h for description.
+*/
+
+int STI_Write(ST_INDEX* index, const char* index_file)
+{
+   FILE* out = fopen(index_file, "wb");
+   int   written;
+
+   if(out == 0)
+   {
+      printf("File '%s' NOT CREATED.\n", index_file);
+      return 0;
+   }
+   written = fwrite(index->map, 1, index->map_size, out) == index->map_size;
+   if(fclose(out) != 0 || !written)
+   {
+      printf("File '%s' NOT WRITTEN.\n", index_file);
+      return 0;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   index_match :
+   Tells whether the n bases of the text from index i are the string W
+   (anything but a base in W is a mismatch).
+*/
+
+static int index_match(ST_INDEX* index, DBL_WORD i, const char* W, DBL_WORD n)
+{
+   DBL_WORD matched, count, word, bases;
+
+   for(matched = 0; matched < n; matched += count)
+   {
+      count = n - matched < PACKED_BASES ? n - matched : PACKED_BASES;
+      if(!pack_word(W + matched, count, &word))
+         return 0;
+      bases = packed_word(index->packed_string, i + matched);
+      if(count < PACKED_BASES)
+         bases &= ((DBL_WORD)1 << (count * 2)) - 1;
+      if(bases != word)
+         return 0;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   shortest_table :
+   The first position of every string shorter than k that starts a k-mer:
+   those of length k - 1 the least of their 4 k-mer subtrees, those of each
+   length below the least of their 4 extensions. The strings of length P
+   (packed as pack_word does) are at (4^P - 4) / 3. Made once for an index,
+   threads searching it at the same time keep the first one made.
+
+   Output: The table, STI_NONE for a string no k-mer starts with.
+*/
+
+static const unsigned int* shortest_table(ST_INDEX* index)
+{
+   DBL_WORD k = index->header->k, P, code, b, count, node;
+   unsigned int* table = __atomic_load_n(&index->shortest, __ATOMIC_ACQUIRE);
+   unsigned int* made = 0;
+   unsigned int* level;
+   unsigned int* longer;
+   unsigned int  position;
+
+   if(table != 0)
+      return table;
+   table = (unsigned int*)malloc(((((DBL_WORD)1 << (2 * k)) - 4) / 3 + 1) * sizeof(unsigned int));
+   if(table == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(P = k - 1; P > 0; P--)
+   {
+      count  = (DBL_WORD)1 << (2 * P);
+      level  = table + (count - 4) / 3;
+      longer = table + (4 * count - 4) / 3;
+      for(code = 0; code < count; code++)
+      {
+         level[code] = STI_NONE;
+         for(b = 0; b < 4; b++)
+         {
+            if(P == k - 1)
+            {
+               node = index->table[code | (b << (2 * P))];
+               position = node == STI_NONE ? STI_NONE : index->nodes[node].path_position;
+            }
+            else
+               position = longer[code | (b << (2 * P))];
+            if(position < level[code])
+               level[code] = position;
+         }
+      }
+   }
+   if(!__atomic_compare_exchange_n(&index->shortest, &made, table, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+   {
+      free(table);
+      table = made;
+   }
+   return table;
+}
+
+/******************************************************************************/
+/*
+   find_short :
+   Searches a string shorter than k: the first position of the k-mers it is
+   the start of, or the last bases of the text, which start no k-mer. The
+   first position of all is the one ST_FindSubstring finds.
+*/
+
+static DBL_WORD find_short(ST_INDEX* index, const char* W, DBL_WORD P)
+{
+   DBL_WORD k = index->header->k, length = index->header->length, prefix, i;
+   unsigned int position;
+
+   if(!pack_word(W, P, &prefix))
+      return STI_ERROR;
+   position = shortest_table(index)[((((DBL_WORD)1 << (2 * P)) - 4) / 3) + prefix];
+   if(position != STI_NONE)
+      return position;
+   /* The last bases are after every k-mer */
+   for(i = length + 2 > k ? length + 2 - k : 1; i + P <= length + 1; i++)
+      if(index_match(index, i, W, P))
+         return i;
+   return STI_ERROR;
+}
+
+/******************************************************************************/
+/*
+   find_node :
+   Descends from the subtree of the first k bases of a string (at least k
+   long) to the node its path ends on or in.
+
+   Output: The node, 0 if the string is not in the text.
+*/
+
+static const STI_NODE* find_node(ST_INDEX* index, const char* W, DBL_WORD P)
+{
+   DBL_WORD k = index->header->k, length = index->header->length, code, matched, bases, next;
+   const STI_NODE* node;
+   const STI_NODE* son;
+   unsigned int s;
+
+   if(!pack_word(W, k, &code) || index->table[code] == STI_NONE)
+      return 0;
+   node = index->nodes + index->table[code];
+   /* The first k bases are those of the k-mer */
+   matched = k;
+   for(;;)
+   {
+      /* A leaf's path ends with the $, no base of W matches it */
+      bases = node->sons == 0 ? node->depth - 1 : node->depth;
+      if(bases > P)
+         bases = P;
+      if(!index_match(index, node->path_position + matched, W + matched, bases - matched))
+         return 0;
+      matched = bases;
+      if(matched == P)
+         return node;
+      if(node->sons == 0)
+         return 0;
+      /* The son whose edge starts with the next base of W */
+      son = 0;
+      for(s = 0; s < node->sons; s++)
+      {
+         next = index->nodes[node->first_son + s].path_position + node->depth;
+         if(next <= length && "ACGT"[PACKED_BASE(index->packed_string, next)] == W[matched])
+         {
+            son = index->nodes + node->first_son + s;
+            break;
+         }
+      }
+      if(son == 0)
+         return 0;
+      node = son;
+   }
+}
+
+/******************************************************************************/
+/*
+   STI_FindSubstring :
+   See st_index.h for description.
+*/
+
+DBL_WORD STI_FindSubstring(ST_INDEX* index, const char* W, DBL_WORD P)
+{
+   DBL_WORD position;
+   const STI_NODE* node;
+
+   metrics_lookups->lookups++;
+   if(P == 0 || P > index->header->length)
+      return STI_ERROR;
+   if(P < index->header->k)
+   {
+      position = find_short(index, W, P);
+      if(position != STI_ERROR)
+         metrics_lookups->found++;
+      return position;
+   }
+   node = find_node(index, W, P);
+   if(node == 0)
+      return STI_ERROR;
+   metrics_lookups->found++;
+   metrics_lookups->matched += P;
+   return node->path_position;
+}
+
+/******************************************************************************/
+/*
+   add_position :
+   Appends a position to a growing array.
+*/
+
+static void add_position(DBL_WORD** positions, DBL_WORD* count, DBL_WORD* allocated, DBL_WORD position)
+{
+   if(*count == *allocated)
+   {
+      *allocated = *allocated == 0 ? 64 : *allocated * 2;
+      *positions = (DBL_WORD*)realloc(*positions, *allocated * sizeof(DBL_WORD));
+      if(*positions == 0)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+   }
+   (*positions)[(*count)++] = position;
+}
+
+/******************************************************************************/
+/*
+   add_leaves :
+   Appends the path positions of the leaves under a node, the suffixes its
+   path starts.
+*/
+
+static void add_leaves(ST_INDEX* index, const STI_NODE* root, DBL_WORD** positions, DBL_WORD* count,
+                       DBL_WORD* allocated)
+{
+   const STI_NODE** stack;
+   const STI_NODE* node;
+   DBL_WORD depth = 1, size = 64;
+   unsigned int s;
+
+   stack = (const STI_NODE**)malloc(size * sizeof(STI_NODE*));
+   if(stack == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   stack[0] = root;
+   while(depth > 0)
+   {
+      node = stack[--depth];
+      if(node->sons == 0)
+      {
+         add_position(positions, count, allocated, node->path_position);
+         continue;
+      }
+      if(depth + node->sons > size)
+      {
+         while(depth + node->sons > size)
+            size *= 2;
+         stack = (const STI_NODE**)realloc(stack, size * sizeof(STI_NODE*));
+         if(stack == 0)
+         {
+            printf("\nOut of memory.\n");
+            exit(0);
+         }
+      }
+      for(s = 0; s < node->sons; s++)
+         stack[depth++] = index->nodes + node->first_son + s;
+   }
+   free(stack);
+}
+
+/******************************************************************************/
+/*
+   compare_positions :
+   Orders positions for qsort.
+*/
+
+static int compare_positions(const void* a, const void* b)
+{
+   DBL_WORD x = *(const DBL_WORD*)a, y = *(const DBL_WORD*)b;
+
+   return x < y ? -1 : x > y;
+}
+
+/******************************************************************************/
+/*
+   STI_FindAll :
+   See st_index.h for description.
+*/
+
+DBL_WORD STI_FindAll(ST_INDEX* index, const char* W, DBL_WORD P, DBL_WORD** positions)
+{
+   DBL_WORD k = index->header->k, length = index->header->length, count = 0, allocated = 0, prefix, rest, i;
+   const STI_NODE* node;
+
+   *positions = 0;
+   metrics_lookups->lookups++;
+   if(P == 0 || P > length)
+      return 0;
+   if(P < k)
+   {
+      /* The subtrees of the k-mers the string starts, then the last bases
+         of the text, as find_short */
+      if(!pack_word(W, P, &prefix))
+         return 0;
+      if(shortest_table(index)[((((DBL_WORD)1 << (2 * P)) - 4) / 3) + prefix] != STI_NONE)
+         for(rest = 0; rest < (DBL_WORD)1 << (2 * (k - P)); rest++)
+            if(index->table[prefix | (rest << (2 * P))] != STI_NONE)
+               add_leaves(index, index->nodes + index->table[prefix | (rest << (2 * P))], positions, &count, &allocated);
+      for(i = length + 2 > k ? length + 2 - k : 1; i + P <= length + 1; i++)
+         if(index_match(index, i, W, P))
+            add_position(positions, &count, &allocated, i);
+   }
+   else
+   {
+      node = find_node(index, W, P);
+      if(node != 0)
+         add_leaves(index, node, positions, &count, &allocated);
+   }
+   if(count > 0)
+   {
+      metrics_lookups->found++;
+      metrics_lookups->matched += P;
+   }
+   if(count > 1)
+      qsort(*positions, count, sizeof(DBL_WORD), compare_positions);
+   return count;
+}
+
+/******************************************************************************/
+/*
+   STI_Close :
+   See st_index.h for description.
+*/
+
+void STI_Close(ST_INDEX* index)
+{
+   if(index->mapped)
+      munmap(index->map, index->map_size);
+   else
+      PLACEMENT_Free(index->map, index->map_size);
+   free(index->shortest);
+   free(index);
+}
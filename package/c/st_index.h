@@ -0,0 +1,203 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file st_index.h for the persistent suffix index, built
+out of core for texts whose Ukkonen tree does not fit in memory (a whole
+chromosome instead of 1 Mbp sections).
+
+The suffixes are partitioned by their first k bases. Each partition (a run
+of consecutive k-mers small enough for the memory budget) is collected, its
+suffixes sorted, and the subtree of each k-mer built from the sorted suffixes
+and their common prefixes, laid out breadth first and appended to the index
+file. A k-mer with more suffixes than the budget holds is split by the bases
+after it, the subtree of each longer prefix built in turn and the top of the
+k-mer subtree from their roots. Only the packed text, the k-mer table, a
+ranked sample of the suffixes (st_sort.h, about 1 byte per base, through
+which a repeat sorts as fast as any other string) and one partition are in
+memory at a time. The index is
+then searched through a mapping of the file, so a query only brings in the
+pages of the nodes it descends through.
+
+The same layout is the frozen form of a tree built in memory (ST_Freeze): one
+block with the nodes of each k-mer subtree breadth first and the sons of a
+node next to each other, holding none of the construction fields (suffix
+links, father and sibling pointers). Nothing writes to an index once it is
+built, so threads can search one index at the same time, and a frozen tree is
+written out byte for byte as an index file (STI_Write).
+
+The file, in the byte order of the machine that built it:
+
+   STI_HEADER
+   k-mer table   4^k unsigned ints, the node of the subtree of each k-mer
+                 (STI_NONE when the k-mer is not in the text)
+   text          the text packed 2 bits per base as in suffix_tree.c (the
+                 base at index i in bits 2*i, index 0 unused), in DBL_WORDs
+   nodes         STI_NODE records, the subtrees one after the other
+
+Only texts of A, C, G and T are indexed (see fasta2acgt). Include
+suffix_tree.h before this file.
+*******************************************************************************/
+
+#define STI_MAGIC     "STINDEX1"
+/* Table entry of a k-mer the text does not have */
+#define STI_NONE      0xFFFFFFFFU
+/* Error return value of STI_FindSubstring */
+#define STI_ERROR     0
+
+/* A node and its incoming edge. The edge label starts at index
+   path_position + (depth of the father) of the text. */
+typedef struct STINODE
+{
+   /* Start index (from 1) of the node's path in the text */
+   unsigned int   path_position;
+   /* Length of the node's path; a leaf's path runs to the $ after the text */
+   unsigned int   depth;
+   /* Index of the first son, the sons are stored next to each other in
+      path position order, as in the tree of ST_CreateTree */
+   unsigned int   first_son;
+   /* Number of sons, 0 for a leaf */
+   unsigned int   sons;
+} STI_NODE;
+
+typedef struct STIHEADER
+{
+   char           magic[8];
+   /* Bases of the text, without the $ */
+   DBL_WORD       length;
+   /* Bases of the k-mers of the table */
+   DBL_WORD       k;
+   DBL_WORD       number_nodes;
+   /* Number of partitions the index was built in, 1 for a frozen tree */
+   DBL_WORD       number_partitions;
+   /* File offsets of the table, the text and the nodes */
+   DBL_WORD       table_offset;
+   DBL_WORD       text_offset;
+   DBL_WORD       nodes_offset;
+} STI_HEADER;
+
+/* An index open for search */
+typedef struct STINDEX
+{
+   STI_HEADER*          header;
+   const unsigned int*  table;
+   const DBL_WORD*      packed_string;
+   const STI_NODE*      nodes;
+   /* The mapping of the file, or the block of a frozen tree */
+   void*                map;
+   DBL_WORD             map_size;
+   /* 1 when map is a mapping of the file, 0 when it is placed memory (see
+      placement.h) */
+   int                  mapped;
+   /* First position of each string shorter than k, the strings of each
+      length after those of the length before; made from the table by the
+      first search of one, 0 until then */
+   unsigned int*        shortest;
+} ST_INDEX;
+
+
+/******************************************************************************/
+/*
+   STI_Build :
+   Builds the index of a text file within a memory budget.
+
+   Input : The text file (A, C, G and T only), the index file to write, the
+           memory budget in MB and the k-mer length of the partitions (0 to
+           choose it from the text length).
+
+   Output: 1 on success, 0 on an error (which is printed), as when the budget
+           does not hold the text, the table and the ranking of the sample,
+           or the suffixes of one k-mer even split by the 31 bases after it.
+*/
+
+int STI_Build(const char* text_file, const char* index_file, DBL_WORD memory_mb, DBL_WORD k);
+
+/******************************************************************************/
+/*
+   STI_IsIndex :
+   Tells whether a file is an index (starts with STI_MAGIC).
+*/
+
+int STI_IsIndex(const char* file_name);
+
+/******************************************************************************/
+/*
+   STI_Open :
+   Maps an index file for search, or reads it into placed memory when a
+   placement is set (see placement.h).
+
+   Output: The index, 0 on an error (which is printed).
+*/
+
+ST_INDEX* STI_Open(const char* index_file);
+
+/******************************************************************************/
+/*
+   ST_Freeze :
+   Rewrites a tree built in memory into the layout of an index, for searches
+   only. The tree is left as it is and may be deleted.
+
+   Input : The tree (of A, C, G and T only) and the k-mer length of the table
+           (0 to choose it from the text length, as STI_Build).
+
+   Output: The frozen index, 0 if the tree is not of DNA.
+*/
+
+ST_INDEX* ST_Freeze(SUFFIX_TREE* tree, DBL_WORD k);
+
+/******************************************************************************/
+/*
+   STI_Frozen :
+   Whether tools freeze their trees after building them, from the
+   environment:
+
+      GENOMEOT_FREEZE=1   search a frozen index instead of the tree
+
+   Output: 1 when it is set, 0 if not.
+*/
+
+int STI_Frozen(void);
+
+/******************************************************************************/
+/*
+   STI_Write :
+   Writes an index (open or frozen) to an index file, which STI_Open maps.
+
+   Output: 1 on success, 0 on an error (which is printed).
+*/
+
+int STI_Write(ST_INDEX* index, const char* index_file);
+
+/******************************************************************************/
+/*
+   STI_FindSubstring :
+   Searches a string in the index, as ST_FindSubstring does in a tree.
+
+   Input : The index, the string and its length.
+
+   Output: The index (from 1) in the text of an occurrence of the string,
+           STI_ERROR if it is not there.
+*/
+
+DBL_WORD STI_FindSubstring(ST_INDEX* index, const char* W, DBL_WORD P);
+
+/******************************************************************************/
+/*
+   STI_FindAll :
+   Finds every occurrence of a string in the index, the leaves under the
+   node its path ends on.
+
+   Input : The index, the string and its length, and where to put the
+           positions.
+
+   Output: The number of occurrences; *positions is set to their indices
+           (from 1) in increasing order, allocated (to free, 0 if none).
+*/
+
+DBL_WORD STI_FindAll(ST_INDEX* index, const char* W, DBL_WORD P, DBL_WORD** positions);
+
+/******************************************************************************/
+/*
+   STI_Close :
+   Unmaps (or frees) the index and frees it.
+*/
+
+void STI_Close(ST_INDEX* index);
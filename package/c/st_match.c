@@ -0,0 +1,300 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file st_match.c implementing the header file
+st_match.h.
+*******************************************************************************/
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "suffix_tree.h"
+#include "st_match.h"
+
+/* From suffix_tree.c */
+char tree_char(SUFFIX_TREE* tree, DBL_WORD i);
+NODE* find_son(SUFFIX_TREE* tree, NODE* node, char character);
+DBL_WORD get_node_label_end(SUFFIX_TREE* tree, NODE* node);
+DBL_WORD get_node_label_length(SUFFIX_TREE* tree, NODE* node);
+
+/* Length of the path of a node (the path position is where it starts) */
+#define PATH_LENGTH(tree, node) ((node) == (tree)->root ? 0 : \
+   get_node_label_end(tree, node) - (node)->path_position + 1)
+
+/******************************************************************************/
+/*
+   ST_MatchStart :
+   See st_match.h for description.
+*/
+
+void ST_MatchStart(SUFFIX_TREE* tree, ST_MATCH* match)
+{
+   match->node   = tree->root;
+   match->depth  = 0;
+   match->length = 0;
+}
+
+/******************************************************************************/
+/*
+   ST_MatchExtend :
+   See st_match.h for description.
+*/
+
+int ST_MatchExtend(SUFFIX_TREE* tree, ST_MATCH* match, const char* query, DBL_WORD available)
+{
+   NODE* son;
+   DBL_WORD edge_length, c;
+
+   for(;;)
+   {
+      if(match->length >= available)
+         return 0;
+      son = find_son(tree, match->node, query[match->depth]);
+      if(son == 0)
+         return 1;
+      edge_length = get_node_label_length(tree, son);
+      /* The characters of the edge the match has not yet */
+      for(c = son->edge_label_start + match->length - match->depth;
+          match->length < match->depth + edge_length; c++, match->length++)
+      {
+         if(match->length >= available)
+            return 0;
+         /* The $ (or a separator) ends every match */
+         if(tree_char(tree, c) != query[match->length] || query[match->length] == '$'
+            || query[match->length] == ST_SEPARATOR)
+            return 1;
+      }
+      match->node  = son;
+      match->depth += edge_length;
+   }
+}
+
+/******************************************************************************/
+/*
+   ST_MatchNext :
+   See st_match.h for description.
+*/
+
+void ST_MatchNext(SUFFIX_TREE* tree, ST_MATCH* match, const char* query)
+{
+   NODE* son;
+   DBL_WORD edge_length;
+
+   if(match->length == 0)
+      return;
+   match->length--;
+   if(match->node != tree->root && match->node->suffix_link != 0)
+   {
+      match->node = match->node->suffix_link;
+      match->depth--;
+   }
+   else
+   {
+      match->node  = tree->root;
+      match->depth = 0;
+   }
+   /* Down whole edges to the length (skip and count: the characters are
+      known to be there, only the first of each edge is looked at) */
+   query++;
+   while(match->length > match->depth)
+   {
+      son = find_son(tree, match->node, query[match->depth]);
+      edge_length = get_node_label_length(tree, son);
+      if(match->length - match->depth < edge_length)
+         break;
+      match->node  = son;
+      match->depth += edge_length;
+   }
+}
+
+/******************************************************************************/
+/*
+   ST_MatchMarks :
+   See st_match.h for description.
+*/
+
+void ST_MatchMarks(SUFFIX_TREE* tree)
+{
+   NODE* node = tree->root;
+   NODE* son;
+
+   /* Each node after its sons, through the father pointers rather than
+      recursing down long repeats */
+   while(node->sons != 0)
+      node = node->sons;
+   for(;;)
+   {
+      if(node->sons == 0)
+         node->left_char = node->path_position > 1 ? tree_char(tree, node->path_position - 1) : 0;
+      else
+      {
+         node->left_char = node->sons->left_char;
+         for(son = node->sons->right_sibling; son != 0 && node->left_char != 0; son = son->right_sibling)
+            if(son->left_char != node->left_char)
+               node->left_char = 0;
+      }
+      node->is_left_diverse = node->left_char != 0;
+      if(node == tree->root)
+         return;
+      if(node->right_sibling != 0)
+      {
+         node = node->right_sibling;
+         while(node->sons != 0)
+            node = node->sons;
+      }
+      else
+         node = node->father;
+   }
+}
+
+/******************************************************************************/
+/*
+   add_leaves :
+   Adds the maximal matches of the leaves under a node, all of one length, to
+   the anchors. Walks the subtree through the father pointers rather than
+   recursing down long repeats, and passes over the subtrees whose leaves
+   all have the character before (marked by ST_MatchMarks; a leaf's own
+   character is looked at, its mark may be older).
+*/
+
+static void add_leaves(SUFFIX_TREE* tree, NODE* top, char before, DBL_WORD length,
+                       ST_ANCHOR** anchors, DBL_WORD* number_anchors, DBL_WORD* allocated)
+{
+   NODE* node = top;
+
+   for(;;)
+   {
+      if(node->sons != 0)
+      {
+         if(before == 0 || node->left_char != before)
+         {
+            node = node->sons;
+            continue;
+         }
+      }
+      /* Left maximal: a string starts before it, or the characters differ */
+      else if(before == 0 || node->path_position == 1 || tree_char(tree, node->path_position - 1) != before)
+      {
+         if(*number_anchors == *allocated)
+         {
+            *allocated = *allocated == 0 ? 64 : *allocated * 2;
+            *anchors   = (ST_ANCHOR*)realloc(*anchors, *allocated * sizeof(ST_ANCHOR));
+            if(*anchors == 0)
+            {
+               printf("\nOut of memory.\n");
+               exit(0);
+            }
+         }
+         (*anchors)[*number_anchors].text_position  = node->path_position;
+         (*anchors)[*number_anchors].query_position = 0;
+         (*anchors)[*number_anchors].length         = length;
+         (*number_anchors)++;
+      }
+      while(node != top && node->right_sibling == 0)
+         node = node->father;
+      if(node == top)
+         return;
+      node = node->right_sibling;
+   }
+}
+
+/******************************************************************************/
+/*
+   ST_MatchMaximal :
+   See st_match.h for description.
+*/
+
+DBL_WORD ST_MatchMaximal(SUFFIX_TREE* tree, ST_MATCH* match, const char* query, char before, DBL_WORD min_length,
+                         int unique, ST_ANCHOR** anchors, DBL_WORD* number_anchors, DBL_WORD* allocated)
+{
+   DBL_WORD first = *number_anchors, depth;
+   NODE* locus = match->node;
+   NODE* father;
+   NODE* son;
+
+   if(match->length < min_length || match->length == 0)
+      return 0;
+   /* The subtree of the match: its node, or the one it ends on the edge to */
+   if(match->length > match->depth)
+      locus = find_son(tree, match->node, query[match->depth]);
+   if(unique)
+   {
+      if(locus->sons == 0)
+         add_leaves(tree, locus, before, match->length, anchors, number_anchors, allocated);
+      return *number_anchors - first;
+   }
+   add_leaves(tree, locus, before, match->length, anchors, number_anchors, allocated);
+   /* The leaves branching off above, as long as they match long enough */
+   for(; locus != tree->root; locus = father)
+   {
+      father = locus->father;
+      depth  = PATH_LENGTH(tree, father);
+      if(depth < min_length || depth == 0)
+         break;
+      for(son = father->sons; son != 0; son = son->right_sibling)
+         if(son != locus)
+            add_leaves(tree, son, before, depth, anchors, number_anchors, allocated);
+   }
+   return *number_anchors - first;
+}
+
+/******************************************************************************/
+/*
+   compare_text_spans :
+   qsort order of anchors by text position, the longer first.
+*/
+
+static int compare_text_spans(const void* a, const void* b)
+{
+   const ST_ANCHOR* x = (const ST_ANCHOR*)a;
+   const ST_ANCHOR* y = (const ST_ANCHOR*)b;
+
+   if(x->text_position != y->text_position)
+      return x->text_position < y->text_position ? -1 : 1;
+   if(x->length != y->length)
+      return x->length > y->length ? -1 : 1;
+   return x->query_position < y->query_position ? -1 : x->query_position > y->query_position;
+}
+
+/******************************************************************************/
+/*
+   compare_query_positions :
+   qsort order of anchors by query position.
+*/
+
+static int compare_query_positions(const void* a, const void* b)
+{
+   const ST_ANCHOR* x = (const ST_ANCHOR*)a;
+   const ST_ANCHOR* y = (const ST_ANCHOR*)b;
+
+   if(x->query_position != y->query_position)
+      return x->query_position < y->query_position ? -1 : 1;
+   return x->text_position < y->text_position ? -1 : x->text_position > y->text_position;
+}
+
+/******************************************************************************/
+/*
+   ST_UniqueMatches :
+   See st_match.h for description.
+*/
+
+DBL_WORD ST_UniqueMatches(ST_ANCHOR* anchors, DBL_WORD number_anchors)
+{
+   DBL_WORD i, kept = 0, reach = 0;
+   int held;
+
+   qsort(anchors, number_anchors, sizeof(ST_ANCHOR), compare_text_spans);
+   for(i = 0; i < number_anchors; i++)
+   {
+      /* Held by an earlier span (which starts before or is longer), or
+         holding the next one (the same span) */
+      held = reach >= anchors[i].text_position + anchors[i].length
+             || (i + 1 < number_anchors && anchors[i + 1].text_position == anchors[i].text_position
+                 && anchors[i + 1].length == anchors[i].length);
+      if(anchors[i].text_position + anchors[i].length > reach)
+         reach = anchors[i].text_position + anchors[i].length;
+      if(!held)
+         anchors[kept++] = anchors[i];
+   }
+   qsort(anchors, kept, sizeof(ST_ANCHOR), compare_query_positions);
+   return kept;
+}
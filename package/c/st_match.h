@@ -0,0 +1,128 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file st_match.h for the maximal exact matches between
+the string of a tree and a query streamed past it. For each position j of the
+query the match is the longest prefix of the query from j that is in the
+tree (the matching statistic of j). It is extended character by character
+and, going from j to j + 1, shortened by one through the suffix link of its
+last node and rescanned down to its length, so all matching statistics of a
+query of length m take O(m) steps (the algorithm of Chang and Lawler).
+
+A maximal exact match (MEM) of at least a minimum length is a text position
+i, query position j and length l with the l characters equal, that can be
+extended neither right (the next characters differ or a string ends) nor
+left. The matches of j are the leaves under the match locus (of length the
+matching statistic) and the leaves branching off the path above it (of
+length the depth where they branch off) as long as that depth is the minimum
+length; those whose character before differs from the query's are maximal.
+Once ST_MatchMarks has marked each node with the character before all of
+its leaves (when they share one), a subtree whose leaves all have the
+query's character before is skipped whole.
+A maximal unique match (MUM) is a MEM whose string occurs once in the text
+and once in the query.
+
+The tree must have its suffix links, so it is built by ST_CreateTree (not
+ST_CreateTreeParallel or frozen). Include suffix_tree.h before this file.
+*******************************************************************************/
+
+/* The match of a query position: its last node and length */
+typedef struct STMATCH
+{
+   /* The deepest node whose whole path the match holds, and its path length */
+   NODE*       node;
+   DBL_WORD    depth;
+   /* Characters of the query matched */
+   DBL_WORD    length;
+} ST_MATCH;
+
+/* A maximal match, positions from 1 in the text and from 0 in the query */
+typedef struct STANCHOR
+{
+   DBL_WORD    text_position;
+   DBL_WORD    query_position;
+   DBL_WORD    length;
+} ST_ANCHOR;
+
+/******************************************************************************/
+/*
+   ST_MatchStart :
+   Sets a match to the empty one at the root, for the first query position.
+*/
+
+void ST_MatchStart(SUFFIX_TREE* tree, ST_MATCH* match);
+
+/******************************************************************************/
+/*
+   ST_MatchExtend :
+   Extends the match of a query position as far as the tree and the query
+   characters given allow.
+
+   Input : The tree, the match, the query from its position and the number of
+           query characters there are from it.
+
+   Output: 1 if the match ended at a character that differs, 0 if it ran out
+           of query characters (and may go on when more are given, from the
+           same position).
+*/
+
+int ST_MatchExtend(SUFFIX_TREE* tree, ST_MATCH* match, const char* query, DBL_WORD available);
+
+/******************************************************************************/
+/*
+   ST_MatchNext :
+   Moves a match from its query position to the next, through the suffix
+   link of its node.
+
+   Input : The tree, the match and the query from its (current) position, of
+           at least length characters.
+*/
+
+void ST_MatchNext(SUFFIX_TREE* tree, ST_MATCH* match, const char* query);
+
+/******************************************************************************/
+/*
+   ST_MatchMarks :
+   Sets the left_char of every node to the character before all of its
+   leaves, 0 when they differ or one of them starts the text (and
+   is_left_diverse to 1 when they share one, as centromere's marks), for
+   ST_MatchMaximal to skip the subtrees of no maximal match. Called once
+   after the tree is built; ST_MatchMaximal is right without it, only
+   slower.
+*/
+
+void ST_MatchMarks(SUFFIX_TREE* tree);
+
+/******************************************************************************/
+/*
+   ST_MatchMaximal :
+   Finds the maximal matches of a query position.
+
+   Input : The tree, the match of the position (extended as far as it goes),
+           the query from its position, the character before it (0 at the
+           start of the query), the minimum length, whether only the unique
+           match in the text is wanted (the candidate for a MUM), the
+           anchors to fill in, their number (reallocated as needed, start
+           with 0) and the number allocated.
+
+   Output: The number of anchors added; their query_position is 0, for the
+           caller to set.
+*/
+
+DBL_WORD ST_MatchMaximal(SUFFIX_TREE* tree, ST_MATCH* match, const char* query, char before, DBL_WORD min_length,
+                         int unique,
+                         ST_ANCHOR** anchors, DBL_WORD* number_anchors, DBL_WORD* allocated);
+
+/******************************************************************************/
+/*
+   ST_UniqueMatches :
+   Keeps of the MEMs unique in the text (from ST_MatchMaximal with unique)
+   the MUMs: those whose text span no other one's holds, as another one
+   holding it means the string is in the query twice.
+
+   Input : The anchors, unique in the text, of one query and their number.
+
+   Output: The number of MUMs, moved to the front of the anchors in query
+           order.
+*/
+
+DBL_WORD ST_UniqueMatches(ST_ANCHOR* anchors, DBL_WORD number_anchors);
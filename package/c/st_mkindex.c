@@ -0,0 +1,130 @@
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "st_index.h"
+#include "st_parallel.h"
+#include "gz_input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* memory budget when none is given, in MB */
+#define DEFAULT_MEMORY_MB 1024
+
+void Usage()
+{
+	printf("Usage: st_mkindex <text file> <index file> [<memory MB>|FREEZE [<k>]]\n");
+	printf("\n");
+	printf(" Builds the suffix index of <text file> (A, C, G and T only, see fasta2acgt) into <index file>\n");
+	printf(" using at most about <memory MB> of memory (default %d), so a whole chromosome is indexed\n", DEFAULT_MEMORY_MB);
+	printf(" without holding its suffix tree.  The suffixes are split by their first <k> bases (default\n");
+	printf(" from the text length) into partitions that fit the budget, each built and written in turn;\n");
+	printf(" a k-mer with more suffixes than the budget holds is split by the bases after it.\n");
+	printf("\n");
+	printf(" The text, a 4^k entry table and a sample of the suffixes (about 1 byte per base, it keeps\n");
+	printf(" repeats as fast to sort as the rest) stay in memory; the more memory, the fewer passes over\n");
+	printf(" the text.  st_scan searches an index file given in place of its text file.\n");
+	printf("\n");
+	printf(" With FREEZE the suffix tree is built in memory instead (on GENOMEOT_THREADS threads), frozen\n");
+	printf(" and written as it is; the index is the same.\n");
+	printf(" With GENOMEOT_HUGEPAGES, GENOMEOT_NUMA or GENOMEOT_PIN set, index memory and build threads are placed (see placement.h).\n");
+	printf(" Input files may be gzip or BGZF compressed, they are read as they are (see gz_input.h).\n");
+	printf(" Prints <index file>,<length>,<k>,<partitions>,<nodes>.\n");
+}
+
+/* builds the tree of the text in memory, freezes it and writes the index */
+int freeze_index(const char* text_file, const char* index_file, DBL_WORD k)
+{
+	FILE* file = GZ_Open(text_file);
+	unsigned char* data_buffer = NULL;
+	DBL_WORD length = 0;
+	DBL_WORD threads = ST_Threads();
+	SUFFIX_TREE* tree = NULL;
+	ST_INDEX* index = NULL;
+	int written = 0;
+
+	if (file == NULL)
+	{
+		printf("File '%s' NOT FOUND.\n", text_file);
+		return 0;
+	}
+	fseek(file, 0L, SEEK_END);
+	length = ftell(file);
+	fseek(file, 0L, SEEK_SET);
+	METRICS_Start(METRICS_READ);
+	data_buffer = (unsigned char*)malloc(length + 1);
+	if (data_buffer == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	length = fread(data_buffer, 1, length, file);
+	fclose(file);
+	METRICS_Stop(METRICS_READ);
+	if (length == 0)
+	{
+		printf("File '%s' is empty or too long to index.\n", text_file);
+		free(data_buffer);
+		return 0;
+	}
+	if (threads == 1)
+	{
+		tree = ST_CreateTree((const char*)data_buffer, length);
+	}
+	else
+	{
+		tree = ST_CreateTreeParallel((const char*)data_buffer, length, threads);
+	}
+	free(data_buffer);
+	index = ST_Freeze(tree, k);
+	ST_DeleteTree(tree);
+	if (index == NULL)
+	{
+		printf("File '%s' is not of A, C, G and T only.\n", text_file);
+		return 0;
+	}
+	written = STI_Write(index, index_file);
+	STI_Close(index);
+	return written;
+}
+
+int main(int argc, char* argv[])
+{
+	DBL_WORD memory_mb = DEFAULT_MEMORY_MB;
+	DBL_WORD k = 0;
+	int freeze = 0;
+	ST_INDEX* index = NULL;
+
+	if (argc < 3 || argc > 5)
+	{
+		Usage();
+		exit(0);
+	}
+	METRICS_Init("st_mkindex");
+	if (argc > 3)
+	{
+		freeze = strcmp(argv[3], "FREEZE") == 0;
+		memory_mb = freeze ? DEFAULT_MEMORY_MB : atol(argv[3]);
+	}
+	if (argc > 4)
+	{
+		k = atol(argv[4]);
+	}
+	if (memory_mb == 0)
+	{
+		Usage();
+		exit(0);
+	}
+	if (freeze ? !freeze_index(argv[1], argv[2], k) : !STI_Build(argv[1], argv[2], memory_mb, k))
+	{
+		exit(1);
+	}
+	index = STI_Open(argv[2]);
+	if (index == NULL)
+	{
+		exit(1);
+	}
+	printf("%s,%lu,%lu,%lu,%lu\n", argv[2], index->header->length, index->header->k,
+		index->header->number_partitions, index->header->number_nodes);
+	STI_Close(index);
+	return 0;
+}
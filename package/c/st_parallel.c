@@ -0,0 +1,473 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file st_parallel.c implementing the header file
+st_parallel.h.
+
+The tree is built the way a suffix tree is built from a suffix array and the
+common prefixes of neighbouring suffixes: the sorted suffixes are taken in
+turn with a stack of the nodes on the path to the last one, and a node is
+joined to its father when it is popped. To be the tree of Ukkonen's
+algorithm, where a node's path position is that of its first leaf and sons
+are in the order they were created, a node takes the smallest path position
+below it and sons are kept sorted by path position. Suffixes are compared
+through a ranked sample of them (st_sort.h), so a repeat of the text costs no
+more than any other string.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+#include "pthread.h"
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "placement.h"
+#include "st_sort.h"
+#include "st_parallel.h"
+
+/* From suffix_tree.c */
+#define PACKED_BASES (sizeof(DBL_WORD)*4)
+SUFFIX_TREE* create_tree(const char* str, DBL_WORD length);
+char tree_char(SUFFIX_TREE* tree, DBL_WORD i);
+DBL_WORD packed_word(const DBL_WORD* words, DBL_WORD i);
+
+/* Most bases of the bucket prefixes of a DNA string */
+#define MAX_BUCKET_BASES 8
+/* Buckets per thread, for the threads to finish together */
+#define BUCKETS_PER_THREAD 16
+/* Suffixes sorted by insertion */
+#define INSERTION_SORT 16
+
+/* A node on the stack of the path to the last suffix, and its path length */
+typedef struct STACKENTRY
+{
+   NODE*      node;
+   DBL_WORD   depth;
+} STACK_ENTRY;
+
+/* The buckets and what the threads share */
+typedef struct BUILDJOB
+{
+   SUFFIX_TREE*      tree;
+   /* The ranked sample the suffixes are compared with */
+   ST_SAMPLE*        sample;
+   /* Bases of the bucket prefixes (1 character of a string that is not DNA) */
+   DBL_WORD          k;
+   DBL_WORD          number_buckets;
+   /* The suffixes of bucket b are suffixes[starts[b]] to suffixes[starts[b + 1] - 1] */
+   DBL_WORD*         suffixes;
+   DBL_WORD*         starts;
+   DBL_WORD          largest;
+   /* Buckets from the largest, the next one to build */
+   DBL_WORD*         order;
+   DBL_WORD          next;
+   /* Threads started so far, each takes the next core when pinned */
+   DBL_WORD          workers;
+   pthread_mutex_t   lock;
+   /* The subtree of each bucket, 0 if it is empty, and its path length */
+   NODE**            roots;
+   DBL_WORD*         depths;
+   /* Nodes made by all threads */
+   DBL_WORD          nodes;
+   DBL_WORD          internal_nodes;
+} BUILD_JOB;
+
+/******************************************************************************/
+/*
+   new_node :
+   Creates a node as create_node does, without counting it (threads count
+   their nodes and add them up at the end).
+*/
+
+static NODE* new_node(DBL_WORD position, char left_char)
+{
+   NODE* node = (NODE*)malloc(sizeof(NODE));
+   if(node == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   node->sons             = 0;
+   node->right_sibling    = 0;
+   node->left_sibling     = 0;
+   node->suffix_link      = 0;
+   node->father           = 0;
+   node->path_position    = position;
+   node->edge_label_start = 0;
+   node->edge_label_end   = 0;
+   node->leaf_count       = 0;
+   node->ignore_NODE      = 0;
+   node->left_char        = left_char;
+   node->is_left_diverse  = 0;
+   return node;
+}
+
+/******************************************************************************/
+/*
+   bucket_of :
+   The bucket of the suffix at position, the number of buckets when the
+   suffix is shorter than the bucket prefixes (the $ included).
+*/
+
+static DBL_WORD bucket_of(BUILD_JOB* job, DBL_WORD position)
+{
+   SUFFIX_TREE* tree = job->tree;
+
+   if(position + job->k > tree->length)
+      return job->number_buckets;
+   if(tree->packed_string != 0)
+      return packed_word(tree->packed_string, position) & (job->number_buckets - 1);
+   return (unsigned char)tree->tree_string[position];
+}
+
+/******************************************************************************/
+/*
+   sort_suffixes :
+   Merge sorts the suffixes, all sharing their first from characters.
+*/
+
+static void sort_suffixes(const ST_SAMPLE* sample, DBL_WORD* suffixes, DBL_WORD* work, DBL_WORD count, DBL_WORD from)
+{
+   DBL_WORD i, j, m, half = count / 2, suffix;
+
+   if(count <= INSERTION_SORT)
+   {
+      for(i = 1; i < count; i++)
+      {
+         suffix = suffixes[i];
+         for(j = i; j > 0 && STS_Compare(sample, suffix, suffixes[j - 1], from, 0) < 0; j--)
+            suffixes[j] = suffixes[j - 1];
+         suffixes[j] = suffix;
+      }
+      return;
+   }
+   sort_suffixes(sample, suffixes, work, half, from);
+   sort_suffixes(sample, suffixes + half, work, count - half, from);
+   memcpy(work, suffixes, half * sizeof(DBL_WORD));
+   for(i = 0, j = half, m = 0; i < half; m++)
+   {
+      if(j < count && STS_Compare(sample, suffixes[j], work[i], from, 0) < 0)
+         suffixes[m] = suffixes[j++];
+      else
+         suffixes[m] = work[i++];
+   }
+}
+
+/******************************************************************************/
+/*
+   join_son :
+   Makes son (whose subtree is complete) a son of father, with the edge from
+   the father's path length to its own, among the sons in path position order.
+*/
+
+static void join_son(SUFFIX_TREE* tree, NODE* father, DBL_WORD father_depth, NODE* son, DBL_WORD son_depth)
+{
+   NODE* left = 0;
+   NODE* right = father->sons;
+
+   son->father           = father;
+   son->edge_label_start = son->path_position + father_depth;
+   son->edge_label_end   = son->sons == 0 ? tree->length : son->path_position + son_depth - 1;
+   if(son->path_position < father->path_position)
+      father->path_position = son->path_position;
+   while(right != 0 && right->path_position < son->path_position)
+   {
+      left  = right;
+      right = right->right_sibling;
+   }
+   son->left_sibling  = left;
+   son->right_sibling = right;
+   if(left != 0)
+      left->right_sibling = son;
+   else
+      father->sons = son;
+   if(right != 0)
+      right->left_sibling = son;
+}
+
+/******************************************************************************/
+/*
+   build_sorted :
+   Builds the tree of sorted suffixes under root (of path length 0).
+
+   Input : The sample of the text, the suffixes, sharing their first from
+           characters, and their number; subtrees already built for some of them (with their path
+           lengths) or 0 to make them leaves; a stack of count + 1 entries.
+
+   Output: The number of nodes made, of them the internal ones.
+*/
+
+static DBL_WORD build_sorted(SUFFIX_TREE* tree, const ST_SAMPLE* sample, NODE* root, const DBL_WORD* suffixes, NODE** subtrees,
+                             const DBL_WORD* depths, DBL_WORD count, DBL_WORD from, STACK_ENTRY* stack,
+                             DBL_WORD* internal_nodes)
+{
+   DBL_WORD i, top = 0, common, nodes = 0;
+   STACK_ENTRY last;
+   NODE* internal;
+
+   stack[0].node  = root;
+   stack[0].depth = 0;
+   for(i = 0; i < count; i++)
+   {
+      common = 0;
+      if(i > 0)
+         STS_Compare(sample, suffixes[i - 1], suffixes[i], from, &common);
+      while(stack[top].depth > common)
+      {
+         last = stack[top--];
+         if(stack[top].depth < common)
+         {
+            /* The last suffixes branch off inside the edge to the popped node */
+            internal = new_node(last.node->path_position, 0);
+            nodes++;
+            (*internal_nodes)++;
+            join_son(tree, internal, common, last.node, last.depth);
+            top++;
+            stack[top].node  = internal;
+            stack[top].depth = common;
+            break;
+         }
+         join_son(tree, stack[top].node, stack[top].depth, last.node, last.depth);
+      }
+      top++;
+      if(subtrees != 0 && subtrees[i] != 0)
+      {
+         stack[top].node  = subtrees[i];
+         stack[top].depth = depths[i];
+      }
+      else
+      {
+         stack[top].node  = new_node(suffixes[i], tree_char(tree, suffixes[i] - 1));
+         stack[top].depth = tree->length + 1 - suffixes[i];
+         nodes++;
+      }
+   }
+   while(top > 0)
+   {
+      last = stack[top--];
+      join_son(tree, stack[top].node, stack[top].depth, last.node, last.depth);
+   }
+   return nodes;
+}
+
+/******************************************************************************/
+/*
+   build_buckets :
+   A thread: takes the buckets in turn, largest first, and builds the subtree
+   of each under a root of its own.
+*/
+
+static void* build_buckets(void* argument)
+{
+   BUILD_JOB*     job = (BUILD_JOB*)argument;
+   SUFFIX_TREE*   tree = job->tree;
+   DBL_WORD*      work = (DBL_WORD*)malloc((job->largest / 2 + 1) * sizeof(DBL_WORD));
+   STACK_ENTRY*   stack = (STACK_ENTRY*)malloc((job->largest + 1) * sizeof(STACK_ENTRY));
+   DBL_WORD       b, count, nodes = 0, internal_nodes = 0;
+   NODE*          root;
+
+   if(work == 0 || stack == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   /* Pinned, a thread's nodes are first touched on its own NUMA node */
+   pthread_mutex_lock(&job->lock);
+   b = job->workers++;
+   pthread_mutex_unlock(&job->lock);
+   PLACEMENT_PinThread(b);
+   for(;;)
+   {
+      pthread_mutex_lock(&job->lock);
+      b = job->next < job->number_buckets ? job->order[job->next++] : job->number_buckets;
+      pthread_mutex_unlock(&job->lock);
+      if(b == job->number_buckets)
+         break;
+      count = job->starts[b + 1] - job->starts[b];
+      if(count == 0)
+         continue;
+      sort_suffixes(job->sample, job->suffixes + job->starts[b], work, count, job->k);
+      /* The subtree is the only son of a root of path length 0 */
+      root = new_node(0, 0);
+      nodes += build_sorted(tree, job->sample, root, job->suffixes + job->starts[b], 0, 0, count, job->k, stack, &internal_nodes);
+      job->roots[b]  = root->sons;
+      job->depths[b] = root->sons->sons == 0 ? tree->length + 1 - root->sons->path_position
+                     : root->sons->edge_label_end - root->sons->path_position + 1;
+      root->sons->father = 0;
+      free(root);
+   }
+   pthread_mutex_lock(&job->lock);
+   job->nodes          += nodes;
+   job->internal_nodes += internal_nodes;
+   pthread_mutex_unlock(&job->lock);
+   free(work);
+   free(stack);
+   return 0;
+}
+
+/* The job the bucket order is sorted in (qsort has no context) */
+static BUILD_JOB* sort_job;
+
+static int larger_bucket(const void* a, const void* b)
+{
+   DBL_WORD x = *(const DBL_WORD*)a, y = *(const DBL_WORD*)b;
+   DBL_WORD size_x = sort_job->starts[x + 1] - sort_job->starts[x];
+   DBL_WORD size_y = sort_job->starts[y + 1] - sort_job->starts[y];
+
+   if(size_x != size_y)
+      return size_x > size_y ? -1 : 1;
+   return x < y ? -1 : 1;
+}
+
+/******************************************************************************/
+/*
+   ST_CreateTreeParallel :
+   See st_parallel.h for description.
+*/
+
+SUFFIX_TREE* ST_CreateTreeParallel(const char* str, DBL_WORD length, DBL_WORD threads)
+{
+   SUFFIX_TREE*   tree;
+   BUILD_JOB      job;
+   pthread_t*     pool;
+   DBL_WORD       i, b, p, count, top_count;
+   DBL_WORD*      top_suffixes;
+   NODE**         top_subtrees;
+   DBL_WORD*      top_depths;
+   DBL_WORD*      work;
+   STACK_ENTRY*   stack;
+
+   if(str == 0)
+      return 0;
+   if(threads == 0)
+      threads = (DBL_WORD)sysconf(_SC_NPROCESSORS_ONLN);
+   if(threads == 0)
+      threads = 1;
+
+   METRICS_Start(METRICS_BUILD);
+   tree = create_tree(str, length);
+   tree->e = tree->length;
+   job.sample = STS_Create(tree->packed_string, tree->tree_string, tree->length - 1);
+
+   /* Enough buckets for every thread to have several */
+   job.tree = tree;
+   if(tree->packed_string != 0)
+   {
+      for(job.k = 1; job.k < MAX_BUCKET_BASES && ((DBL_WORD)1 << (2 * job.k)) < threads * BUCKETS_PER_THREAD; job.k++)
+         ;
+      job.number_buckets = (DBL_WORD)1 << (2 * job.k);
+   }
+   else
+   {
+      job.k = 1;
+      job.number_buckets = 256;
+   }
+   job.starts   = (DBL_WORD*)calloc(job.number_buckets + 3, sizeof(DBL_WORD));
+   job.order    = (DBL_WORD*)malloc(job.number_buckets * sizeof(DBL_WORD));
+   job.roots    = (NODE**)calloc(job.number_buckets, sizeof(NODE*));
+   job.depths   = (DBL_WORD*)calloc(job.number_buckets, sizeof(DBL_WORD));
+   job.suffixes = (DBL_WORD*)malloc(tree->length * sizeof(DBL_WORD));
+   pool         = (pthread_t*)malloc(threads * sizeof(pthread_t));
+   if(job.starts == 0 || job.order == 0 || job.roots == 0 || job.depths == 0 || job.suffixes == 0 || pool == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+
+   /* The suffixes by bucket, those too short for a bucket last */
+   for(p = 1; p <= tree->length; p++)
+      job.starts[bucket_of(&job, p) + 2]++;
+   job.largest = 0;
+   for(b = 0; b <= job.number_buckets; b++)
+   {
+      if(b < job.number_buckets && job.starts[b + 2] > job.largest)
+         job.largest = job.starts[b + 2];
+      job.starts[b + 2] += job.starts[b + 1];
+   }
+   for(p = 1; p <= tree->length; p++)
+      job.suffixes[job.starts[bucket_of(&job, p) + 1]++] = p;
+
+   for(b = 0; b < job.number_buckets; b++)
+      job.order[b] = b;
+   sort_job = &job;
+   qsort(job.order, job.number_buckets, sizeof(DBL_WORD), larger_bucket);
+   job.next           = 0;
+   job.workers        = 0;
+   job.nodes          = 0;
+   job.internal_nodes = 0;
+   pthread_mutex_init(&job.lock, 0);
+   for(i = 0; i < threads; i++)
+      if(pthread_create(pool + i, 0, build_buckets, &job) != 0)
+         break;
+   /* Without threads the work is done here */
+   if(i == 0)
+      build_buckets(&job);
+   while(i > 0)
+      pthread_join(pool[--i], 0);
+   pthread_mutex_destroy(&job.lock);
+
+   /* Join the subtrees and the short suffixes under the root, one suffix of
+      each subtree standing for it */
+   top_count    = job.starts[job.number_buckets + 1] - job.starts[job.number_buckets];
+   top_suffixes = (DBL_WORD*)malloc((job.number_buckets + top_count) * sizeof(DBL_WORD));
+   top_subtrees = (NODE**)malloc((job.number_buckets + top_count) * sizeof(NODE*));
+   top_depths   = (DBL_WORD*)malloc((job.number_buckets + top_count) * sizeof(DBL_WORD));
+   work         = (DBL_WORD*)malloc(((job.number_buckets + top_count) / 2 + 1) * sizeof(DBL_WORD));
+   stack        = (STACK_ENTRY*)malloc((job.number_buckets + top_count + 1) * sizeof(STACK_ENTRY));
+   if(top_suffixes == 0 || top_subtrees == 0 || top_depths == 0 || work == 0 || stack == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   count = 0;
+   for(b = 0; b < job.number_buckets; b++)
+      if(job.roots[b] != 0)
+         top_suffixes[count++] = job.roots[b]->path_position;
+   for(p = job.starts[job.number_buckets]; p < job.starts[job.number_buckets + 1]; p++)
+      top_suffixes[count++] = job.suffixes[p];
+   sort_suffixes(job.sample, top_suffixes, work, count, 0);
+   for(i = 0; i < count; i++)
+   {
+      b = bucket_of(&job, top_suffixes[i]);
+      top_subtrees[i] = b < job.number_buckets ? job.roots[b] : 0;
+      top_depths[i]   = b < job.number_buckets ? job.depths[b] : 0;
+   }
+   job.nodes += build_sorted(tree, job.sample, tree->root, top_suffixes, top_subtrees, top_depths, count, 0, stack,
+                             &job.internal_nodes);
+   METRICS_Stop(METRICS_BUILD);
+   metrics.trees++;
+   metrics.symbols += tree->length;
+   metrics.nodes   += job.nodes;
+   metrics.splits  += job.internal_nodes;
+   metrics.bytes   += job.nodes * sizeof(NODE);
+
+   STS_Delete(job.sample);
+   free(job.starts);
+   free(job.order);
+   free(job.roots);
+   free(job.depths);
+   free(job.suffixes);
+   free(pool);
+   free(top_suffixes);
+   free(top_subtrees);
+   free(top_depths);
+   free(work);
+   free(stack);
+   return tree;
+}
+
+/******************************************************************************/
+/*
+   ST_Threads :
+   See st_parallel.h for description.
+*/
+
+DBL_WORD ST_Threads(void)
+{
+   const char* threads = getenv("GENOMEOT_THREADS");
+
+   if(threads == 0 || threads[0] == 0)
+      return 1;
+   return (DBL_WORD)atol(threads);
+}
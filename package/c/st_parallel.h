@@ -0,0 +1,42 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file st_parallel.h for building a suffix tree on
+several cores. Ukkonen's algorithm (ST_CreateTree) adds one suffix after the
+other; here the suffixes are split into buckets by their first k bases (4^k
+buckets for DNA, one per first character otherwise), the subtree of each
+bucket is built from its sorted suffixes by a pool of threads, and the
+subtrees are then joined under the root with the suffixes shorter than k.
+
+The tree is the one ST_CreateTree builds: the same nodes, edges, path
+positions and order of sons, so every search finds the same position. It has
+no suffix links, which only construction and the DAWG counts of centromere
+use.
+
+Include suffix_tree.h before this file.
+*******************************************************************************/
+
+/******************************************************************************/
+/*
+   ST_CreateTreeParallel :
+   Builds the tree of a string with a pool of threads.
+
+   Input : The source string and its length, as ST_CreateTree, and the number
+           of threads (0 for one per core).
+
+   Output: A pointer to the newly created tree, as ST_CreateTree.
+*/
+
+SUFFIX_TREE* ST_CreateTreeParallel(const char* str, DBL_WORD length, DBL_WORD threads);
+
+/******************************************************************************/
+/*
+   ST_Threads :
+   The threads a tool builds its trees with, from the environment:
+
+      GENOMEOT_THREADS=<n>   n threads, 0 for one per core
+
+   Output: The number of threads for ST_CreateTreeParallel, 1 when it is not
+           set (then ST_CreateTree is the one to use).
+*/
+
+DBL_WORD ST_Threads(void);
@@ -0,0 +1,133 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file st_protocol.c implementing the header file
+st_protocol.h.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "errno.h"
+#include "unistd.h"
+#include "sys/types.h"
+#include "sys/socket.h"
+#include "sys/un.h"
+#include "suffix_tree.h"
+#include "st_protocol.h"
+
+/******************************************************************************/
+/*
+   STP_Read :
+   See st_protocol.h for description.
+*/
+
+int STP_Read(int socket, void* buffer, DBL_WORD length)
+{
+   ssize_t done;
+
+   while(length > 0)
+   {
+      done = read(socket, buffer, length);
+      if(done < 0 && errno == EINTR)
+         continue;
+      if(done <= 0)
+         return 0;
+      buffer  = (char*)buffer + done;
+      length -= done;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   STP_Write :
+   See st_protocol.h for description.
+*/
+
+int STP_Write(int socket, const void* buffer, DBL_WORD length)
+{
+   ssize_t done;
+
+   while(length > 0)
+   {
+      done = write(socket, buffer, length);
+      if(done < 0 && errno == EINTR)
+         continue;
+      if(done <= 0)
+         return 0;
+      buffer  = (const char*)buffer + done;
+      length -= done;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   STP_Connect :
+   See st_protocol.h for description.
+*/
+
+int STP_Connect(const char* socket_path)
+{
+   struct sockaddr_un address;
+   int s;
+
+   if(strlen(socket_path) >= sizeof(address.sun_path))
+   {
+      printf("Socket path '%s' is too long.\n", socket_path);
+      return -1;
+   }
+   s = socket(AF_UNIX, SOCK_STREAM, 0);
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   strcpy(address.sun_path, socket_path);
+   if(s < 0 || connect(s, (struct sockaddr*)&address, sizeof(address)) != 0)
+   {
+      printf("Could not connect to '%s'.\n", socket_path);
+      if(s >= 0)
+         close(s);
+      return -1;
+   }
+   return s;
+}
+
+/******************************************************************************/
+/*
+   STP_Request :
+   See st_protocol.h for description.
+*/
+
+int STP_Request(int socket, unsigned int type, const char* name, unsigned int item_length, DBL_WORD count,
+                const void* payload, DBL_WORD payload_length, STP_RESPONSE* response, char** answer)
+{
+   STP_REQUEST request;
+
+   *answer = 0;
+   request.magic          = STP_MAGIC;
+   request.type           = type;
+   request.name_length    = name != 0 ? (unsigned int)strlen(name) : 0;
+   request.item_length    = item_length;
+   request.count          = count;
+   request.payload_length = payload_length;
+   if(!STP_Write(socket, &request, sizeof(request)) || !STP_Write(socket, name, request.name_length)
+      || !STP_Write(socket, payload, payload_length) || !STP_Read(socket, response, sizeof(STP_RESPONSE))
+      || response->magic != STP_MAGIC)
+      return 0;
+   if(response->payload_length == 0)
+      return 1;
+   *answer = (char*)malloc(response->payload_length + 1);
+   if(*answer == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   (*answer)[response->payload_length] = 0;
+   if(!STP_Read(socket, *answer, response->payload_length))
+   {
+      free(*answer);
+      *answer = 0;
+      return 0;
+   }
+   return 1;
+}
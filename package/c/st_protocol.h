@@ -0,0 +1,103 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file st_protocol.h for the binary protocol between
+st_server, which keeps indices resident, and its clients (st_client). A
+client connects to the server's Unix domain socket and sends any number of
+requests, each answered in turn:
+
+   request    STP_REQUEST, the index name (name_length bytes: the path of a
+              text or index file, as the server sees it), the payload
+   response   STP_RESPONSE, the payload
+
+All fields are in the byte order of the host, the socket being local.
+
+   STP_FIND         payload: count strings of item_length (not 0)
+                             characters
+                    answer:  count DBL_WORDs, the position (from 1) of each
+                             string as ST_FindSubstring, 0 if absent
+   STP_OCCURRENCES  payload: one string
+                    answer:  its positions in increasing order, at most
+                             count of them (0 for all); the response count
+                             is the number of occurrences there are
+   STP_SCAN         payload: a sequence scanned by windows of item_length
+                             (not 0), count 0
+                    answer:  4 DBL_WORDs, forward, backward, found and not
+                             found windows, as a line of st_scan
+   STP_LOAD         no payload, loads or builds the index, answer empty
+   STP_STATUS       no name, no payload, answer: one line of text per
+                    resident index
+
+A failed request is answered with STP_ERROR and a message as the payload,
+as is a load when all of the server's index slots are being searched.
+*******************************************************************************/
+
+#define STP_MAGIC        0x31505453U
+#define STP_FIND         1
+#define STP_OCCURRENCES  2
+#define STP_SCAN         3
+#define STP_LOAD         4
+#define STP_STATUS       5
+
+#define STP_OK           0
+#define STP_ERROR        1
+
+/* Longest index name and largest payload accepted */
+#define STP_MAX_NAME     4096
+#define STP_MAX_PAYLOAD  ((DBL_WORD)1 << 32)
+
+typedef struct STPREQUEST
+{
+   unsigned int   magic;
+   unsigned int   type;
+   unsigned int   name_length;
+   /* Length of each string (STP_FIND) or window (STP_SCAN) */
+   unsigned int   item_length;
+   DBL_WORD       count;
+   DBL_WORD       payload_length;
+} STP_REQUEST;
+
+typedef struct STPRESPONSE
+{
+   unsigned int   magic;
+   unsigned int   status;
+   DBL_WORD       count;
+   DBL_WORD       payload_length;
+} STP_RESPONSE;
+
+/******************************************************************************/
+/*
+   STP_Read, STP_Write :
+   Read or write all of a buffer on a socket, through short transfers and
+   interrupted calls.
+
+   Output: 1 on success, 0 if the connection closed or failed.
+*/
+
+int STP_Read(int socket, void* buffer, DBL_WORD length);
+int STP_Write(int socket, const void* buffer, DBL_WORD length);
+
+/******************************************************************************/
+/*
+   STP_Connect :
+   Connects to the socket of a server.
+
+   Output: The socket, -1 on an error (which is printed).
+*/
+
+int STP_Connect(const char* socket_path);
+
+/******************************************************************************/
+/*
+   STP_Request :
+   Sends a request and reads its response.
+
+   Input : The socket, the request type, the index name (0 for none), the
+           item length, the count, the payload and its length, the response
+           to fill in and its payload (allocated, to free; 0 if empty).
+
+   Output: 1 on success (the response status tells whether the request
+           succeeded), 0 if the connection failed.
+*/
+
+int STP_Request(int socket, unsigned int type, const char* name, unsigned int item_length, DBL_WORD count,
+                const void* payload, DBL_WORD payload_length, STP_RESPONSE* response, char** answer);
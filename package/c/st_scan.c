@@ -1,7 +1,14 @@
 #include "suffix_tree.h"
+#include "metrics.h"
+#include "st_index.h"
+#include "st_parallel.h"
+#include "placement.h"
+#include "gz_input.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 
 /* constants related to command line parameter values */
 #define NO_DEPTH_LIMIT -1
@@ -12,9 +19,18 @@
 
 void Usage()
 {
-	printf("Usage: st_scan <suffix tree file name> <file to scan> <scan size>\n");
+	printf("Usage: st_scan <suffix tree file name> <file to scan>[,<file to scan>...]|@<manifest> <scan size>\n");
 	printf("\n");
 	printf(" <scan size> is a fixed window size to check against suffix tree\n");
+	printf(" Several files to scan, comma separated or one per line of a <manifest> file, are all scanned\n");
+	printf(" against the one tree, on GENOMEOT_THREADS threads, with one line per file in their order.\n");
+	printf(" <suffix tree file name> may be an index made by st_mkindex, it is then searched in place\n");
+	printf(" instead of building the tree.\n");
+	printf(" With GENOMEOT_THREADS=<n> set, the tree is built on <n> threads (0 for every core).\n");
+	printf(" With GENOMEOT_JUMP_K=<k> set, lookups start from a table of the 4^k strings of <k> bases.\n");
+	printf(" With GENOMEOT_FREEZE=1 set, a DNA tree is frozen into a compact search-only index once built.\n");
+	printf(" With GENOMEOT_HUGEPAGES, GENOMEOT_NUMA or GENOMEOT_PIN set, index memory and the build and query threads are placed (see placement.h).\n");
+	printf(" Input files may be gzip or BGZF compressed, they are read as they are (see gz_input.h).\n");
 }
 
 char rc( char cval )
@@ -93,25 +109,193 @@ void generate_leaf_counts( NODE* node )
 
 
 
+/* searches the index if there is one, the tree if not */
+DBL_WORD find_window( SUFFIX_TREE* tree, ST_INDEX* index, char* window, DBL_WORD window_size )
+{
+	if (index != NULL)
+	{
+		return STI_FindSubstring( index, window, window_size );
+	}
+	return ST_FindSubstring( tree, window, window_size );
+}
+
+/* one file to scan and its counts */
+typedef struct SCANFILE
+{
+	char* name;
+	int found;
+	int forwardCount;
+	int backwardCount;
+	int foundCount;
+	int notFoundCount;
+} SCAN_FILE;
+
+/* the files of a run, the index or tree they are all scanned against, and the next file to take */
+typedef struct SCANJOB
+{
+	SUFFIX_TREE* tree;
+	ST_INDEX* index;
+	DBL_WORD window_size;
+	SCAN_FILE* files;
+	int number_files;
+	int next;
+	/* threads started, numbering them for their cores */
+	int started;
+	pthread_mutex_t lock;
+} SCAN_JOB;
+
+/* counts the forward and reverse matches of each window of a file, the tree or index is only read */
+void scan_file( SUFFIX_TREE* tree, ST_INDEX* index, DBL_WORD window_size, SCAN_FILE* scan )
+{
+	FILE* fileToScan = GZ_Open(scan->name);
+	char* scan_buffer = NULL;
+	int found = 0;
+
+	scan->found = fileToScan != NULL;
+	if (fileToScan == NULL)
+	{
+		return;
+	}
+	scan_buffer = (char*)malloc( window_size + 1 );
+	while (fread( scan_buffer, window_size, 1, fileToScan ) == 1) 
+	{
+		found = 0;
+
+		if (find_window( tree, index, scan_buffer, window_size ) != ST_ERROR)
+		{
+			scan->forwardCount++;
+			found = 1;
+		}
+		reverse_complement( scan_buffer, window_size );
+
+		if (find_window( tree, index, scan_buffer, window_size ) != ST_ERROR)
+		{
+			scan->backwardCount++;
+			found = 1;
+		}
+		if (found) 
+		{
+			scan->foundCount++;
+		}
+		else
+		{
+			scan->notFoundCount++;
+		}
+	}
+	fclose( fileToScan );
+	free( scan_buffer );
+}
+
+/* a thread: takes the files in turn until there are none left */
+void* scan_files( void* argument )
+{
+	SCAN_JOB* job = (SCAN_JOB*)argument;
+	METRICS_COUNTERS counters;
+	int i = 0;
+
+	pthread_mutex_lock( &job->lock );
+	i = job->started++;
+	pthread_mutex_unlock( &job->lock );
+	PLACEMENT_PinThread( i );
+	/* the lookups of the threads are counted apart and added up by file */
+	METRICS_ThreadCounters( &counters );
+	for (;;)
+	{
+		pthread_mutex_lock( &job->lock );
+		i = job->next++;
+		pthread_mutex_unlock( &job->lock );
+		if (i >= job->number_files)
+		{
+			break;
+		}
+		scan_file( job->tree, job->index, job->window_size, job->files + i );
+		METRICS_AddCounters();
+	}
+	METRICS_ThreadCounters( NULL );
+	return NULL;
+}
+
+/* the files to scan: a comma separated list, or the lines of the manifest after an '@' */
+int read_scan_files( char* list, SCAN_FILE** files )
+{
+	FILE* manifest = NULL;
+	char line[4096];
+	char* name = NULL;
+	int number_files = 0;
+	int allocated = 0;
+
+	if (list[0] == '@')
+	{
+		manifest = fopen(list + 1, "r");
+		if (manifest == NULL)
+		{
+			printf("File '%s' NOT FOUND.\n", list + 1);
+			exit(0);
+		}
+	}
+	for (;;)
+	{
+		if (manifest != NULL)
+		{
+			if (fgets(line, sizeof(line), manifest) == NULL)
+			{
+				break;
+			}
+			line[strcspn(line, "\r\n")] = 0;
+			if (line[0] == 0 || line[0] == '#')
+			{
+				continue;
+			}
+			name = line;
+		}
+		else
+		{
+			name = strtok(number_files == 0 ? list : NULL, ",");
+			if (name == NULL)
+			{
+				break;
+			}
+		}
+		if (number_files == allocated)
+		{
+			allocated = allocated == 0 ? 16 : allocated*2;
+			*files = (SCAN_FILE*)realloc(*files, allocated*sizeof(SCAN_FILE));
+			if (*files == NULL)
+			{
+				printf("\nOut of memory.\n");
+				exit(0);
+			}
+		}
+		memset(*files + number_files, 0, sizeof(SCAN_FILE));
+		(*files)[number_files].name = (char*)malloc(strlen(name) + 1);
+		strcpy((*files)[number_files].name, name);
+		number_files++;
+	}
+	if (manifest != NULL)
+	{
+		fclose( manifest );
+	}
+	return number_files;
+}
+
 int main(int argc, char* argv[])
 {
 	/* command line parameters */
 	unsigned char* st_file_name = NULL;
 	DBL_WORD st_file_size = 0;
-	unsigned char* scan_file_name = NULL;
-	char* scan_buffer = NULL;
 	DBL_WORD window_size = 0;
-	DBL_WORD position = 0;
-	int foundCount = 0;
-	int notFoundCount = 0;
-	int found = 0;
-	int forwardCount = 0;
-	int backwardCount = 0;
+	DBL_WORD threads = ST_Threads();
+	DBL_WORD workers = 0;
+	SCAN_FILE* files = NULL;
+	SCAN_JOB job;
+	pthread_t* pool = NULL;
+	int number_files = 0;
+	int i = 0;
 
 	/* internal data */
 	SUFFIX_TREE* tree = NULL;
+	ST_INDEX* index = NULL;
 	FILE* file = NULL;
-	FILE* fileToScan = NULL;
 	unsigned char* data_buffer = NULL;
 
 	/* Set up parameters, validate */
@@ -120,62 +304,126 @@ int main(int argc, char* argv[])
 		Usage();
 		exit(0);
 	}
+	METRICS_Init("st_scan");
 	st_file_name = argv[1];
-	scan_file_name = argv[2];
 	window_size = atol(argv[3]);
+	number_files = read_scan_files(argv[2], &files);
 
 
-	file = fopen((const char*)st_file_name, "r");
-	if (file == NULL)
+	if (STI_IsIndex((const char*)st_file_name))
 	{
-		printf("File '%s' NOT FOUND.\n", st_file_name);
-		exit(0);
+		METRICS_Start(METRICS_READ);
+		index = STI_Open((const char*)st_file_name);
+		METRICS_Stop(METRICS_READ);
+		if (index == NULL)
+		{
+			exit(0);
+		}
+		/* ST_ERROR is only set when a tree is created */
+		ST_ERROR = STI_ERROR;
 	}
-	fseek(file, 0L, SEEK_END);
-	st_file_size = ftell( file );
-	fseek( file, 0L, SEEK_SET );
+	else
+	{
+		file = GZ_Open((const char*)st_file_name);
+		if (file == NULL)
+		{
+			printf("File '%s' NOT FOUND.\n", st_file_name);
+			exit(0);
+		}
+		fseek(file, 0L, SEEK_END);
+		st_file_size = ftell( file );
+		fseek( file, 0L, SEEK_SET );
 
-	data_buffer = (unsigned char*)malloc(st_file_size*sizeof(unsigned char));
-	fread( data_buffer, st_file_size, 1, file );
-        fclose( file );
-	tree = ST_CreateTree((const char*)data_buffer, st_file_size);
+		METRICS_Start(METRICS_READ);
+		data_buffer = (unsigned char*)malloc(st_file_size*sizeof(unsigned char));
+		fread( data_buffer, st_file_size, 1, file );
+	        fclose( file );
+		METRICS_Stop(METRICS_READ);
+		if (threads == 1)
+		{
+			tree = ST_CreateTree((const char*)data_buffer, st_file_size);
+		}
+		else
+		{
+			tree = ST_CreateTreeParallel((const char*)data_buffer, st_file_size, threads);
+		}
+		if (STI_Frozen() && (index = ST_Freeze(tree, 0)) != NULL)
+		{
+			ST_DeleteTree(tree);
+			tree = NULL;
+			ST_ERROR = STI_ERROR;
+		}
+		else
+		{
+			ST_BuildJumpTable(tree, ST_JumpK());
+		}
+	}
 
-	/* from here, read sections of the file to scan, count the number of forward and
-         * reverse matches.
+	/* from here, scan the files against the one tree or index, each window forward and
+         * reverse complemented, a pool of threads taking the files in turn.
          *
-         * when scanning is done, print the results as "forward,backward"
+         * when scanning is done, print the results of each file in order as "forward,backward"
          */
- 
-        fileToScan = fopen(scan_file_name, "r");
-	scan_buffer = (char*)malloc( window_size + 1 );
-	while (fread( scan_buffer, window_size, 1, fileToScan ) == 1) 
+	workers = threads == 0 ? (DBL_WORD)sysconf(_SC_NPROCESSORS_ONLN) : threads;
+	if (workers > (DBL_WORD)number_files)
 	{
-		found = 0;
-
-		if ((position = ST_FindSubstring( tree, scan_buffer, window_size )) != ST_ERROR)
+		workers = number_files;
+	}
+	job.tree = tree;
+	job.index = index;
+	job.window_size = window_size;
+	job.files = files;
+	job.number_files = number_files;
+	job.next = 0;
+	job.started = 0;
+	pthread_mutex_init( &job.lock, NULL );
+	METRICS_Start(METRICS_QUERY);
+	if (workers > 1)
+	{
+		pool = (pthread_t*)malloc(workers*sizeof(pthread_t));
+		for (i = 0; i < (int)workers; i++)
 		{
-			forwardCount++;
-			found = 1;
+			if (pthread_create( pool + i, NULL, scan_files, &job ) != 0)
+			{
+				break;
+			}
 		}
-		reverse_complement( scan_buffer, window_size );
-
-		if ((position = ST_FindSubstring( tree, scan_buffer, window_size )) != ST_ERROR)
+		/* without threads the files are scanned here */
+		if (i == 0)
 		{
-			backwardCount++;
-			found = 1;
+			scan_files( &job );
 		}
-		if (found) 
+		while (i > 0)
 		{
-			foundCount++;
+			pthread_join( pool[--i], NULL );
+		}
+		free( pool );
+	}
+	else
+	{
+		scan_files( &job );
+	}
+	METRICS_Stop(METRICS_QUERY);
+	pthread_mutex_destroy( &job.lock );
+	for (i = 0; i < number_files; i++)
+	{
+		if (files[i].found)
+		{
+			printf("%s,%s,%d,%d,%d,%d\n", st_file_name, files[i].name, files[i].forwardCount, files[i].backwardCount,
+				files[i].foundCount, files[i].notFoundCount);
 		}
 		else
 		{
-			notFoundCount++;
+			printf("File '%s' NOT FOUND.\n", files[i].name);
 		}
+		free( files[i].name );
 	}
-	fclose( fileToScan );
-	printf("%s,%s,%d,%d,%d,%d\n", st_file_name, scan_file_name, forwardCount, backwardCount, foundCount, notFoundCount);
 
+	free( files );
 	free( data_buffer );
+	if (index != NULL)
+	{
+		STI_Close( index );
+	}
 	return 0;
 }
@@ -0,0 +1,504 @@
+#define _POSIX_C_SOURCE 200809L
+#include "suffix_tree.h"
+#include "metrics.h"
+#include "st_index.h"
+#include "st_parallel.h"
+#include "st_protocol.h"
+#include "placement.h"
+#include "gz_input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* memory budget of the resident indices when none is given, in MB */
+#define DEFAULT_MEMORY_MB 4096
+/* most indices resident at a time */
+#define MAX_INDICES 64
+
+void Usage()
+{
+	printf("Usage: st_server <socket path> [<memory MB>]\n");
+	printf("\n");
+	printf(" Serves suffix index lookups on the Unix domain socket <socket path> until killed (see\n");
+	printf(" st_protocol.h, and st_client).  An index is named by the path of its file as the server sees\n");
+	printf(" it: an index made by st_mkindex is loaded, a text (A, C, G and T only) has its tree built\n");
+	printf(" (on GENOMEOT_THREADS threads) and frozen.  Each is loaded once, on the first request that\n");
+	printf(" names it, and kept while the resident indices fit in <memory MB> (default %d); the least\n", DEFAULT_MEMORY_MB);
+	printf(" recently used ones not being searched are dropped to make room.\n");
+	printf(" Each connection is served by a thread of its own, and all search the same indices.\n");
+	printf(" With GENOMEOT_HUGEPAGES, GENOMEOT_NUMA or GENOMEOT_PIN set, index memory and the build and query threads are placed (see placement.h).\n");
+	printf(" Input files may be gzip or BGZF compressed, they are read as they are (see gz_input.h).\n");
+}
+
+/* a resident index */
+typedef struct
+{
+	char* name;
+	ST_INDEX* index;
+	/* requests searching it now, it is not dropped while there are any */
+	int users;
+	/* the use count of its last request, the lowest is the least recently used */
+	DBL_WORD last_used;
+} RESIDENT;
+
+RESIDENT residents[MAX_INDICES];
+int number_residents = 0;
+DBL_WORD resident_bytes = 0;
+DBL_WORD memory_budget = 0;
+DBL_WORD use_count = 0;
+/* guards the residents; loads take load_lock as well, one at a time, so an index is loaded once */
+pthread_mutex_t resident_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t load_lock = PTHREAD_MUTEX_INITIALIZER;
+/* connections accepted, each thread pinned to the next core */
+unsigned long connections = 0;
+
+/* the resident index of a name, -1 if it is not loaded; under resident_lock */
+int find_resident( const char* name )
+{
+	int i = 0;
+
+	for (i = 0; i < number_residents; i++)
+	{
+		if (strcmp(residents[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* drops the least recently used indices nobody searches until <bytes> more fit the budget; under resident_lock */
+void make_room( DBL_WORD bytes )
+{
+	int i = 0;
+	int oldest = 0;
+
+	while (resident_bytes + bytes > memory_budget || number_residents == MAX_INDICES)
+	{
+		oldest = -1;
+		for (i = 0; i < number_residents; i++)
+		{
+			if (residents[i].users == 0 && (oldest < 0 || residents[i].last_used < residents[oldest].last_used))
+			{
+				oldest = i;
+			}
+		}
+		if (oldest < 0)
+		{
+			/* all are in use, the budget is exceeded until they are done */
+			return;
+		}
+		fprintf(stderr, "st_server: dropped %s\n", residents[oldest].name);
+		resident_bytes -= residents[oldest].index->map_size;
+		STI_Close( residents[oldest].index );
+		free( residents[oldest].name );
+		residents[oldest] = residents[--number_residents];
+	}
+}
+
+/* builds and freezes the index of a text file, 0 with the error in <error> */
+ST_INDEX* build_index( const char* name, char* error, size_t error_size )
+{
+	FILE* file = GZ_Open(name);
+	char* data_buffer = NULL;
+	DBL_WORD length = 0;
+	DBL_WORD threads = ST_Threads();
+	SUFFIX_TREE* tree = NULL;
+	ST_INDEX* index = NULL;
+
+	if (file == NULL)
+	{
+		snprintf(error, error_size, "File '%s' NOT FOUND.", name);
+		return NULL;
+	}
+	fseek(file, 0L, SEEK_END);
+	length = ftell(file);
+	fseek(file, 0L, SEEK_SET);
+	data_buffer = (char*)malloc(length + 1);
+	if (data_buffer == NULL)
+	{
+		fclose(file);
+		snprintf(error, error_size, "Out of memory.");
+		return NULL;
+	}
+	length = fread(data_buffer, 1, length, file);
+	fclose(file);
+	if (length == 0)
+	{
+		free(data_buffer);
+		snprintf(error, error_size, "File '%s' is empty.", name);
+		return NULL;
+	}
+	if (threads == 1)
+	{
+		tree = ST_CreateTree(data_buffer, length);
+	}
+	else
+	{
+		tree = ST_CreateTreeParallel(data_buffer, length, threads);
+	}
+	free(data_buffer);
+	index = ST_Freeze(tree, 0);
+	ST_DeleteTree(tree);
+	if (index == NULL)
+	{
+		snprintf(error, error_size, "File '%s' is not of A, C, G and T only.", name);
+	}
+	return index;
+}
+
+/* marks a resident index used by one more request; under resident_lock */
+ST_INDEX* use_resident( int i )
+{
+	residents[i].users++;
+	residents[i].last_used = ++use_count;
+	return residents[i].index;
+}
+
+/* the index of a name, loaded or built if it is not resident; release it when done. NULL with the error in <error> */
+ST_INDEX* use_index( const char* name, char* error, size_t error_size )
+{
+	ST_INDEX* index = NULL;
+	int i = 0;
+
+	pthread_mutex_lock( &resident_lock );
+	i = find_resident(name);
+	if (i >= 0)
+	{
+		index = use_resident(i);
+		pthread_mutex_unlock( &resident_lock );
+		return index;
+	}
+	pthread_mutex_unlock( &resident_lock );
+
+	pthread_mutex_lock( &load_lock );
+	/* another request may have loaded it meanwhile */
+	pthread_mutex_lock( &resident_lock );
+	i = find_resident(name);
+	if (i >= 0)
+	{
+		index = use_resident(i);
+	}
+	pthread_mutex_unlock( &resident_lock );
+	if (index == NULL)
+	{
+		if (STI_IsIndex(name))
+		{
+			index = STI_Open(name);
+			if (index == NULL)
+			{
+				snprintf(error, error_size, "Index '%s' could not be opened.", name);
+			}
+		}
+		else
+		{
+			index = build_index(name, error, error_size);
+		}
+		if (index != NULL)
+		{
+			pthread_mutex_lock( &resident_lock );
+			make_room( index->map_size );
+			if (number_residents == MAX_INDICES)
+			{
+				/* every slot is searched now, nothing can be dropped for it */
+				pthread_mutex_unlock( &resident_lock );
+				pthread_mutex_unlock( &load_lock );
+				STI_Close( index );
+				snprintf(error, error_size, "Too many indices in use, '%s' is not loaded.", name);
+				return NULL;
+			}
+			i = number_residents++;
+			residents[i].name = (char*)malloc(strlen(name) + 1);
+			strcpy(residents[i].name, name);
+			residents[i].index = index;
+			residents[i].users = 0;
+			resident_bytes += index->map_size;
+			use_resident(i);
+			pthread_mutex_unlock( &resident_lock );
+			fprintf(stderr, "st_server: loaded %s, %lu bytes\n", name, index->map_size);
+		}
+	}
+	pthread_mutex_unlock( &load_lock );
+	return index;
+}
+
+/* ends the use of an index by a request */
+void release_index( ST_INDEX* index )
+{
+	int i = 0;
+
+	pthread_mutex_lock( &resident_lock );
+	for (i = 0; i < number_residents; i++)
+	{
+		if (residents[i].index == index)
+		{
+			residents[i].users--;
+		}
+	}
+	pthread_mutex_unlock( &resident_lock );
+}
+
+char complement( char cval )
+{
+	if (cval == 'A') return 'T';
+	else if (cval == 'C') return 'G';
+	else if (cval == 'G') return 'C';
+	else if (cval == 'T') return 'A';
+	return 'x';
+}
+
+/* the counts of st_scan for the windows of a sequence: forward, backward, found, not found */
+void scan_windows( ST_INDEX* index, const char* sequence, DBL_WORD length, DBL_WORD window_size, DBL_WORD* counts, char* window )
+{
+	DBL_WORD start = 0;
+	DBL_WORD i = 0;
+	int found = 0;
+
+	for (start = 0; window_size > 0 && start + window_size <= length; start += window_size)
+	{
+		found = 0;
+		if (STI_FindSubstring(index, sequence + start, window_size) != STI_ERROR)
+		{
+			counts[0]++;
+			found = 1;
+		}
+		for (i = 0; i < window_size; i++)
+		{
+			window[i] = complement(sequence[start + window_size - 1 - i]);
+		}
+		if (STI_FindSubstring(index, window, window_size) != STI_ERROR)
+		{
+			counts[1]++;
+			found = 1;
+		}
+		counts[found ? 2 : 3]++;
+	}
+}
+
+/* writes a response, an error if <error> is set */
+int respond( int s, const char* error, DBL_WORD count, const void* payload, DBL_WORD payload_length )
+{
+	STP_RESPONSE response;
+
+	response.magic = STP_MAGIC;
+	response.status = error != NULL ? STP_ERROR : STP_OK;
+	response.count = error != NULL ? 0 : count;
+	response.payload_length = error != NULL ? strlen(error) : payload_length;
+	return STP_Write(s, &response, sizeof(response)) && STP_Write(s, error != NULL ? error : payload, response.payload_length);
+}
+
+/* the text of STP_STATUS, a line per resident index: name,bytes,users,last used */
+char* status_text( DBL_WORD* length )
+{
+	char* text = NULL;
+	DBL_WORD size = 128;
+	int i = 0;
+
+	pthread_mutex_lock( &resident_lock );
+	for (i = 0; i < number_residents; i++)
+	{
+		size += strlen(residents[i].name) + 80;
+	}
+	text = (char*)malloc(size);
+	if (text == NULL)
+	{
+		printf("\nOut of memory.\n");
+		exit(0);
+	}
+	*length = 0;
+	for (i = 0; i < number_residents; i++)
+	{
+		*length += sprintf(text + *length, "%s,%lu,%d,%lu\n", residents[i].name, residents[i].index->map_size,
+			residents[i].users, residents[i].last_used);
+	}
+	*length += sprintf(text + *length, "total,%lu,%lu\n", resident_bytes, memory_budget);
+	pthread_mutex_unlock( &resident_lock );
+	return text;
+}
+
+/* answers one request, 0 when the connection is to be closed */
+int serve_request( int s, STP_REQUEST* request, char* name, char* payload )
+{
+	char error[STP_MAX_NAME + 128];
+	ST_INDEX* index = NULL;
+	DBL_WORD* answer = NULL;
+	DBL_WORD counts[4] = { 0, 0, 0, 0 };
+	DBL_WORD count = 0;
+	DBL_WORD i = 0;
+	char* text = NULL;
+	char* window = NULL;
+	int ok = 0;
+
+	if (request->type == STP_STATUS)
+	{
+		text = status_text(&count);
+		ok = respond(s, NULL, 0, text, count);
+		free(text);
+		return ok;
+	}
+	if (request->type < STP_FIND || request->type > STP_LOAD)
+	{
+		return respond(s, "Unknown request.", 0, NULL, 0);
+	}
+	/* sizes are checked by division, their products could overflow */
+	if ((request->type == STP_FIND || request->type == STP_SCAN) && request->item_length == 0)
+	{
+		return respond(s, "The string length is 0.", 0, NULL, 0);
+	}
+	if (request->type == STP_FIND && (request->count > request->payload_length / request->item_length ||
+		request->count * request->item_length != request->payload_length))
+	{
+		return respond(s, "The strings are not all of the given length.", 0, NULL, 0);
+	}
+	if (request->type == STP_SCAN && request->count != 0)
+	{
+		return respond(s, "A scan has no count.", 0, NULL, 0);
+	}
+	index = use_index(name, error, sizeof(error));
+	if (index == NULL)
+	{
+		return respond(s, error, 0, NULL, 0);
+	}
+	switch (request->type)
+	{
+	case STP_FIND:
+		answer = (DBL_WORD*)malloc((request->count + 1)*sizeof(DBL_WORD));
+		if (answer == NULL)
+		{
+			ok = respond(s, "Out of memory.", 0, NULL, 0);
+			break;
+		}
+		for (i = 0; i < request->count; i++)
+		{
+			answer[i] = STI_FindSubstring(index, payload + i*request->item_length, request->item_length);
+		}
+		ok = respond(s, NULL, request->count, answer, request->count*sizeof(DBL_WORD));
+		break;
+	case STP_OCCURRENCES:
+		count = STI_FindAll(index, payload, request->payload_length, &answer);
+		/* the positions sent are those found, at most count of them */
+		i = request->count > 0 && request->count < count ? request->count : count;
+		ok = respond(s, NULL, count, answer, i*sizeof(DBL_WORD));
+		break;
+	case STP_SCAN:
+		if (request->item_length > request->payload_length)
+		{
+			/* no window fits the sequence */
+			ok = respond(s, NULL, 4, counts, sizeof(counts));
+			break;
+		}
+		window = (char*)malloc(request->item_length + 1);
+		if (window == NULL)
+		{
+			ok = respond(s, "Out of memory.", 0, NULL, 0);
+			break;
+		}
+		scan_windows(index, payload, request->payload_length, request->item_length, counts, window);
+		ok = respond(s, NULL, 4, counts, sizeof(counts));
+		break;
+	default:
+		ok = respond(s, NULL, 0, NULL, 0);
+		break;
+	}
+	release_index(index);
+	free(answer);
+	free(window);
+	return ok;
+}
+
+/* a thread: answers the requests of one connection until it closes */
+void* serve_connection( void* argument )
+{
+	int s = (int)(long)argument;
+	STP_REQUEST request;
+	char name[STP_MAX_NAME + 1];
+	char* payload = NULL;
+	METRICS_COUNTERS counters;
+
+	PLACEMENT_PinThread( __atomic_fetch_add(&connections, 1, __ATOMIC_RELAXED) );
+	/* the lookups of the connections are counted apart and added up by request */
+	METRICS_ThreadCounters( &counters );
+	while (STP_Read(s, &request, sizeof(request)))
+	{
+		if (request.magic != STP_MAGIC || request.name_length > STP_MAX_NAME || request.payload_length > STP_MAX_PAYLOAD)
+		{
+			respond(s, "Bad request.", 0, NULL, 0);
+			break;
+		}
+		payload = (char*)malloc(request.payload_length + 1);
+		if (payload == NULL)
+		{
+			respond(s, "Out of memory.", 0, NULL, 0);
+			break;
+		}
+		if (!STP_Read(s, name, request.name_length) || !STP_Read(s, payload, request.payload_length))
+		{
+			break;
+		}
+		name[request.name_length] = 0;
+		if (!serve_request(s, &request, name, payload))
+		{
+			break;
+		}
+		METRICS_AddCounters();
+		free(payload);
+		payload = NULL;
+	}
+	METRICS_ThreadCounters( NULL );
+	free(payload);
+	close(s);
+	return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+	struct sockaddr_un address;
+	pthread_t thread;
+	int listener = 0;
+	int s = 0;
+
+	if (argc < 2 || argc > 3)
+	{
+		Usage();
+		exit(0);
+	}
+	memory_budget = (argc > 2 ? atol(argv[2]) : DEFAULT_MEMORY_MB) << 20;
+	if (memory_budget == 0 || strlen(argv[1]) >= sizeof(address.sun_path))
+	{
+		Usage();
+		exit(0);
+	}
+	/* a client that goes away fails its writes instead of ending the server */
+	signal(SIGPIPE, SIG_IGN);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, argv[1]);
+	unlink(argv[1]);
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+	{
+		printf("Could not listen on '%s'.\n", argv[1]);
+		exit(1);
+	}
+	for (;;)
+	{
+		s = accept(listener, NULL, NULL);
+		if (s < 0)
+		{
+			continue;
+		}
+		if (pthread_create(&thread, NULL, serve_connection, (void*)(long)s) != 0)
+		{
+			close(s);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+	return 0;
+}
@@ -0,0 +1,554 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file st_sort.c implementing the header file
+st_sort.h.
+
+The sampled suffixes are numbered by residue, then by position: the string of
+names holds the names of the suffixes of the first residue in text order, then
+those of the next, and so on, ending with a 0. The last name of each residue
+is that of a block cut short by the end of the text, unlike any other, so two
+suffixes of the string of names differ before either runs into the next
+residue, and their order is that of the sampled suffixes.
+*******************************************************************************/
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "suffix_tree.h"
+#include "st_sort.h"
+
+/* From suffix_tree.c */
+#define PACKED_BASES (sizeof(DBL_WORD)*4)
+DBL_WORD packed_match(const DBL_WORD* a, DBL_WORD a_pos, const DBL_WORD* b, DBL_WORD b_pos, DBL_WORD n);
+
+/* The base at index i of packed words */
+#define PACKED_BASE(words, i) (((words)[(i) / PACKED_BASES] >> (((i) % PACKED_BASES) * 2)) & 3)
+
+/* Common prefixes whose minimum is taken one by one */
+#define RMQ_BLOCK 32
+/* Positions sorted by insertion */
+#define INSERTION_SORT 16
+/* An entry of a suffix array not set yet */
+#define EMPTY 0xFFFFFFFFU
+/* Whether the suffix at i is the leftmost of a run of S suffixes */
+#define IS_LMS(type, i) ((i) > 0 && (type)[i] && !(type)[(i) - 1])
+
+/* A difference cover of STS_PERIOD (a Singer difference set) */
+static const unsigned char cover[STS_RESIDUES] = {0, 1, 8, 21, 39, 43, 48, 54, 73, 105, 117, 131};
+
+/******************************************************************************/
+/*
+   compare_chars :
+   Compares the characters of the text from a and from b, at most n of them;
+   a suffix that ends (at the $) comes first.
+
+   Output: The order, 0 when the n characters are equal, and the number of
+           equal characters.
+*/
+
+static int compare_chars(const ST_SAMPLE* sample, DBL_WORD a, DBL_WORD b, DBL_WORD n, DBL_WORD* matched)
+{
+   DBL_WORD rest_a = sample->length + 1 - a, rest_b = sample->length + 1 - b, limit = n;
+   unsigned int x, y;
+
+   if(rest_a < limit)
+      limit = rest_a;
+   if(rest_b < limit)
+      limit = rest_b;
+   if(sample->packed != 0)
+      *matched = packed_match(sample->packed, a, sample->packed, b, limit);
+   else
+      for(*matched = 0; *matched < limit && sample->string[a + *matched] == sample->string[b + *matched]; (*matched)++)
+         ;
+   if(*matched < limit)
+   {
+      x = sample->packed != 0 ? PACKED_BASE(sample->packed, a + *matched) : (unsigned char)sample->string[a + *matched];
+      y = sample->packed != 0 ? PACKED_BASE(sample->packed, b + *matched) : (unsigned char)sample->string[b + *matched];
+      return x < y ? -1 : 1;
+   }
+   if(limit == n || rest_a == rest_b)
+      return 0;
+   return rest_a < rest_b ? -1 : 1;
+}
+
+/******************************************************************************/
+/*
+   sample_index :
+   The index in the string of names of the sampled suffix at position p.
+*/
+
+static DBL_WORD sample_index(const ST_SAMPLE* sample, DBL_WORD p)
+{
+   unsigned char c = sample->residue[p % STS_PERIOD];
+   return sample->class_start[c] + (p - sample->class_first[c]) / STS_PERIOD;
+}
+
+/******************************************************************************/
+/*
+   sample_position :
+   The position of the sampled suffix at index i of the string of names.
+*/
+
+static DBL_WORD sample_position(const ST_SAMPLE* sample, DBL_WORD i)
+{
+   unsigned char c = STS_RESIDUES - 1;
+   while(sample->class_start[c] > i)
+      c--;
+   return sample->class_first[c] + (i - sample->class_start[c]) * STS_PERIOD;
+}
+
+/******************************************************************************/
+/*
+   sort_blocks :
+   Merge sorts positions by their first STS_PERIOD characters.
+*/
+
+static void sort_blocks(const ST_SAMPLE* sample, unsigned int* positions, unsigned int* work, DBL_WORD count)
+{
+   DBL_WORD i, j, m, half = count / 2, matched;
+   unsigned int position;
+
+   if(count <= INSERTION_SORT)
+   {
+      for(i = 1; i < count; i++)
+      {
+         position = positions[i];
+         for(j = i; j > 0 && compare_chars(sample, position, positions[j - 1], STS_PERIOD, &matched) < 0; j--)
+            positions[j] = positions[j - 1];
+         positions[j] = position;
+      }
+      return;
+   }
+   sort_blocks(sample, positions, work, half);
+   sort_blocks(sample, positions + half, work, count - half);
+   memcpy(work, positions, half * sizeof(unsigned int));
+   for(i = 0, j = half, m = 0; i < half; m++)
+   {
+      if(j < count && compare_chars(sample, positions[j], work[i], STS_PERIOD, &matched) < 0)
+         positions[m] = positions[j++];
+      else
+         positions[m] = work[i++];
+   }
+}
+
+/******************************************************************************/
+/*
+   get_buckets :
+   The start (or the end) of the bucket of each name in a suffix array of s.
+*/
+
+static void get_buckets(const unsigned int* s, unsigned int* bucket, DBL_WORD n, DBL_WORD names, int end)
+{
+   DBL_WORD i, sum = 0;
+
+   memset(bucket, 0, names * sizeof(unsigned int));
+   for(i = 0; i < n; i++)
+      bucket[s[i]]++;
+   for(i = 0; i < names; i++)
+   {
+      sum += bucket[i];
+      bucket[i] = end ? sum : sum - bucket[i];
+   }
+}
+
+/******************************************************************************/
+/*
+   induce :
+   Places the L suffixes from left to right after the suffixes in the array,
+   then the S suffixes from right to left.
+*/
+
+static void induce(const unsigned int* s, unsigned int* sa, const unsigned char* type, unsigned int* bucket,
+                   DBL_WORD n, DBL_WORD names)
+{
+   DBL_WORD i;
+   unsigned int j;
+
+   get_buckets(s, bucket, n, names, 0);
+   for(i = 0; i < n; i++)
+   {
+      j = sa[i] - 1;
+      if(sa[i] != EMPTY && sa[i] > 0 && !type[j])
+         sa[bucket[s[j]]++] = j;
+   }
+   get_buckets(s, bucket, n, names, 1);
+   for(i = n; i-- > 0; )
+   {
+      j = sa[i] - 1;
+      if(sa[i] != EMPTY && sa[i] > 0 && type[j])
+         sa[--bucket[s[j]]] = j;
+   }
+}
+
+/******************************************************************************/
+/*
+   sa_is :
+   Builds the suffix array of s by induced sorting (Nong, Zhang and Chan).
+
+   Input : The string, ending with its only 0, its length and the number of
+           names (every name of s is below it), the array to fill.
+*/
+
+static void sa_is(const unsigned int* s, unsigned int* sa, DBL_WORD n, DBL_WORD names)
+{
+   unsigned char* type = (unsigned char*)malloc(n);
+   unsigned int*  bucket = (unsigned int*)malloc(names * sizeof(unsigned int));
+   unsigned int*  s1;
+   DBL_WORD       i, j, d, n1, name;
+   unsigned int   position, previous;
+   int            differ;
+
+   if(type == 0 || bucket == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   /* S suffixes (1) come before the next one, L suffixes (0) after it */
+   type[n - 1] = 1;
+   for(i = n - 1; i-- > 0; )
+      type[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && type[i + 1]);
+
+   /* The LMS substrings sorted */
+   get_buckets(s, bucket, n, names, 1);
+   for(i = 0; i < n; i++)
+      sa[i] = EMPTY;
+   for(i = 1; i < n; i++)
+      if(IS_LMS(type, i))
+         sa[--bucket[s[i]]] = i;
+   induce(s, sa, type, bucket, n, names);
+
+   /* Named, in the order of their positions at the end of the array */
+   for(i = 0, n1 = 0; i < n; i++)
+      if(IS_LMS(type, sa[i]))
+         sa[n1++] = sa[i];
+   for(i = n1; i < n; i++)
+      sa[i] = EMPTY;
+   name = 0;
+   previous = EMPTY;
+   for(i = 0; i < n1; i++)
+   {
+      position = sa[i];
+      differ = previous == EMPTY;
+      for(d = 0; !differ; d++)
+      {
+         if(s[position + d] != s[previous + d] || type[position + d] != type[previous + d])
+            differ = 1;
+         else if(d > 0 && (IS_LMS(type, position + d) || IS_LMS(type, previous + d)))
+            break;
+      }
+      if(differ)
+      {
+         name++;
+         previous = position;
+      }
+      sa[n1 + position / 2] = name - 1;
+   }
+   for(i = n, j = n; i-- > n1; )
+      if(sa[i] != EMPTY)
+         sa[--j] = sa[i];
+
+   /* The LMS suffixes sorted, by the same when their names repeat */
+   s1 = sa + n - n1;
+   if(name < n1)
+      sa_is(s1, sa, n1, name);
+   else
+      for(i = 0; i < n1; i++)
+         sa[s1[i]] = i;
+
+   /* Every suffix induced from them */
+   get_buckets(s, bucket, n, names, 1);
+   for(i = 1, j = 0; i < n; i++)
+      if(IS_LMS(type, i))
+         s1[j++] = i;
+   for(i = 0; i < n1; i++)
+      sa[i] = s1[sa[i]];
+   for(i = n1; i < n; i++)
+      sa[i] = EMPTY;
+   for(i = n1; i-- > 0; )
+   {
+      j = sa[i];
+      sa[i] = EMPTY;
+      sa[--bucket[s[j]]] = j;
+   }
+   induce(s, sa, type, bucket, n, names);
+   free(type);
+   free(bucket);
+}
+
+/******************************************************************************/
+/*
+   first_sample :
+   The first position of the sampled suffixes of residue c.
+*/
+
+static DBL_WORD first_sample(DBL_WORD c)
+{
+   return cover[c] == 0 ? STS_PERIOD : cover[c];
+}
+
+/******************************************************************************/
+/*
+   number_of_samples :
+   The number of sampled suffixes of a text, the $ alone included.
+*/
+
+static DBL_WORD number_of_samples(DBL_WORD length)
+{
+   DBL_WORD c, m = 0;
+
+   for(c = 0; c < STS_RESIDUES; c++)
+      if(first_sample(c) <= length + 1)
+         m += (length + 1 - first_sample(c)) / STS_PERIOD + 1;
+   return m;
+}
+
+/******************************************************************************/
+/*
+   range_minimum :
+   The smallest common prefix of the sampled suffixes ranked lo to hi.
+*/
+
+static unsigned int range_minimum(const ST_SAMPLE* sample, DBL_WORD lo, DBL_WORD hi)
+{
+   DBL_WORD first = lo / RMQ_BLOCK, last = hi / RMQ_BLOCK, level = 0, i;
+   unsigned int least = EMPTY;
+   const unsigned int* minima;
+
+   if(last - first < 2)
+   {
+      for(i = lo; i <= hi; i++)
+         if(sample->common[i] < least)
+            least = sample->common[i];
+      return least;
+   }
+   for(i = lo; i < (first + 1) * RMQ_BLOCK; i++)
+      if(sample->common[i] < least)
+         least = sample->common[i];
+   for(i = last * RMQ_BLOCK; i <= hi; i++)
+      if(sample->common[i] < least)
+         least = sample->common[i];
+   /* Two runs of 2^level blocks cover those in between */
+   first++;
+   while(((DBL_WORD)2 << level) <= last - first)
+      level++;
+   minima = sample->minima + level * sample->number_blocks;
+   if(minima[first] < least)
+      least = minima[first];
+   if(minima[last - ((DBL_WORD)1 << level)] < least)
+      least = minima[last - ((DBL_WORD)1 << level)];
+   return least;
+}
+
+/******************************************************************************/
+/*
+   STS_Create :
+   See st_sort.h for description.
+*/
+
+ST_SAMPLE* STS_Create(const DBL_WORD* packed, const char* string, DBL_WORD length)
+{
+   ST_SAMPLE*     sample = (ST_SAMPLE*)malloc(sizeof(ST_SAMPLE));
+   unsigned int*  positions;
+   unsigned int*  work;
+   unsigned int*  names;
+   unsigned int*  sa;
+   DBL_WORD       i, j, o, c, p, q, m, name, h, matched, count, level, half;
+   unsigned int*  minima;
+   unsigned int*  below;
+
+   if(sample == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   sample->packed = packed;
+   sample->string = string;
+   sample->length = length;
+   memset(sample->residue, STS_RESIDUES, sizeof(sample->residue));
+   for(c = 0; c < STS_RESIDUES; c++)
+      sample->residue[cover[c]] = (unsigned char)c;
+   for(i = 0; i < STS_PERIOD; i++)
+      for(j = 0; j < STS_PERIOD; j++)
+      {
+         for(o = 0; sample->residue[(i + o) % STS_PERIOD] == STS_RESIDUES ||
+                    sample->residue[(j + o) % STS_PERIOD] == STS_RESIDUES; o++)
+            ;
+         sample->offset[i][j] = (unsigned char)o;
+      }
+   /* The sampled suffixes, the $ alone included */
+   m = 0;
+   for(c = 0; c < STS_RESIDUES; c++)
+   {
+      sample->class_start[c] = m;
+      sample->class_first[c] = first_sample(c);
+      if(sample->class_first[c] <= length + 1)
+         m += (length + 1 - sample->class_first[c]) / STS_PERIOD + 1;
+   }
+   sample->number_samples = m;
+
+   /* Named by their first STS_PERIOD characters */
+   positions = (unsigned int*)malloc(m * sizeof(unsigned int));
+   work      = (unsigned int*)malloc((m / 2 + 1) * sizeof(unsigned int));
+   names     = (unsigned int*)malloc((m + 1) * sizeof(unsigned int));
+   if(positions == 0 || work == 0 || names == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(c = 0, i = 0; c < STS_RESIDUES; c++)
+      for(p = sample->class_first[c]; p <= length + 1; p += STS_PERIOD)
+         positions[i++] = (unsigned int)p;
+   sort_blocks(sample, positions, work, m);
+   free(work);
+   for(i = 0, name = 0; i < m; i++)
+   {
+      if(i == 0 || compare_chars(sample, positions[i - 1], positions[i], STS_PERIOD, &matched) != 0)
+         name++;
+      names[sample_index(sample, positions[i])] = (unsigned int)name;
+   }
+   names[m] = 0;
+   free(positions);
+
+   /* Ranked as the suffixes of the string of names */
+   sa = (unsigned int*)malloc((m + 1) * sizeof(unsigned int));
+   if(sa == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   sa_is(names, sa, m + 1, name + 1);
+   sample->rank   = (unsigned int*)malloc(m * sizeof(unsigned int));
+   sample->common = (unsigned int*)malloc((m + 1) * sizeof(unsigned int));
+   if(sample->rank == 0 || sample->common == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(i = 1; i <= m; i++)
+      sample->rank[sa[i]] = (unsigned int)i;
+
+   /* The common prefix of each with the one before, in names (Kasai et al.)
+      and then in characters of the blocks where the names differ */
+   sample->common[0] = 0;
+   for(c = 0, h = 0; c < STS_RESIDUES; c++)
+      for(i = sample->class_start[c], p = sample->class_first[c]; p <= length + 1; i++, p += STS_PERIOD)
+      {
+         j = sample->rank[i];
+         if(j == 1)
+         {
+            sample->common[j] = 0;
+            h = 0;
+            continue;
+         }
+         q = sa[j - 1];
+         while(names[i + h] == names[q + h])
+            h++;
+         compare_chars(sample, p + h * STS_PERIOD, sample_position(sample, q) + h * STS_PERIOD, STS_PERIOD, &matched);
+         sample->common[j] = (unsigned int)(h * STS_PERIOD + matched);
+         if(h > 0)
+            h--;
+      }
+   free(names);
+   free(sa);
+
+   /* The minima of blocks of them, and of 2^level blocks */
+   sample->number_blocks = m / RMQ_BLOCK + 1;
+   for(sample->levels = 1; ((DBL_WORD)1 << sample->levels) <= sample->number_blocks; sample->levels++)
+      ;
+   sample->minima = (unsigned int*)malloc(sample->levels * sample->number_blocks * sizeof(unsigned int));
+   if(sample->minima == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(i = 0; i < sample->number_blocks; i++)
+      sample->minima[i] = EMPTY;
+   for(i = 0; i <= m; i++)
+      if(sample->common[i] < sample->minima[i / RMQ_BLOCK])
+         sample->minima[i / RMQ_BLOCK] = sample->common[i];
+   for(level = 1; level < sample->levels; level++)
+   {
+      below  = sample->minima + (level - 1) * sample->number_blocks;
+      minima = below + sample->number_blocks;
+      half   = (DBL_WORD)1 << (level - 1);
+      count  = sample->number_blocks - 2 * half + 1;
+      for(i = 0; i < count; i++)
+         minima[i] = below[i] < below[i + half] ? below[i] : below[i + half];
+   }
+   sample->bytes = sizeof(ST_SAMPLE) + (2 * m + 1 + sample->levels * sample->number_blocks) * sizeof(unsigned int);
+   return sample;
+}
+
+/******************************************************************************/
+/*
+   STS_Bytes :
+   See st_sort.h for description.
+*/
+
+DBL_WORD STS_Bytes(DBL_WORD length)
+{
+   DBL_WORD m = number_of_samples(length), blocks = m / RMQ_BLOCK + 1, levels, kept, ranking;
+
+   for(levels = 1; ((DBL_WORD)1 << levels) <= blocks; levels++)
+      ;
+   kept = (2 * m + 1 + levels * blocks) * sizeof(unsigned int);
+   /* Ranking holds at most the string of names and its suffix array, and
+      either the ranks and common prefixes or the types and buckets of SA-IS
+      (at most 5 bytes a name on a level, each level half the one above) */
+   ranking = 2 * (m + 1) * sizeof(unsigned int) + 2 * 5 * (m + 1);
+   return sizeof(ST_SAMPLE) + (kept > ranking ? kept : ranking);
+}
+
+/******************************************************************************/
+/*
+   STS_Compare :
+   See st_sort.h for description.
+*/
+
+int STS_Compare(const ST_SAMPLE* sample, DBL_WORD a, DBL_WORD b, DBL_WORD from, DBL_WORD* common)
+{
+   DBL_WORD offset, matched, x, y;
+   int order;
+
+   /* Most suffixes differ within a word of what they share */
+   order = compare_chars(sample, a + from, b + from, PACKED_BASES, &matched);
+   if(order != 0)
+   {
+      if(common != 0)
+         *common = from + matched;
+      return order;
+   }
+   from += PACKED_BASES;
+   /* Then characters up to where both suffixes are sampled */
+   offset = sample->offset[a % STS_PERIOD][b % STS_PERIOD];
+   if(offset < from)
+      offset += (from - offset + STS_PERIOD - 1) / STS_PERIOD * STS_PERIOD;
+   order = compare_chars(sample, a + from, b + from, offset - from, &matched);
+   if(order != 0)
+   {
+      if(common != 0)
+         *common = from + matched;
+      return order;
+   }
+   x = sample->rank[sample_index(sample, a + offset)];
+   y = sample->rank[sample_index(sample, b + offset)];
+   if(common != 0)
+      *common = offset + range_minimum(sample, (x < y ? x : y) + 1, x < y ? y : x);
+   return x < y ? -1 : 1;
+}
+
+/******************************************************************************/
+/*
+   STS_Delete :
+   See st_sort.h for description.
+*/
+
+void STS_Delete(ST_SAMPLE* sample)
+{
+   if(sample == 0)
+      return;
+   free(sample->rank);
+   free(sample->common);
+   free(sample->minima);
+   free(sample);
+}
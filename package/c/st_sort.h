@@ -0,0 +1,109 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file st_sort.h for ordering the suffixes of a text
+and finding the common prefix of two of them in a time that does not grow
+with the repeats of the text, for the builders that make a tree from sorted
+suffixes (st_parallel.c, st_index.c). Comparing two suffixes character by
+character takes as long as their common prefix, so sorting a tandem repeat
+or a long duplication that way is quadratic.
+
+A sample of the suffixes is ranked first: those starting at the positions p
+with p mod STS_PERIOD in a difference cover of STS_PERIOD, a set of residues
+such that any two positions come to sampled ones after the same number of
+characters, less than STS_PERIOD. The sampled suffixes are named by their
+first STS_PERIOD characters and sorted as the suffixes of the string of
+names (SA-IS, linear), and the common prefixes of the neighbours follow in
+the same order (Kasai et al.), with a table of the minimum of each range of
+them. Two suffixes are then ordered by at most STS_PERIOD characters and the
+ranks of the sampled suffixes after them, and their common prefix is the
+characters compared plus the common prefix of those sampled suffixes.
+
+The sample takes about 1 byte per character of the text (STS_PERIOD = 133
+with 12 residues samples 9% of the suffixes), 1.6 while it is ranked. Texts
+are shorter than 4G.
+*******************************************************************************/
+
+/* Characters compared at most before the ranks decide */
+#define STS_PERIOD    133
+/* Residues of the difference cover */
+#define STS_RESIDUES  12
+
+/* The ranked sample of the suffixes of a text */
+typedef struct STSAMPLE
+{
+   /* The text from index 1, packed as in suffix_tree.c or (when packed is 0)
+      characters, and its length without the $ (the suffix at length + 1 is
+      the $ alone and comes before every other) */
+   const DBL_WORD*  packed;
+   const char*      string;
+   DBL_WORD         length;
+   /* Index in the string of names of the first sampled suffix of each
+      residue and its position */
+   DBL_WORD         class_start[STS_RESIDUES];
+   DBL_WORD         class_first[STS_RESIDUES];
+   /* The residue of each position mod STS_PERIOD, STS_RESIDUES when it is
+      not sampled, and the offset at which two positions both reach sampled
+      ones */
+   unsigned char    residue[STS_PERIOD];
+   unsigned char    offset[STS_PERIOD][STS_PERIOD];
+   /* Number of sampled suffixes, the rank of each (by index in the string of
+      names, from 1) and the common prefix of each with the one ranked before */
+   DBL_WORD         number_samples;
+   unsigned int*    rank;
+   unsigned int*    common;
+   /* The minimum of the common prefixes of each block of 32 ranks, then of
+      2^l blocks from each block for each level l */
+   unsigned int*    minima;
+   DBL_WORD         number_blocks;
+   DBL_WORD         levels;
+   /* Bytes allocated */
+   DBL_WORD         bytes;
+} ST_SAMPLE;
+
+
+/******************************************************************************/
+/*
+   STS_Create :
+   Ranks the sample of the suffixes of a text.
+
+   Input : The text from index 1, packed 2 bits per base (a spare word at the
+           end, as ST_CreateTree and STI_Build hold it) or as characters when
+           packed is 0, and its length without the $. The text is not copied
+           and must outlive the sample.
+
+   Output: The sample (delete it with STS_Delete).
+*/
+
+ST_SAMPLE* STS_Create(const DBL_WORD* packed, const char* string, DBL_WORD length);
+
+/******************************************************************************/
+/*
+   STS_Bytes :
+   The most memory STS_Create takes for a text of a length, while the sample
+   is ranked (about 1.6 bytes per character) and after.
+*/
+
+DBL_WORD STS_Bytes(DBL_WORD length);
+
+/******************************************************************************/
+/*
+   STS_Compare :
+   Orders two different suffixes of the text. The $ comes before every
+   character, then the bases (A, C, G, T) or the characters in byte order.
+
+   Input : The sample, the positions (1 to length + 1) of the suffixes,
+           the number of first characters they are known to share, and where
+           to put their common prefix (0 when only the order is needed).
+
+   Output: Negative when the suffix at a comes first, positive otherwise.
+*/
+
+int STS_Compare(const ST_SAMPLE* sample, DBL_WORD a, DBL_WORD b, DBL_WORD from, DBL_WORD* common);
+
+/******************************************************************************/
+/*
+   STS_Delete :
+   Frees a sample (not its text).
+*/
+
+void STS_Delete(ST_SAMPLE* sample);
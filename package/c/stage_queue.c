@@ -0,0 +1,213 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the implementation file stage_queue.c implementing the header file
+stage_queue.h.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "stdlib.h"
+#include "stdio.h"
+#include "sched.h"
+#include "metrics.h"
+#include "stage_queue.h"
+
+/* Times a thread yields and tries again before it sleeps on the queue */
+#define STAGE_SPINS 64
+
+/******************************************************************************/
+/*
+   STAGE_CreateQueue :
+   See stage_queue.h for description.
+*/
+
+STAGE_QUEUE* STAGE_CreateQueue(unsigned long capacity)
+{
+   STAGE_QUEUE* queue = (STAGE_QUEUE*)calloc(1, sizeof(STAGE_QUEUE));
+   unsigned long size = 2, i;
+
+   while(size < capacity)
+      size *= 2;
+   if(queue != 0)
+      queue->cells = (STAGE_CELL*)malloc(size * sizeof(STAGE_CELL));
+   if(queue == 0 || queue->cells == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   /* Cell i is free for the push at position i */
+   for(i = 0; i < size; i++)
+      queue->cells[i].sequence = i;
+   queue->mask = size - 1;
+   pthread_mutex_init(&queue->lock, 0);
+   pthread_cond_init(&queue->changed, 0);
+   return queue;
+}
+
+/******************************************************************************/
+/*
+   try_push :
+   Adds an item if the queue has room.
+
+   Output: 1 if it was added, 0 if the queue is full.
+*/
+
+static int try_push(STAGE_QUEUE* queue, void* item)
+{
+   unsigned long position = __atomic_load_n(&queue->push_position, __ATOMIC_RELAXED), sequence;
+   STAGE_CELL* cell;
+   long difference;
+
+   for(;;)
+   {
+      cell = queue->cells + (position & queue->mask);
+      sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+      difference = (long)(sequence - position);
+      if(difference == 0)
+      {
+         if(__atomic_compare_exchange_n(&queue->push_position, &position, position + 1, 0, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+            break;
+      }
+      /* The cell still holds the item of the last round */
+      else if(difference < 0)
+         return 0;
+      else
+         position = __atomic_load_n(&queue->push_position, __ATOMIC_RELAXED);
+   }
+   cell->item = item;
+   __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   try_pop :
+   Takes an item if the queue has one.
+
+   Output: 1 if it was taken, 0 if the queue is empty.
+*/
+
+static int try_pop(STAGE_QUEUE* queue, void** item)
+{
+   unsigned long position = __atomic_load_n(&queue->pop_position, __ATOMIC_RELAXED), sequence;
+   STAGE_CELL* cell;
+   long difference;
+
+   for(;;)
+   {
+      cell = queue->cells + (position & queue->mask);
+      sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+      difference = (long)(sequence - (position + 1));
+      if(difference == 0)
+      {
+         if(__atomic_compare_exchange_n(&queue->pop_position, &position, position + 1, 0, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED))
+            break;
+      }
+      /* Nothing was pushed to the cell yet */
+      else if(difference < 0)
+         return 0;
+      else
+         position = __atomic_load_n(&queue->pop_position, __ATOMIC_RELAXED);
+   }
+   *item = cell->item;
+   /* Free for the push one round later */
+   __atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   wake :
+   Wakes the threads asleep on a queue after a push or a pop.
+*/
+
+static void wake(STAGE_QUEUE* queue)
+{
+   /* The push or pop is seen by a sleeper counted after this, see wait_turn */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if(__atomic_load_n(&queue->waiters, __ATOMIC_RELAXED) > 0)
+   {
+      pthread_mutex_lock(&queue->lock);
+      pthread_cond_broadcast(&queue->changed);
+      pthread_mutex_unlock(&queue->lock);
+   }
+}
+
+/******************************************************************************/
+/*
+   wait_turn :
+   Tries a push (item set) or a pop (into popped) until it is done: yielding
+   the core in between a few times, then asleep until a push or a pop.
+
+   Output: The seconds waited.
+*/
+
+static double wait_turn(STAGE_QUEUE* queue, void* item, void** popped)
+{
+   double start = METRICS_Now();
+   int spins;
+
+   for(spins = 0; spins < STAGE_SPINS; spins++)
+   {
+      sched_yield();
+      if(popped == 0 ? try_push(queue, item) : try_pop(queue, popped))
+         return METRICS_Now() - start;
+   }
+   pthread_mutex_lock(&queue->lock);
+   /* Counted before trying again: a push or pop after this wakes us (it
+      takes the lock once we sleep), one before it is seen by the try */
+   __atomic_add_fetch(&queue->waiters, 1, __ATOMIC_SEQ_CST);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   while(!(popped == 0 ? try_push(queue, item) : try_pop(queue, popped)))
+      pthread_cond_wait(&queue->changed, &queue->lock);
+   __atomic_sub_fetch(&queue->waiters, 1, __ATOMIC_SEQ_CST);
+   pthread_mutex_unlock(&queue->lock);
+   return METRICS_Now() - start;
+}
+
+/******************************************************************************/
+/*
+   STAGE_Push :
+   See stage_queue.h for description.
+*/
+
+double STAGE_Push(STAGE_QUEUE* queue, void* item)
+{
+   double waited = 0;
+
+   if(!try_push(queue, item))
+      waited = wait_turn(queue, item, 0);
+   wake(queue);
+   return waited;
+}
+
+/******************************************************************************/
+/*
+   STAGE_Pop :
+   See stage_queue.h for description.
+*/
+
+double STAGE_Pop(STAGE_QUEUE* queue, void** item)
+{
+   double waited = 0;
+
+   if(!try_pop(queue, item))
+      waited = wait_turn(queue, 0, item);
+   wake(queue);
+   return waited;
+}
+
+/******************************************************************************/
+/*
+   STAGE_DeleteQueue :
+   See stage_queue.h for description.
+*/
+
+void STAGE_DeleteQueue(STAGE_QUEUE* queue)
+{
+   pthread_mutex_destroy(&queue->lock);
+   pthread_cond_destroy(&queue->changed);
+   free(queue->cells);
+   free(queue);
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+DESCRIPTION OF THIS FILE:
+This is the declaration file stage_queue.h for the bounded queues between the
+stages of a pipeline (chrcompare: reader, encoder, query workers, writer). A
+queue is a ring of cells, each with a sequence number that tells whether the
+cell holds an item for the consumers or room for the producers; a push or a
+pop claims its cell with one compare and swap of the ring position, so any
+number of threads push and pop without a lock (D. Vyukov's bounded MPMC
+queue). A thread that finds the queue full or empty yields the core and
+tries again a few times, then sleeps until a push or a pop wakes it, so a
+stage waiting long (the writer behind slow queries) leaves its core to the
+others. The time it waited is returned for the stage's utilization (see
+METRICS_Stage in metrics.h).
+
+The items are pointers; 0 is an item like any other, which pipelines use to
+mark the end of their input.
+*******************************************************************************/
+
+#include "pthread.h"
+
+typedef struct STAGECELL
+{
+   unsigned long   sequence;
+   void*           item;
+} STAGE_CELL;
+
+typedef struct STAGEQUEUE
+{
+   STAGE_CELL*     cells;
+   unsigned long   mask;
+   /* The positions of the next push and the next pop, on cache lines of
+      their own so producers and consumers do not share one */
+   char            pad0[64];
+   unsigned long   push_position;
+   char            pad1[64];
+   unsigned long   pop_position;
+   char            pad2[64];
+   /* Threads asleep on the queue, woken by changed after a push or a pop */
+   unsigned long   waiters;
+   pthread_mutex_t lock;
+   pthread_cond_t  changed;
+} STAGE_QUEUE;
+
+/******************************************************************************/
+/*
+   STAGE_CreateQueue :
+   Creates an empty queue.
+
+   Input : The number of items it holds at most (rounded up to a power of 2).
+
+   Output: The queue.
+*/
+
+STAGE_QUEUE* STAGE_CreateQueue(unsigned long capacity);
+
+/******************************************************************************/
+/*
+   STAGE_Push :
+   Adds an item at the end of a queue, waiting while it is full.
+
+   Output: The seconds waited.
+*/
+
+double STAGE_Push(STAGE_QUEUE* queue, void* item);
+
+/******************************************************************************/
+/*
+   STAGE_Pop :
+   Takes the item at the front of a queue, waiting while it is empty.
+
+   Input : The queue and where to put the item.
+
+   Output: The seconds waited.
+*/
+
+double STAGE_Pop(STAGE_QUEUE* queue, void** item);
+
+/******************************************************************************/
+/*
+   STAGE_DeleteQueue :
+   Frees a queue (its items are the caller's).
+*/
+
+void STAGE_DeleteQueue(STAGE_QUEUE* queue);
@@ -72,6 +72,7 @@ of (1) points only to (2).
 #include "stdio.h"
 #include "string.h"
 #include "suffix_tree.h"
+#include "metrics.h"
 
 /* See function body */
 void ST_PrintTree(SUFFIX_TREE* tree);
@@ -86,10 +87,6 @@ typedef enum RULE_2_TYPE   {new_son, split}                RULE_2_TYPE;
 /* Signals whether last matching position is the last one of the current edge */
 typedef enum LAST_POS_TYPE {last_char_in_edge, other_char} LAST_POS_TYPE;
 
-/* Used for statistic measures of speed. */
-DBL_WORD counter;
-/* Used for statistic measures of space. */
-DBL_WORD heap;
 /* Used to mark the node that has no suffix link yet. By Ukkonen, it will have
    one by the end of the current phase. */
 NODE*    suffixless;
@@ -108,11 +105,9 @@ typedef struct SUFFIXTREEPOS
 
 /******************************************************************************/
 /*
-   Define STATISTICS in order to view measures of speed and space while
-   constructing and searching the suffix tree. Measures will be printed on the
-   screen.
+   Measures of speed and space (nodes, splits, suffix links, skips, bytes) are
+   counted in metrics, once per event, see metrics.h.
 */
-/* #define STATISTICS */
 
 /*
    Define DEBUG in order to view debug printouts to the screen while
@@ -120,6 +115,236 @@ typedef struct SUFFIXTREEPOS
 */
 /* #define DEBUG */
 
+/******************************************************************************/
+/*
+   Packed text. A DNA string (A, C, G and T only) is stored in tree->packed_string
+   2 bits per base, PACKED_BASES bases per word. Two runs of the text are
+   compared a word at a time: the lowest set bit of the XOR of the two words is
+   the first mismatch. A searched string is compared with the text unpacked a
+   word at a time (see pattern_match). The $ at index tree->length is not in
+   the packed text and is compared separately.
+*/
+
+#define PACKED_BASES (sizeof(DBL_WORD)*4)
+
+/* Number of the lowest set bit of a non zero word */
+#ifdef __GNUC__
+#define LOWEST_BIT(word) ((DBL_WORD)__builtin_ctzl(word))
+#else
+DBL_WORD LOWEST_BIT(DBL_WORD word)
+{
+   DBL_WORD bit = 0;
+   while((word & 1) == 0)
+   {
+      word >>= 1;
+      bit++;
+   }
+   return bit;
+}
+#endif
+
+/* 2 bit code of each character, 4 for the characters that are not bases */
+const unsigned char base_codes[256] =
+{
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,0,4,1,4,4,4,2,4,4,4,4,4,4,4,4, 4,4,4,4,3,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+   4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4, 4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4
+};
+
+/* The 4 bases packed in each byte, the lowest bits first */
+const char unpacked_bases[256][4] =
+{
+   "AAAA","CAAA","GAAA","TAAA","ACAA","CCAA","GCAA","TCAA","AGAA","CGAA","GGAA","TGAA","ATAA","CTAA","GTAA","TTAA",
+   "AACA","CACA","GACA","TACA","ACCA","CCCA","GCCA","TCCA","AGCA","CGCA","GGCA","TGCA","ATCA","CTCA","GTCA","TTCA",
+   "AAGA","CAGA","GAGA","TAGA","ACGA","CCGA","GCGA","TCGA","AGGA","CGGA","GGGA","TGGA","ATGA","CTGA","GTGA","TTGA",
+   "AATA","CATA","GATA","TATA","ACTA","CCTA","GCTA","TCTA","AGTA","CGTA","GGTA","TGTA","ATTA","CTTA","GTTA","TTTA",
+   "AAAC","CAAC","GAAC","TAAC","ACAC","CCAC","GCAC","TCAC","AGAC","CGAC","GGAC","TGAC","ATAC","CTAC","GTAC","TTAC",
+   "AACC","CACC","GACC","TACC","ACCC","CCCC","GCCC","TCCC","AGCC","CGCC","GGCC","TGCC","ATCC","CTCC","GTCC","TTCC",
+   "AAGC","CAGC","GAGC","TAGC","ACGC","CCGC","GCGC","TCGC","AGGC","CGGC","GGGC","TGGC","ATGC","CTGC","GTGC","TTGC",
+   "AATC","CATC","GATC","TATC","ACTC","CCTC","GCTC","TCTC","AGTC","CGTC","GGTC","TGTC","ATTC","CTTC","GTTC","TTTC",
+   "AAAG","CAAG","GAAG","TAAG","ACAG","CCAG","GCAG","TCAG","AGAG","CGAG","GGAG","TGAG","ATAG","CTAG","GTAG","TTAG",
+   "AACG","CACG","GACG","TACG","ACCG","CCCG","GCCG","TCCG","AGCG","CGCG","GGCG","TGCG","ATCG","CTCG","GTCG","TTCG",
+   "AAGG","CAGG","GAGG","TAGG","ACGG","CCGG","GCGG","TCGG","AGGG","CGGG","GGGG","TGGG","ATGG","CTGG","GTGG","TTGG",
+   "AATG","CATG","GATG","TATG","ACTG","CCTG","GCTG","TCTG","AGTG","CGTG","GGTG","TGTG","ATTG","CTTG","GTTG","TTTG",
+   "AAAT","CAAT","GAAT","TAAT","ACAT","CCAT","GCAT","TCAT","AGAT","CGAT","GGAT","TGAT","ATAT","CTAT","GTAT","TTAT",
+   "AACT","CACT","GACT","TACT","ACCT","CCCT","GCCT","TCCT","AGCT","CGCT","GGCT","TGCT","ATCT","CTCT","GTCT","TTCT",
+   "AAGT","CAGT","GAGT","TAGT","ACGT","CCGT","GCGT","TCGT","AGGT","CGGT","GGGT","TGGT","ATGT","CTGT","GTGT","TTGT",
+   "AATT","CATT","GATT","TATT","ACTT","CCTT","GCTT","TCTT","AGTT","CGTT","GGTT","TGTT","ATTT","CTTT","GTTT","TTTT"
+};
+
+/******************************************************************************/
+/*
+   pack_word :
+   Packs up to PACKED_BASES characters into a word, the first in the lowest
+   bits.
+
+   Output: 1 if all the characters are bases, 0 if not (the word is then of no
+           use).
+*/
+
+int pack_word(const char* str, DBL_WORD count, DBL_WORD* word)
+{
+   DBL_WORD i, packed = 0;
+   unsigned char code, invalid = 0;
+   for(i = 0; i < count; i++)
+   {
+      code     = base_codes[(unsigned char)str[i]];
+      invalid |= code;
+      packed  |= (DBL_WORD)(code & 3) << (i * 2);
+   }
+   *word = packed;
+   return (invalid & 4) == 0;
+}
+
+/******************************************************************************/
+/*
+   pack_string :
+   Packs the tree source string, str being index 1 onwards, into words.
+
+   Output: 1 if the string is all bases, 0 if not.
+*/
+
+int pack_string(DBL_WORD* words, const char* str, DBL_WORD length)
+{
+   DBL_WORD i, count, word;
+   /* Index 0 has no character, it is packed as an A */
+   count = length < PACKED_BASES - 1 ? length : PACKED_BASES - 1;
+   if(!pack_word(str, count, &word))
+      return 0;
+   words[0] = word << 2;
+   for(i = count; i < length; i += PACKED_BASES)
+   {
+      count = length - i < PACKED_BASES ? length - i : PACKED_BASES;
+      if(!pack_word(str + i, count, words + (i + 1) / PACKED_BASES))
+         return 0;
+   }
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   tree_char :
+   Returns the character at index i of the tree source string, whether it is
+   held packed or not. Index 0 (before the string) is 0.
+*/
+
+char tree_char(SUFFIX_TREE* tree, DBL_WORD i)
+{
+   if(tree->tree_string != 0)
+      return tree->tree_string[i];
+   if(i >= tree->length)
+      return '$';
+   if(i == 0)
+      return 0;
+   return "ACGT"[(tree->packed_string[i / PACKED_BASES] >> ((i % PACKED_BASES) * 2)) & 3];
+}
+
+/******************************************************************************/
+/*
+   packed_word :
+   Returns the PACKED_BASES bases starting at index i of packed words (the
+   array has a spare word at its end).
+*/
+
+DBL_WORD packed_word(const DBL_WORD* words, DBL_WORD i)
+{
+   DBL_WORD shift = (i % PACKED_BASES) * 2;
+   const DBL_WORD* word = words + i / PACKED_BASES;
+   if(shift == 0)
+      return *word;
+   return (*word >> shift) | (*(word + 1) << (PACKED_BASES * 2 - shift));
+}
+
+/******************************************************************************/
+/*
+   packed_match :
+   Returns the number of equal bases, at most n, of packed words a from index
+   a_pos and packed words b from index b_pos.
+*/
+
+DBL_WORD packed_match(const DBL_WORD* a, DBL_WORD a_pos, const DBL_WORD* b, DBL_WORD b_pos, DBL_WORD n)
+{
+   DBL_WORD matched = 0, diff;
+   while(matched < n)
+   {
+      diff = packed_word(a, a_pos + matched) ^ packed_word(b, b_pos + matched);
+      if(n - matched < PACKED_BASES)
+         diff &= ((DBL_WORD)1 << ((n - matched) * 2)) - 1;
+      if(diff != 0)
+         return matched + LOWEST_BIT(diff) / 2;
+      matched += PACKED_BASES;
+   }
+   return n;
+}
+
+/******************************************************************************/
+/*
+   text_match :
+   Returns the number of equal characters, at most n, of the tree source
+   string from index a and from index b.
+*/
+
+DBL_WORD text_match(SUFFIX_TREE* tree, DBL_WORD a, DBL_WORD b, DBL_WORD n)
+{
+   DBL_WORD matched = 0, bases = n;
+
+   if(tree->tree_string != 0)
+   {
+      while(matched < n && tree->tree_string[a + matched] == tree->tree_string[b + matched])
+         matched++;
+      return matched;
+   }
+   /* Only the bases before the $ are packed */
+   if(a + bases > tree->length)
+      bases = tree->length - a;
+   if(b + bases > tree->length)
+      bases = tree->length - b;
+   matched = packed_match(tree->packed_string, a, tree->packed_string, b, bases);
+   /* The $ is only equal to itself */
+   if(matched == bases && matched < n && a == b)
+      return n;
+   return matched;
+}
+
+/******************************************************************************/
+/*
+   pattern_match :
+   Returns the number of equal characters, at most n, of the packed tree
+   source string from index k and of the string W. The text is unpacked a word
+   at a time and compared with memcmp, so W needs no packing (and anything but
+   a base in it is simply a mismatch). n must not reach the $.
+*/
+
+DBL_WORD pattern_match(SUFFIX_TREE* tree, DBL_WORD k, const char* W, DBL_WORD n)
+{
+   char     bases[PACKED_BASES];
+   DBL_WORD matched = 0, word, count, i;
+
+   while(matched < n)
+   {
+      word  = packed_word(tree->packed_string, k + matched);
+      count = n - matched < PACKED_BASES ? n - matched : PACKED_BASES;
+      for(i = 0; i < count; i += 4)
+      {
+         memcpy(bases + i, unpacked_bases[word & 255], 4);
+         word >>= 8;
+      }
+      if(memcmp(bases, W + matched, count) != 0)
+      {
+         for(i = 0; bases[i] == W[matched + i]; i++)
+            ;
+         return matched + i;
+      }
+      matched += count;
+   }
+   return n;
+}
+
 /******************************************************************************/
 /*
    create_node :
@@ -143,9 +368,8 @@ NODE* create_node(NODE* father, DBL_WORD start, DBL_WORD end, DBL_WORD position,
       exit(0);
    }
 
-#ifdef STATISTICS
-   heap+=sizeof(NODE);
-#endif
+   metrics.nodes++;
+   metrics.bytes += sizeof(NODE);
 
    /* Initialize node fields. For detailed description of the fields see
       suffix_tree.h */
@@ -177,17 +401,29 @@ NODE* create_node(NODE* father, DBL_WORD start, DBL_WORD end, DBL_WORD position,
 
 NODE* find_son(SUFFIX_TREE* tree, NODE* node, char character)
 {
+   DBL_WORD code, start;
+
    /* Point to the first son. */
    node = node->sons;
+   /* A packed string is scanned by 2 bit codes, the $ (or any other
+   character) can only start the edge at the end of the string */
+   if(tree->packed_string != 0)
+   {
+      code = base_codes[(unsigned char)character];
+      while(node != 0)
+      {
+         start = node->edge_label_start;
+         if(start >= tree->length ? character == '$' :
+            ((tree->packed_string[start / PACKED_BASES] >> ((start % PACKED_BASES) * 2)) & 3) == code)
+            break;
+         node = node->right_sibling;
+      }
+      return node;
+   }
    /* scan all sons (all right siblings of the first son) for their first
    character (it has to match the character given as input to this function. */
    while(node != 0 && tree->tree_string[node->edge_label_start] != character)
-   {
-#ifdef STATISTICS
-      counter++;
-#endif
       node = node->right_sibling;
-   }
    return node;
 }
 
@@ -329,6 +565,7 @@ NODE* apply_extension_rule_2(
 #ifdef DEBUG   
    printf("rule 2: split (%lu,%lu)\n",edge_label_begin,edge_label_end);
 #endif
+   metrics.splits++;
    /* Create a new internal node (3) at the split point */
    new_internal = create_node(
                       node->father,
@@ -407,7 +644,7 @@ NODE* trace_single_edge(
 
    /* Search for the first character of the string in the outcoming edge of
       node */
-   cont_node = find_son(tree, node, tree->tree_string[str.begin]);
+   cont_node = find_son(tree, node, tree_char(tree, str.begin));
    if(cont_node == 0)
    {
       /* Search is done, string not found */
@@ -439,10 +676,7 @@ NODE* trace_single_edge(
          (*edge_pos)      = str_len-1;
       }
 
-#ifdef STATISTICS
-      counter++;
-#endif
-
+      metrics.skips++;
       return node;
    }
    else
@@ -451,26 +685,15 @@ NODE* trace_single_edge(
       if(str_len < length)
          length = str_len;
 
-      for(*edge_pos=1, *chars_found=1; *edge_pos<length; (*chars_found)++,(*edge_pos)++)
-      {
-
-#ifdef STATISTICS
-         counter++;
-#endif
+      /* Compare the rest of the string and the edge (the first characters
+         are known to be equal) */
+      *chars_found = 1 + text_match(tree, node->edge_label_start+1, str.begin+1, length-1);
+      *edge_pos    = *chars_found - 1;
 
-         /* Compare current characters of the string and the edge. If equal - 
-	    continue */
-         if(tree->tree_string[node->edge_label_start+*edge_pos] != tree->tree_string[str.begin+*edge_pos])
-         {
-            (*edge_pos)--;
-            return node;
-         }
-      }
+      if(*chars_found < length)
+         return node;
    }
 
-   /* The loop has advanced *edge_pos one too much */
-   (*edge_pos)--;
-
    if((*chars_found) < str_len)
       /* Search is not done yet */
       *search_done = 0;
@@ -533,6 +756,80 @@ NODE* trace_string(
    return node;
 }
 
+/******************************************************************************/
+/*
+   jump_fill :
+   Fills the jump table with the nodes under node whose incoming edge holds
+   the jump_k-th character of their path.
+
+   Input : The tree, a node and the length of its father's path.
+*/
+
+void jump_fill(SUFFIX_TREE* tree, NODE* node, DBL_WORD father_depth)
+{
+   DBL_WORD depth = father_depth + get_node_label_length(tree, node), code;
+
+   if(depth < tree->jump_k)
+   {
+      for(node = node->sons; node != 0; node = node->right_sibling)
+         jump_fill(tree, node, depth);
+      return;
+   }
+   /* A path of fewer bases ends with the $ inside the k characters */
+   if(node->path_position + tree->jump_k > tree->length)
+      return;
+   code = packed_word(tree->packed_string, node->path_position) & (((DBL_WORD)1 << (2 * tree->jump_k)) - 1);
+   tree->jump_nodes[code]   = node;
+   tree->jump_offsets[code] = (unsigned char)(tree->jump_k - father_depth);
+}
+
+/******************************************************************************/
+/*
+   ST_BuildJumpTable :
+   See suffix_tree.h for description.
+*/
+
+DBL_WORD ST_BuildJumpTable(SUFFIX_TREE* tree, DBL_WORD k)
+{
+   NODE* node;
+   DBL_WORD entries;
+
+   if(tree->packed_string == 0 || k == 0 || k > ST_MAX_JUMP_K)
+      return 0;
+   entries = (DBL_WORD)1 << (2 * k);
+   free(tree->jump_nodes);
+   free(tree->jump_offsets);
+   tree->jump_k       = k;
+   tree->jump_nodes   = (NODE**)calloc(entries, sizeof(NODE*));
+   tree->jump_offsets = (unsigned char*)calloc(entries, sizeof(unsigned char));
+   if(tree->jump_nodes == 0 || tree->jump_offsets == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   metrics.bytes += entries * (sizeof(NODE*) + sizeof(unsigned char));
+   METRICS_Start(METRICS_BUILD);
+   for(node = tree->root->sons; node != 0; node = node->right_sibling)
+      jump_fill(tree, node, 0);
+   METRICS_Stop(METRICS_BUILD);
+   return 1;
+}
+
+/******************************************************************************/
+/*
+   ST_JumpK :
+   See suffix_tree.h for description.
+*/
+
+DBL_WORD ST_JumpK(void)
+{
+   const char* k = getenv("GENOMEOT_JUMP_K");
+
+   if(k == 0 || k[0] == 0)
+      return 0;
+   return (DBL_WORD)atol(k);
+}
+
 /******************************************************************************/
 /*
    ST_FindSubstring :
@@ -547,45 +844,89 @@ DBL_WORD ST_FindSubstring(
                       /* The length of W */
                       DBL_WORD        P)         
 {
-   /* Starts with the root's son that has the first character of W as its
-      incoming edge first character */
-   NODE* node   = find_son(tree, tree->root, W[0]);
-   DBL_WORD k,j = 0, node_label_end;
+   NODE* node;
+   DBL_WORD k = 0,j = 0, node_label_end, n, bases, code, result = ST_ERROR;
+
+   if(tree->jump_nodes != 0 && P >= tree->jump_k && pack_word(W, tree->jump_k, &code))
+   {
+      /* Starts where the first jump_k characters of W end, if they are in the
+         tree at all */
+      node = tree->jump_nodes[code];
+      if(node != 0)
+      {
+         j = tree->jump_k;
+         k = node->edge_label_start + tree->jump_offsets[code];
+      }
+   }
+   else
+   {
+      /* Starts with the root's son that has the first character of W as its
+         incoming edge first character */
+      node = find_son(tree, tree->root, W[0]);
+      if(node != 0)
+         k = node->edge_label_start;
+   }
 
    /* Scan nodes down from the root untill a leaf is reached or the substring is
       found */
    while(node!=0)
    {
-      k=node->edge_label_start;
       node_label_end = get_node_label_end(tree,node);
       
-      /* Scan a single edge - compare each character with the searched string */
-      while(j<P && k<=node_label_end && tree->tree_string[k] == W[j])
+      /* Scan a single edge - compare the characters with the searched string */
+      if(tree->packed_string != 0)
       {
-         j++;
-         k++;
-
-#ifdef STATISTICS
-         counter++;
-#endif
+         /* A word of bases at a time, up to the end of the edge or the $ */
+         n = P - j;
+         if(n > node_label_end - k + 1)
+            n = node_label_end - k + 1;
+         bases = n;
+         if(k + bases > tree->length)
+            bases = tree->length - k;
+         n = pattern_match(tree, k, W + j, bases);
+         j += n;
+         k += n;
+         /* The $ is only equal to itself */
+         if(n == bases && j < P && k <= node_label_end && k == tree->length && W[j] == '$')
+         {
+            j++;
+            k++;
+         }
+      }
+      else
+      {
+         while(j<P && k<=node_label_end && tree_char(tree, k) == W[j])
+         {
+            j++;
+            k++;
+         }
       }
       
       /* Checking which of the stopping conditions are true */
       if(j == P)
       {
          /* W was found - it is a substring. Return its path starting index */
-         return node->path_position;
+         result = node->path_position;
+         break;
       }
       else if(k > node_label_end)
+      {
          /* Current edge is found to match, continue to next edge */
          node = find_son(tree, node, W[j]);
+         if(node != 0)
+            k = node->edge_label_start;
+      }
       else
       {
          /* One non-matching symbols is found - W is not a substring */
-         return ST_ERROR;
+         break;
       }
    }
-   return ST_ERROR;
+   metrics_lookups->lookups++;
+   metrics_lookups->matched += j;
+   if(result != ST_ERROR)
+      metrics_lookups->found++;
+   return result;
 }
 
 /******************************************************************************/
@@ -634,6 +975,7 @@ void follow_suffix_link(SUFFIX_TREE* tree, POS* pos)
       gama.begin      = pos->node->edge_label_start;
       gama.end      = pos->node->edge_label_start + pos->edge_pos;
       /* Follow father's suffix link */
+      metrics.suffix_links++;
       pos->node      = pos->node->father->suffix_link;
       /* Down-walk gama back to suffix_link's son */
       pos->node      = trace_string(tree, pos->node, gama, &(pos->edge_pos), &chars_found, skip);
@@ -641,6 +983,7 @@ void follow_suffix_link(SUFFIX_TREE* tree, POS* pos)
    else
    {
       /* If a suffix link exists - just follow it */
+      metrics.suffix_links++;
       pos->node      = pos->node->suffix_link;
       pos->edge_pos   = get_node_label_length(tree,pos->node)-1;
    }
@@ -697,7 +1040,7 @@ void SEA(
    NODE*      tmp;
    char left_char = 0;
 
-   left_char = *(tree->tree_string + path_pos - 1);
+   left_char = tree_char(tree, path_pos - 1);
  
 #ifdef DEBUG   
    ST_PrintTree(tree);
@@ -708,21 +1051,17 @@ void SEA(
       printf("   starting at (%lu,%lu | %lu) ", pos->node->edge_label_start, get_node_label_end(tree,pos->node), pos->edge_pos);
 #endif
 
-#ifdef STATISTICS
-   counter++;
-#endif
+   metrics.extensions++;
 
    /* Follow suffix link only if it's not the first extension after rule 3 was applied */
    if(after_rule_3 == 0)
       follow_suffix_link(tree, pos);
 
 #ifdef DEBUG   
-#ifdef STATISTICS
    if(after_rule_3 == 0)
-      printf("to (%lu,%lu | %lu). counter: %lu\n", pos->node->edge_label_start, get_node_label_end(tree,pos->node),pos->edge_pos,counter);
+      printf("to (%lu,%lu | %lu). extensions: %lu\n", pos->node->edge_label_start, get_node_label_end(tree,pos->node),pos->edge_pos,metrics.extensions);
    else
-      printf(". counter: %lu\n", counter);
-#endif
+      printf(". extensions: %lu\n", metrics.extensions);
 #endif
 
    /* If node is root - trace whole string starting from the root, else - trace last character only */
@@ -740,7 +1079,7 @@ void SEA(
       if(is_last_char_in_edge(tree,pos->node,pos->edge_pos))
       {
          /* Trace only last symbol of str, search in the  NEXT edge (node) */
-         tmp = find_son(tree, pos->node, tree->tree_string[str.end]);
+         tmp = find_son(tree, pos->node, tree_char(tree, str.end));
          if(tmp != 0)
          {
             pos->node      = tmp;
@@ -752,7 +1091,7 @@ void SEA(
       else
       {
          /* Trace only last symbol of str, search in the CURRENT edge (node) */
-         if(tree->tree_string[pos->node->edge_label_start+pos->edge_pos+1] == tree->tree_string[str.end])
+         if(tree_char(tree, pos->node->edge_label_start+pos->edge_pos+1) == tree_char(tree, str.end))
          {
             pos->edge_pos++;
             chars_found   = 1;
@@ -887,6 +1226,74 @@ void SPA(
    return;
 }
 
+/******************************************************************************/
+/*
+   create_tree :
+   Allocates a tree of the string, with the string (packed if it is DNA) and a
+   root with no sons, for ST_CreateTree and the other builders to build in.
+*/
+
+SUFFIX_TREE* create_tree(const char* str, DBL_WORD length)
+{
+   SUFFIX_TREE*  tree;
+
+   /* Allocating the tree */
+   tree = malloc(sizeof(SUFFIX_TREE));
+   if(tree == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   metrics.bytes += sizeof(SUFFIX_TREE);
+
+   /* Calculating string length (with an ending $ sign) */
+   tree->length         = length+1;
+   ST_ERROR            = length+10;
+   
+   /* Allocating the only real string of the tree, packed if it is DNA */
+   tree->tree_string   = 0;
+   tree->packed_string = 0;
+   tree->packed_string = calloc(tree->length/PACKED_BASES+2, sizeof(DBL_WORD));
+   if(tree->packed_string == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   /* The string starts at index 1, the $ is out of band (see tree_char) */
+   if(pack_string(tree->packed_string, str, length))
+      metrics.bytes += (tree->length/PACKED_BASES+2)*sizeof(DBL_WORD);
+   else
+   {
+      free(tree->packed_string);
+      tree->packed_string = 0;
+      tree->tree_string = malloc((tree->length+1)*sizeof(char));
+      if(tree->tree_string == 0)
+      {
+         printf("\nOut of memory.\n");
+         exit(0);
+      }
+      metrics.bytes += (tree->length+1)*sizeof(char);
+
+      memcpy(tree->tree_string+sizeof(char),str,length*sizeof(char));
+      /* Nothing precedes the string (the left character of the first suffix) */
+      tree->tree_string[0] = 0;
+      /* $ is considered a uniqe symbol */
+      tree->tree_string[tree->length] = '$';
+   }
+   
+   /* One sequence, unless ST_CreateGeneralizedTree says otherwise */
+   tree->number_sequences = 1;
+   tree->sequence_starts  = 0;
+   tree->jump_k           = 0;
+   tree->jump_nodes       = 0;
+   tree->jump_offsets     = 0;
+
+   /* Allocating the tree root node */
+   tree->root            = create_node(0, 0, 0, 0, 0);
+   tree->root->suffix_link = 0;
+   return tree;
+}
+
 /******************************************************************************/
 /*
    ST_CreateTree :
@@ -918,35 +1325,8 @@ SUFFIX_TREE* ST_CreateTree(const char* str, DBL_WORD length)
    if(str == 0)
       return 0;
 
-   /* Allocating the tree */
-   tree = malloc(sizeof(SUFFIX_TREE));
-   if(tree == 0)
-   {
-      printf("\nOut of memory.\n");
-      exit(0);
-   }
-   heap+=sizeof(SUFFIX_TREE);
-
-   /* Calculating string length (with an ending $ sign) */
-   tree->length         = length+1;
-   ST_ERROR            = length+10;
-   
-   /* Allocating the only real string of the tree */
-   tree->tree_string = malloc((tree->length+1)*sizeof(char));
-   if(tree->tree_string == 0)
-   {
-      printf("\nOut of memory.\n");
-      exit(0);
-   }
-   heap+=(tree->length+1)*sizeof(char);
-
-   memcpy(tree->tree_string+sizeof(char),str,length*sizeof(char));
-   /* $ is considered a uniqe symbol */
-   tree->tree_string[tree->length] = '$';
-   
-   /* Allocating the tree root node */
-   tree->root            = create_node(0, 0, 0, 0, 0);
-   tree->root->suffix_link = 0;
+   METRICS_Start(METRICS_BUILD);
+   tree = create_tree(str, length);
 
    /* Initializing algorithm parameters */
    extension = 2;
@@ -964,9 +1344,82 @@ SUFFIX_TREE* ST_CreateTree(const char* str, DBL_WORD length)
       /* Perform Single Phase Algorithm */
       SPA(tree, &pos, phase, &extension, &repeated_extension);
    }
+   METRICS_Stop(METRICS_BUILD);
+   metrics.trees++;
+   metrics.symbols += tree->length;
    return tree;
 }
 
+/******************************************************************************/
+/*
+   ST_CreateGeneralizedTree :
+   See suffix_tree.h for description.
+*/
+
+SUFFIX_TREE* ST_CreateGeneralizedTree(const char* strings[], const DBL_WORD lengths[], DBL_WORD count)
+{
+   SUFFIX_TREE*  tree;
+   DBL_WORD*     starts;
+   DBL_WORD      i, length = 0;
+   char*         joined;
+
+   if(count == 0)
+      return 0;
+   for(i = 0; i < count; i++)
+      length += lengths[i] + 1;
+   joined = (char*)malloc(length);
+   starts = (DBL_WORD*)malloc(count * sizeof(DBL_WORD));
+   if(joined == 0 || starts == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   /* The tree string starts at index 1 */
+   length = 0;
+   for(i = 0; i < count; i++)
+   {
+      starts[i] = length + 1;
+      memcpy(joined + length, strings[i], lengths[i]);
+      length += lengths[i];
+      joined[length++] = ST_SEPARATOR;
+   }
+   tree = ST_CreateTree(joined, length);
+   free(joined);
+   tree->number_sequences = count;
+   tree->sequence_starts  = starts;
+   metrics.bytes += count * sizeof(DBL_WORD);
+   return tree;
+}
+
+/******************************************************************************/
+/*
+   ST_SequenceOf :
+   See suffix_tree.h for description.
+*/
+
+DBL_WORD ST_SequenceOf(SUFFIX_TREE* tree, DBL_WORD position, DBL_WORD* offset)
+{
+   DBL_WORD low = 0, high, middle;
+
+   if(tree->sequence_starts == 0)
+   {
+      *offset = position - 1;
+      return 0;
+   }
+   /* The last sequence starting at or before position */
+   high = tree->number_sequences - 1;
+   while(low < high)
+   {
+      middle = (low + high + 1) / 2;
+      if(tree->sequence_starts[middle] <= position)
+         low = middle;
+      else
+         high = middle - 1;
+   }
+   *offset = position - tree->sequence_starts[low];
+   return low;
+}
+
 /******************************************************************************/
 /*
    ST_DeleteSubTree :
@@ -1010,6 +1463,11 @@ void ST_DeleteTree(SUFFIX_TREE* tree)
    if(tree == 0)
       return;
    ST_DeleteSubTree(tree->root);
+   free(tree->tree_string);
+   free(tree->packed_string);
+   free(tree->sequence_starts);
+   free(tree->jump_nodes);
+   free(tree->jump_offsets);
    free(tree);
 }
 
@@ -1045,7 +1503,7 @@ void ST_PrintNode(SUFFIX_TREE* tree, NODE* node1, long depth)
       /* Print the node itself */
       while(start<=end)
       {
-         printf("%c",tree->tree_string[start]);
+         printf("%c",tree_char(tree, start));
          start++;
       }
       #ifdef DEBUG
@@ -1090,7 +1548,7 @@ void ST_PrintFullNode(SUFFIX_TREE* tree, NODE* node)
    /* Print the last edge */
    while(start<=end)
    {
-      printf("%c",tree->tree_string[start]);
+      printf("%c",tree_char(tree, start));
       start++;
    }
 }
@@ -1127,10 +1585,16 @@ void ST_PrintTree(SUFFIX_TREE* tree)
 DBL_WORD ST_SelfTest(SUFFIX_TREE* tree)
 {
    DBL_WORD k,j,i;
+   /* The source string unpacked, to search its substrings */
+   char*    text = (char*)malloc(tree->length+1);
 
-#ifdef STATISTICS
-   DBL_WORD old_counter = counter;
-#endif
+   if(text == 0)
+   {
+      printf("\nOut of memory.\n");
+      exit(0);
+   }
+   for(k = 0; k <= tree->length; k++)
+      text[k] = tree_char(tree, k);
 
    /* Loop for all the prefixes of the tree source string */
    for(k = 1; k<tree->length; k++)
@@ -1138,21 +1602,17 @@ DBL_WORD ST_SelfTest(SUFFIX_TREE* tree)
       /* Loop for each suffix of each prefix */
       for(j = 1; j<=k; j++)
       {
-#ifdef STATISTICS
-         counter = 0;
-#endif
          /* Search the current suffix in the tree */
-         i = ST_FindSubstring(tree, (char*)(tree->tree_string+j), k-j+1);
+         i = ST_FindSubstring(tree, text+j, k-j+1);
          if(i == ST_ERROR)
          {
             printf("\n\nTest Results: Fail in string (%lu,%lu).\n\n",j,k);
+            free(text);
             return 0;
          }
       }
    }
-#ifdef STATISTICS
-   counter = old_counter;
-#endif
+   free(text);
    /* If we are here no search has failed and the test passed successfuly */
    printf("\n\nTest Results: Success.\n\n");
    return 1;
@@ -27,6 +27,9 @@ under the same terms as Perl itself.
 /* Error return value for some functions. Initialized  in ST_CreateTree. */
 DBL_WORD    ST_ERROR;
 
+/* Put between the sequences of a generalized tree (see ST_CreateGeneralizedTree) */
+#define     ST_SEPARATOR  '#'
+
 /******************************************************************************/
 /*                           DATA STRUCTURES                                  */
 /******************************************************************************/
@@ -64,13 +67,29 @@ typedef struct SUFFIXTREE
    DBL_WORD                 e;
    /* The one and only real source string of the tree. All edge-labels
       contain only indices to this string and do not contain the characters
-      themselves */
+      themselves. 0 when the string is held packed (see packed_string) */
    char*           tree_string;
+   /* The source string packed 2 bits per base (A=0 C=1 G=2 T=3), the base at
+      index i in bits 2*i of the array. Used instead of tree_string when the
+      string holds nothing but A, C, G and T; the $ at index length is not
+      stored. 0 otherwise */
+   DBL_WORD*                packed_string;
    /* The length of the source string */
    DBL_WORD                 length;
    /* The node that is the head of all others. It has no siblings nor a
       father */
    NODE*                    root;
+   /* Number of sequences in the source string, and the index in it of the
+      first character of each (0 for a tree of one sequence) */
+   DBL_WORD                 number_sequences;
+   DBL_WORD*                sequence_starts;
+   /* Jump table (see ST_BuildJumpTable): for each string of jump_k bases (2
+      bits per base, the first in the lowest bits) the node whose incoming edge
+      it ends in, 0 if it is not in the string, and how many bases into that
+      edge it ends. 0 when there is no table */
+   DBL_WORD                 jump_k;
+   NODE**                   jump_nodes;
+   unsigned char*           jump_offsets;
 } SUFFIX_TREE;
 
 
@@ -90,6 +109,8 @@ typedef struct SUFFIXTREE
            the program, not by the user!). The meaning of the $ sign is
            connected to the implicit/explicit suffix tree transformation,
            detailed in Ukkonen's algorithm.
+           A string made of A, C, G and T only is stored 2 bits per base and
+           edge labels are compared a word of bases at a time.
 
    Output: A pointer to the newly created tree. Keep this pointer in order to
            perform operations like search and delete on that tree. Obviously,
@@ -99,6 +120,67 @@ typedef struct SUFFIXTREE
 
 SUFFIX_TREE* ST_CreateTree(const char*   str, DBL_WORD length);
 
+/******************************************************************************/
+/*
+   ST_CreateGeneralizedTree :
+   Builds one tree over several sequences, for instance all the chromosomes of
+   a species, so a string is looked up in all of them at once. The sequences
+   are joined with an ST_SEPARATOR after each; a searched string without the
+   separator (any DNA window) can only be found inside one sequence, and
+   ST_SequenceOf tells which.
+
+   Input : The sequences, their lengths and their number.
+
+   Output: A pointer to the newly created tree, as ST_CreateTree.
+*/
+
+SUFFIX_TREE* ST_CreateGeneralizedTree(const char* strings[], const DBL_WORD lengths[], DBL_WORD count);
+
+/******************************************************************************/
+/*
+   ST_SequenceOf :
+   Finds the sequence a position of the source string is in.
+
+   Input : The tree and a position, as returned by ST_FindSubstring.
+
+   Output: The sequence number (from 0, in the order given to
+           ST_CreateGeneralizedTree, always 0 for ST_CreateTree) and, by
+           reference, the offset of the position in that sequence (from 0).
+*/
+
+DBL_WORD ST_SequenceOf(SUFFIX_TREE* tree, DBL_WORD position, DBL_WORD* offset);
+
+/******************************************************************************/
+/*
+   ST_BuildJumpTable :
+   Builds a table of the 4^k strings of k bases, each to the node and edge
+   position where its path from the root ends, for ST_FindSubstring to start k
+   bases down the tree, and to give up at once on a string that does not start
+   with any k bases of the tree. It takes 4^k * (sizeof(NODE*) + 1) bytes
+   (9 MB for k = 10), so k of 10 to 12 suits trees of a few Mbp.
+
+   Input : The tree (of a DNA string, there is no table for other trees) and
+           k, from 1 to ST_MAX_JUMP_K.
+
+   Output: 1 if the table was built, 0 if not.
+*/
+
+#define ST_MAX_JUMP_K 13
+
+DBL_WORD ST_BuildJumpTable(SUFFIX_TREE* tree, DBL_WORD k);
+
+/******************************************************************************/
+/*
+   ST_JumpK :
+   The k of the jump table tools build, from the environment:
+
+      GENOMEOT_JUMP_K=<k>   build a jump table of k bases
+
+   Output: k, 0 (no table) when it is not set.
+*/
+
+DBL_WORD ST_JumpK(void);
+
 /******************************************************************************/
 /*
    ST_FindSubstring :
@@ -114,6 +196,8 @@ SUFFIX_TREE* ST_CreateTree(const char*   str, DBL_WORD length);
    Output: If the substring is found - returns the index of the starting
            position of the substring in the tree source string. If the substring
            is not found - returns ST_ERROR.
+           With a jump table (see ST_BuildJumpTable) a string of at least
+           jump_k bases starts from the table, with the same result.
 */
 
 DBL_WORD ST_FindSubstring(SUFFIX_TREE*      tree,   /* The suffix array */
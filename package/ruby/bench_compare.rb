@@ -0,0 +1,53 @@
+require 'json'
+
+if ((ARGV.length != 2) && (ARGV.length != 3)) then
+  print "Usage: ruby bench_compare.rb <old bench.json> <new bench.json> [<tolerance percent>]\n"
+  print "\n"
+  print "  Compares two runs of st_bench (make bench), benchmark by benchmark.\n"
+  print "  A benchmark more than <tolerance percent> (default 5) slower, or using that\n"
+  print "  much more peak memory, is marked REGRESSION and the exit status is 1.\n"
+  exit
+end
+
+tolerance = 5.0
+tolerance = ARGV[2].to_f if (ARGV.length == 3)
+
+def readBench( fileName )
+  results = {}
+  File.open(fileName, "r").readlines.each do |line|
+    line.strip!
+    next if (line == "") || (line[0] != "{")
+    result = JSON.parse(line)
+    results[result["benchmark"]] = result if !result.has_key?("error")
+  end
+  return results
+end
+
+def change( old, new )
+  return 0.0 if (old == nil) || (new == nil) || (old == 0)
+  return (new - old) * 100.0 / old
+end
+
+oldResults = readBench(ARGV[0])
+newResults = readBench(ARGV[1])
+regressions = 0
+
+printf("%-16s %12s %12s %8s %12s %12s %8s\n", "benchmark", "old seconds", "new seconds", "change", "old rss KB", "new rss KB", "change")
+oldResults.each_key do |name|
+  old = oldResults[name]
+  new = newResults[name]
+  if (new == nil) then
+    printf("%-16s missing from %s\n", name, ARGV[1])
+    next
+  end
+  timeChange = change(old["seconds"], new["seconds"])
+  memoryChange = change(old["peak_rss_kb"], new["peak_rss_kb"])
+  mark = ""
+  if ((timeChange > tolerance) || (memoryChange > tolerance)) then
+    mark = "  REGRESSION"
+    regressions += 1
+  end
+  printf("%-16s %12.4f %12.4f %7.1f%% %12d %12d %7.1f%%%s\n", name, old["seconds"], new["seconds"], timeChange,
+    old["peak_rss_kb"], new["peak_rss_kb"], memoryChange, mark)
+end
+exit(regressions > 0 ? 1 : 0)
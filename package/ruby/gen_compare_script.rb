@@ -1,9 +1,12 @@
-if ((ARGV.length != 3) && (ARGV.length != 6)) then
-  print "Usage: ruby gen_compare_script.rb <file1> <file2> <results folder> [<resolution> <factor> <width>]\n"
+if ((ARGV.length != 3) && (ARGV.length != 6) && (ARGV.length != 7)) then
+  print "Usage: ruby gen_compare_script.rb <file1> <file2> <results folder> [<resolution> <factor> <width> [<config file>]]\n"
   print "\n"
   print "  In generated image, each <resolution> characters become 1 pixel,\n"
   print "  and each <resolution> * <factor> characters are used in building\n"
   print "  suffix tree.\n"
+  print "\n"
+  print "  With a threshold <config file> chrcompare writes grid rows directly\n"
+  print "  instead of the comma delimited counts for csv2grid.rb.\n"
   exit
 end
 
@@ -26,7 +29,9 @@ file2name = extractFileName( file2 )
 file1size = File.size( file1 )
 file2size = File.size( file2 )
 
-resolution_specified = (ARGV.length == 6)
+resolution_specified = (ARGV.length >= 6)
+config_file = ""
+config_file = " #{ARGV[6]}" if (ARGV.length == 7)
 
 small_file_resolution = SMALL_FILE_RESOLUTION
 small_file_resolution = ARGV[3].to_i if resolution_specified
@@ -37,5 +42,5 @@ string_length = STRING_LENGTH
 string_length = ARGV[5].to_i if resolution_specified
 
 (0..(file1size/big_file_resolution - 1)).each do |file1section|
-  print "../chrcompare #{file1} #{file1section*big_file_resolution} #{big_file_resolution} #{file2} #{small_file_resolution} #{string_length} >> #{results_folder}#{file1name}_#{file2name}.#{file1section}\n"
+  print "../chrcompare #{file1} #{file1section*big_file_resolution} #{big_file_resolution} #{file2} #{small_file_resolution} #{string_length}#{config_file} >> #{results_folder}#{file1name}_#{file2name}.#{file1section}\n"
 end
@@ -13,7 +13,13 @@ file_name = "#{results_folder}#{file1prefix}_#{file2prefix}.#{file_offset}"
 
 print "set -x > #{results_folder}#{file1prefix}_#{file2prefix}.txt\n"
 while (File.exist?(file_name)) do
-  print "ruby ../ruby/csv2grid.rb #{config_file} #{file_name} >> #{results_folder}#{file1prefix}_#{file2prefix}.txt\n"
+  # chrcompare given the config already wrote grid rows, which have no commas
+  first_line = File.open(file_name, "r") { |file| file.gets }
+  if ((first_line != nil) && !first_line.include?(",")) then
+    print "cat #{file_name} >> #{results_folder}#{file1prefix}_#{file2prefix}.txt\n"
+  else
+    print "ruby ../ruby/csv2grid.rb #{config_file} #{file_name} >> #{results_folder}#{file1prefix}_#{file2prefix}.txt\n"
+  end
   file_offset += 1
   file_name = "#{results_folder}#{file1prefix}_#{file2prefix}.#{file_offset}"
 end
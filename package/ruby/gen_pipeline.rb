@@ -0,0 +1,129 @@
+if ((ARGV.length != 1) && (ARGV.length != 5)) then
+  print "Usage: ruby gen_pipeline.rb <file.jojo> [<resolution> <factor> <config file> <width>]\n"
+  print "\n"
+  print "  Outputs the same steps as jojo.rb as a pipeline file for the pipeline tool,\n"
+  print "  which runs independent steps in parallel and skips the ones whose inputs and\n"
+  print "  parameters have not changed since their last run:\n"
+  print "\n"
+  print "    ruby gen_pipeline.rb <file.jojo> ... > <file>.pipeline\n"
+  print "    ../pipeline <file>.pipeline [<cores>]\n"
+  exit
+end
+
+resolution = 100000 
+resolution = ARGV[1].to_i if (ARGV.length == 5)
+factor = 10
+factor = ARGV[2].to_i if (ARGV.length == 5)
+configFile = ""
+configFile = ARGV[3] if (ARGV.length == 5)
+width = 20
+width = ARGV[4].to_i if (ARGV.length == 5)
+
+RUBY_PATH = "../ruby/"
+RESULTS_FOLDER = "./"
+
+def extractFileName( path )
+  data = path.split("/")
+  lastData = data[data.length - 1]
+  data = lastData.split(".")
+  return data[0]
+end
+
+filePath = ARGV[0]
+fileName = extractFileName( filePath )
+results_folder = "#{RESULTS_FOLDER}#{fileName}/"
+
+class Species
+  attr_accessor :name, :files
+
+  def initialize(name, files)
+    @name = name
+    @files = files
+  end
+end
+
+lines = File.open(filePath, "r").readlines
+species = []
+lines.each do |line|
+  line.chomp!
+  data = line.split
+  if (data[0].downcase == "species") then
+    speciesName = data[1]
+    fileList = [].concat(data[2..-1])
+    species[species.length] = Species.new( speciesName, fileList )
+  end
+end
+
+#
+#  One step of the pipeline file, see ../c/pipeline.c
+#
+def pStep( name, command, inputs, outputs, after = [] )
+  print "step #{name}\n"
+  print "cmd #{command}\n"
+  inputs.each { |file| print "in #{file}\n" }
+  outputs.each { |file| print "out #{file}\n" }
+  after.each { |step| print "after #{step}\n" }
+  print "end\n"
+  print "\n"
+end
+
+# every file of one species against every file of each later one
+def eachPair( speciesList )
+  (0..(speciesList.length - 2)).each do |s1offset|
+    ((s1offset+1)..(speciesList.length - 1)).each do |s2offset|
+      (0..(speciesList[s1offset].files.length-1)).each do |s1fileoffset|
+        (0..(speciesList[s2offset].files.length-1)).each do |s2fileoffset|
+          yield speciesList[s1offset].files[s1fileoffset], speciesList[s2offset].files[s2fileoffset], "#{s1offset}x#{s1fileoffset}v#{s2offset}x#{s2fileoffset}"
+        end
+      end
+    end
+  end
+end
+
+def outputPipeline( speciesList, results_folder, resolution, factor, configFile, width )
+  print "# Generated by gen_pipeline.rb, resolution #{resolution}, factor #{factor}, width #{width}\n"
+  speciesList.each_with_index do |s, speciesNumber|
+    print "# Species #{speciesNumber + 1}: #{s.name} #{s.files.join(" ")}\n"
+  end
+  print "\n"
+
+  # the threshold config decides what chrcompare and the grid conversion write
+  configInputs = (configFile == "") ? [] : [configFile]
+
+  pStep "folder", "mkdir -p #{results_folder}", [], [results_folder]
+
+  # fasta2acgt leaves an existing output alone, so a rerun removes the stale one first
+  speciesList.each do |s|
+    s.files.each do |file|
+      acgt = "#{results_folder}#{file}.ACGT"
+      pStep "strip_#{file}", "rm -f #{acgt} #{acgt}.2bit #{acgt}.mask && ../fasta2acgt #{file} #{acgt}", [file], [acgt], ["folder"]
+    end
+  end
+
+  tileSteps = []
+  eachPair(speciesList) do |file1, file2, pair|
+    s1file = extractFileName(file1)
+    s2file = extractFileName(file2)
+    sections = "#{results_folder}#{s1file}_#{s2file}"
+    script_file = "#{results_folder}compare_script.#{pair}"
+    grid_script = "#{results_folder}grid.#{pair}"
+    grid_file = "#{sections}.txt"
+
+    # the sections are appended to, so a rerun starts them over
+    pStep "compare_#{pair}",
+      "ruby #{RUBY_PATH}gen_compare_script.rb #{results_folder}#{file1}.ACGT #{results_folder}#{file2}.ACGT #{results_folder} #{resolution} #{factor} #{width} #{configFile} > #{script_file} && rm -f #{sections}.[0-9]* && sh #{script_file}",
+      ["#{results_folder}#{file1}.ACGT", "#{results_folder}#{file2}.ACGT"] + configInputs, [script_file]
+    pStep "grid_#{pair}",
+      "ruby #{RUBY_PATH}gen_csv2grid_script.rb #{configFile} #{s1file} #{s2file} #{results_folder} > #{grid_script} && sh #{grid_script}",
+      configInputs, [grid_script, grid_file], ["compare_#{pair}"]
+    pStep "condense_#{pair}", "../condense #{grid_file}", [grid_file], ["#{grid_file}.x10"]
+    pStep "png_#{pair}", "../grid2png #{grid_file}.png #{grid_file}", [grid_file], ["#{grid_file}.png"]
+    pStep "png_x10_#{pair}", "../grid2png #{sections}.x10.png #{grid_file}.x10", ["#{grid_file}.x10"], ["#{sections}.x10.png"]
+    pStep "tiles_#{pair}", "../grid2tiles #{sections} #{grid_file}", [grid_file], ["#{sections}.dzi"]
+    tileSteps << "tiles_#{pair}"
+  end
+
+  pStep "viewer", "cd #{results_folder} && ruby ../#{RUBY_PATH}mktileview.rb *.dzi > tiles.html", [], ["#{results_folder}tiles.html"], tileSteps
+end
+
+outputPipeline( species, results_folder, resolution, factor, configFile, width )
@@ -0,0 +1,114 @@
+require 'fiddle'
+require 'fiddle/import'
+
+# Binding of libgenomeot (package/c/genomeot.h, make libgenomeot.so) through
+# Fiddle, Ruby's own FFI, so that a script keeps an index resident and passes
+# windows and counts as buffers instead of running the tools:
+#
+#   require_relative 'genomeot'
+#   index = GenomeOT::Index.build(File.read("chr1.ACGT"))
+#   index.find_batch(["ACGTACGTACGTACGTACGT", ...])   # => positions, nil if absent
+#   index.compare(File.read("chr2.ACGT"), 100000, 20, 10)
+#   index.close
+#
+# The library is found at GENOMEOT_LIB, else next to the tools in ../c.
+module GenomeOT
+  extend Fiddle::Importer
+
+  LIBRARY = ENV["GENOMEOT_LIB"] || File.expand_path("../c/libgenomeot.so", __dir__)
+  ABI_VERSION = 1
+  DAWG = 1
+  LEFT = 2
+
+  dlload LIBRARY
+
+  extern "long GENOMEOT_Version()"
+  extern "void* GENOMEOT_Build(const char*, unsigned long)"
+  extern "long GENOMEOT_BuildFile(const char*, const char*, unsigned long, unsigned long)"
+  extern "void* GENOMEOT_Load(const char*)"
+  extern "long GENOMEOT_Save(void*, const char*)"
+  extern "unsigned long GENOMEOT_Length(void*)"
+  extern "unsigned long GENOMEOT_FindBatch(void*, const char*, unsigned long, unsigned long, void*)"
+  extern "unsigned long GENOMEOT_Compare(void*, const char*, unsigned long, unsigned long, unsigned long, unsigned long, void*)"
+  extern "long GENOMEOT_WindowCounts(const char*, unsigned long, long, long, long, void*)"
+  extern "void GENOMEOT_Free(void*)"
+
+  if GENOMEOT_Version() != ABI_VERSION then
+    raise "#{LIBRARY} is ABI version #{GENOMEOT_Version()}, this binding is #{ABI_VERSION}"
+  end
+
+  ULONG = Fiddle::SIZEOF_LONG
+  PACK = "L!*"
+
+  # A buffer of count unsigned longs for the library to fill in
+  def self.ulongs( count )
+    return Fiddle::Pointer.malloc([count, 1].max * ULONG, Fiddle::RUBY_FREE)
+  end
+
+  # Builds an index file out of core (as st_mkindex), true on success
+  def self.build_file( textFile, indexFile, memoryMB = 1024, k = 0 )
+    return GENOMEOT_BuildFile(textFile, indexFile, memoryMB, k) == 1
+  end
+
+  # Nodes and distinct substrings of the tree of a window (as centromere),
+  # flags DAWG and LEFT, maxDepth -1 for no limit
+  def self.window_counts( window, flags = 0, minDepth = 0, maxDepth = -1 )
+    counts = ulongs(2)
+    raise "window counts failed" if GENOMEOT_WindowCounts(window, window.bytesize, flags, minDepth, maxDepth, counts) != 1
+    return counts[0, 2 * ULONG].unpack(PACK)
+  end
+
+  class Index
+    # The index of a text built in memory
+    def self.build( text )
+      handle = GenomeOT.GENOMEOT_Build(text, text.bytesize)
+      raise "could not build the index" if handle.null?
+      return new(handle)
+    end
+
+    # An index file of st_mkindex or save
+    def self.load( indexFile )
+      handle = GenomeOT.GENOMEOT_Load(indexFile)
+      raise "could not load #{indexFile}" if handle.null?
+      return new(handle)
+    end
+
+    def initialize( handle )
+      @handle = handle
+    end
+
+    def length
+      return GenomeOT.GENOMEOT_Length(@handle)
+    end
+
+    def save( indexFile )
+      return GenomeOT.GENOMEOT_Save(@handle, indexFile) == 1
+    end
+
+    # Positions (from 1) of strings all of one length, nil for those not there
+    def find_batch( windows )
+      return [] if windows.empty?
+      windowSize = windows[0].bytesize
+      raise "windows of different lengths" if windows.any? { |window| window.bytesize != windowSize }
+      positions = GenomeOT.ulongs(windows.length)
+      GenomeOT.GENOMEOT_FindBatch(@handle, windows.join, windowSize, windows.length, positions)
+      return positions[0, windows.length * ULONG].unpack(PACK).map { |position| position == 0 ? nil : position }
+    end
+
+    # chrcompare's counts of a query: per section [forward, backward,
+    # forward bucket counts, backward bucket counts]
+    def compare( query, segmentSize, windowSize, buckets )
+      sections = query.bytesize / segmentSize
+      values = 2 + 2 * buckets
+      counts = GenomeOT.ulongs(sections * values)
+      GenomeOT.GENOMEOT_Compare(@handle, query, query.bytesize, segmentSize, windowSize, buckets, counts)
+      all = counts[0, sections * values * ULONG].unpack(PACK)
+      return (0...sections).map { |section| all[section * values, values] }
+    end
+
+    def close
+      GenomeOT.GENOMEOT_Free(@handle) if @handle != nil
+      @handle = nil
+    end
+  end
+end
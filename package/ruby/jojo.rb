@@ -101,7 +101,7 @@ def outputScript( speciesList, results_folder, resolution, factor, configFile, w
   step.pStep "Strip files down to minimal characters, sequence only"
   speciesList.each do |s|
     s.files.each do |file|
-      print "ruby #{RUBY_PATH}strip_file.rb #{file} #{results_folder}#{file}.ACGT\n" 
+      print "../fasta2acgt #{file} #{results_folder}#{file}.ACGT\n" 
     end
   end
 
@@ -113,7 +113,7 @@ def outputScript( speciesList, results_folder, resolution, factor, configFile, w
         (0..(speciesList[s2offset].files.length-1)).each do |s2fileoffset|
           s2file = "#{results_folder}#{speciesList[s2offset].files[s2fileoffset]}.ACGT"
           script_file = "#{results_folder}compare_script.#{s1offset}x#{s1fileoffset}v#{s2offset}x#{s2fileoffset}\n"
-          print "ruby #{RUBY_PATH}gen_compare_script.rb #{s1file} #{s2file} #{results_folder} #{resolution} #{factor} #{width} > #{script_file}\n"
+          print "ruby #{RUBY_PATH}gen_compare_script.rb #{s1file} #{s2file} #{results_folder} #{resolution} #{factor} #{width} #{configFile} > #{script_file}\n"
           print "dos2unix #{script_file}\n"
           print "chmod +x #{script_file}\n"
         end
@@ -160,15 +160,28 @@ def outputScript( speciesList, results_folder, resolution, factor, configFile, w
         (0..(speciesList[s2offset].files.length-1)).each do |s2fileoffset|
           s2file = "#{extractFileName(speciesList[s2offset].files[s2fileoffset])}"
           grid_file = "#{results_folder}#{s1file}_#{s2file}.txt"
-          print "ruby #{RUBY_PATH}condense.rb #{grid_file}\n"
-          print "ruby #{RUBY_PATH}grid2png.rb #{grid_file}\n"
-          print "mv x.png #{grid_file}.png\n"
-          print "ruby #{RUBY_PATH}grid2png.rb #{grid_file}.x10\n"
-          print "mv x.png #{grid_file[0..-5]}.x10.png\n"
+          print "../condense #{grid_file}\n"
+          print "../grid2png #{grid_file}.png #{grid_file}\n"
+          print "../grid2png #{grid_file[0..-5]}.x10.png #{grid_file}.x10\n"
         end
       end
     end
   end
+
+  step.pStep "Tile pyramids and viewer page for full resolution browsing"
+  (0..(speciesList.length - 2)).each do |s1offset|
+    ((s1offset+1)..(speciesList.length - 1)).each do |s2offset|
+      (0..(speciesList[s1offset].files.length-1)).each do |s1fileoffset|
+        s1file = "#{extractFileName(speciesList[s1offset].files[s1fileoffset])}"
+        (0..(speciesList[s2offset].files.length-1)).each do |s2fileoffset|
+          s2file = "#{extractFileName(speciesList[s2offset].files[s2fileoffset])}"
+          grid_file = "#{results_folder}#{s1file}_#{s2file}.txt"
+          print "../grid2tiles #{grid_file[0..-5]} #{grid_file}\n"
+        end
+      end
+    end
+  end
+  print "(cd #{results_folder} && ruby ../#{RUBY_PATH}mktileview.rb *.dzi > tiles.html)\n"
 end
 
 print "set -x\n"
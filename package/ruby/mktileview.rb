@@ -0,0 +1,126 @@
+if (ARGV.length == 0) then
+  print "Usage: ruby mktileview.rb <dzi file> [<more dzi files>]\n"
+  print "\n"
+  print "  Outputs a static HTML page with a pan and zoom viewer for each tile pyramid\n"
+  print "  written by grid2tiles. Only the tiles in view are loaded, and nothing but the\n"
+  print "  tile files is needed, so the page works offline. The dzi paths must be relative\n"
+  print "  to where the page is saved.\n"
+  exit
+end
+
+class TileSet
+  attr_reader :name, :tiles, :width, :height, :tile_size, :max_level
+
+  def initialize(dzi_file)
+    text = File.open(dzi_file, "r").read
+    @name = dzi_file
+    @tiles = "#{dzi_file.sub(/\.dzi\z/, "")}_files/"
+    @tile_size = text[/TileSize="(\d+)"/, 1].to_i
+    @width = text[/Width="(\d+)"/, 1].to_i
+    @height = text[/Height="(\d+)"/, 1].to_i
+    # level 0 is 1 x 1, the top level the full image
+    @max_level = 0
+    size = 1
+    while ((size < @width) || (size < @height)) do
+      size *= 2
+      @max_level += 1
+    end
+  end
+
+  def to_js
+    return "{tiles: \"#{@tiles}\", width: #{@width}, height: #{@height}, tileSize: #{@tile_size}, maxLevel: #{@max_level}}"
+  end
+end
+
+VIEWER_SCRIPT = <<'SCRIPT'
+function TileViewer(view, info) {
+  var tiles = {};
+  var scale = Math.min(view.clientWidth / info.width, view.clientHeight / info.height);
+  var x0 = (view.clientWidth - info.width * scale) / 2;
+  var y0 = (view.clientHeight - info.height * scale) / 2;
+  var dragging = null;
+
+  function render() {
+    var level = info.maxLevel + Math.ceil(Math.log(scale) / Math.LN2);
+    level = Math.max(0, Math.min(info.maxLevel, level));
+    var cells = Math.pow(2, info.maxLevel - level);
+    var levelWidth = Math.ceil(info.width / cells), levelHeight = Math.ceil(info.height / cells);
+    var step = info.tileSize * cells * scale;
+    var c0 = Math.max(0, Math.floor(-x0 / step)), r0 = Math.max(0, Math.floor(-y0 / step));
+    var c1 = Math.min(Math.ceil(levelWidth / info.tileSize), Math.ceil((view.clientWidth - x0) / step));
+    var r1 = Math.min(Math.ceil(levelHeight / info.tileSize), Math.ceil((view.clientHeight - y0) / step));
+    var wanted = {}, key, img, c, r;
+    for (r = r0; r < r1; r++) {
+      for (c = c0; c < c1; c++) {
+        key = level + "/" + c + "_" + r;
+        wanted[key] = true;
+        img = tiles[key];
+        if (!img) {
+          img = document.createElement("img");
+          img.src = info.tiles + key + ".png";
+          view.appendChild(img);
+          tiles[key] = img;
+        }
+        img.style.left = (x0 + c * step) + "px";
+        img.style.top = (y0 + r * step) + "px";
+        img.style.width = (Math.min(info.tileSize, levelWidth - c * info.tileSize) * cells * scale) + "px";
+        img.style.height = (Math.min(info.tileSize, levelHeight - r * info.tileSize) * cells * scale) + "px";
+      }
+    }
+    for (key in tiles) {
+      if (!wanted[key]) {
+        view.removeChild(tiles[key]);
+        delete tiles[key];
+      }
+    }
+  }
+
+  function zoom(factor, x, y) {
+    x0 = x - (x - x0) * factor;
+    y0 = y - (y - y0) * factor;
+    scale *= factor;
+    render();
+  }
+
+  view.addEventListener("wheel", function (e) {
+    var box = view.getBoundingClientRect();
+    e.preventDefault();
+    zoom(e.deltaY < 0 ? 1.25 : 0.8, e.clientX - box.left, e.clientY - box.top);
+  });
+  view.addEventListener("mousedown", function (e) {
+    dragging = {x: e.clientX, y: e.clientY};
+    e.preventDefault();
+  });
+  window.addEventListener("mousemove", function (e) {
+    if (dragging) {
+      x0 += e.clientX - dragging.x;
+      y0 += e.clientY - dragging.y;
+      dragging = {x: e.clientX, y: e.clientY};
+      render();
+    }
+  });
+  window.addEventListener("mouseup", function () { dragging = null; });
+  view.addEventListener("dblclick", function (e) {
+    var box = view.getBoundingClientRect();
+    zoom(2, e.clientX - box.left, e.clientY - box.top);
+  });
+  window.addEventListener("resize", render);
+  render();
+}
+SCRIPT
+
+print "<html><head>\n"
+print "<style>\n"
+print ".tileview { position: relative; overflow: hidden; width: 100%; height: 80vh; background: #222; cursor: move; }\n"
+print ".tileview img { position: absolute; image-rendering: pixelated; image-rendering: crisp-edges; -ms-interpolation-mode: nearest-neighbor; }\n"
+print "</style>\n"
+print "<script>\n#{VIEWER_SCRIPT}</script>\n"
+print "</head><body>\n"
+print "<p>Drag to pan, scroll or double click to zoom.</p>\n"
+ARGV.each_with_index do |dziFileName, i|
+  tileSet = TileSet.new(dziFileName)
+  print "<h2>#{tileSet.name}</h2>\n"
+  print "<div class=\"tileview\" id=\"view#{i}\"></div>\n"
+  print "<script>TileViewer(document.getElementById(\"view#{i}\"), #{tileSet.to_js});</script>\n"
+end
+print "</body></html>\n"
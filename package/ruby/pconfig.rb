@@ -31,8 +31,6 @@ lines.each do |line|
   outFile.syswrite("species #{left_sections[0]} #{left_file_name_sections[0]}.#{left_file_name_sections[1]}\n")
   outFile.syswrite("species #{right_sections[0]} #{right_file_name_sections[0]}.#{right_file_name_sections[1]}\n")
   outFile.close
-  print "ruby #{RUBY_PATH}jojo.rb #{folder_name}.jojo #{resolution} #{factor} #{configFile} #{width} > do_#{folder_name}\n"
-  print "dos2unix do_#{folder_name}\n"
-  print "chmod +x do_#{folder_name}\n"
-  print "./do_#{folder_name}\n"
+  print "ruby #{RUBY_PATH}gen_pipeline.rb #{folder_name}.jojo #{resolution} #{factor} #{configFile} #{width} > #{folder_name}.pipeline\n"
+  print "../pipeline #{folder_name}.pipeline\n"
 end
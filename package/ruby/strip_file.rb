@@ -1,7 +1,10 @@
+require 'zlib'
+
 if (ARGV.length != 2) then
   print "Usage: ruby strip_file.rb <in file> <out file>\n"
   print "\n"
   print "  If <out file> already exists, does nothing.\n"
+  print "  <in file> may be gzip or BGZF compressed (a .fa.gz), it is read as it is.\n"
   exit
 end
 
@@ -18,9 +21,36 @@ if (File.exist?( out_file )) then
   exit
 end
 
-fin = File.open(in_file, "r")
+# yields the lines of a file, decompressed if it is gzip: every member in turn,
+# BGZF being many, with the line a member ends inside carried to the next
+def each_input_line( file_name )
+  File.open(file_name, "rb") do |fin|
+    if (fin.read(2) != "\x1f\x8b".b) then
+      fin.rewind
+      fin.each_line { |line| yield line }
+      return
+    end
+    fin.rewind
+    pending = "".b
+    until (fin.eof?) do
+      gz = Zlib::GzipReader.new(fin)
+      while (chunk = gz.read(1 << 20)) do
+        pending << chunk
+        next if (!chunk.include?("\n"))
+        lines = pending.lines
+        pending = lines.last.end_with?("\n") ? "" : lines.pop
+        lines.each { |line| yield line }
+      end
+      unused = gz.unused
+      gz.finish
+      fin.pos -= unused.length if (unused)
+    end
+    yield pending if (pending.length > 0)
+  end
+end
+
 fout = File.open(out_file, "w")
-fin.each_line do |line|
+each_input_line(in_file) do |line|
   if (line.length > 0) then
     if (line[0] != '>') then
       line.each_char do |cval|
@@ -37,6 +67,5 @@ fin.each_line do |line|
     end
   end
 end
-fin.close
 fout.close
 